@@ -6,6 +6,8 @@
 #include <magenta/processargs.h>
 #include <mxio/util.h>
 
+#include <string>
+
 #include "application/lib/app/application_context.h"
 #include "application/lib/app/connect.h"
 #include "lib/ftl/logging.h"
@@ -15,7 +17,7 @@ namespace {
 
 constexpr char kServiceRootPath[] = "/svc";
 
-mx::channel GetServiceRoot() {
+mx::channel OpenServiceRoot() {
   mx::channel h1, h2;
   if (mx::channel::create(0, &h1, &h2) != MX_OK)
     return mx::channel();
@@ -35,9 +37,6 @@ ApplicationContext::ApplicationContext(
     fidl::InterfaceRequest<ServiceProvider> outgoing_services)
     : outgoing_services_(std::move(outgoing_services)),
       service_root_(std::move(service_root)) {
-  ConnectToEnvironmentService(environment_.NewRequest());
-  ConnectToEnvironmentService(launcher_.NewRequest());
-
   if (service_request.is_valid())
     outgoing_services_.ServeDirectory(std::move(service_request));
 }
@@ -46,20 +45,21 @@ ApplicationContext::~ApplicationContext() = default;
 
 std::unique_ptr<ApplicationContext>
 ApplicationContext::CreateFromStartupInfo() {
-  auto startup_info = CreateFromStartupInfoNotChecked();
-  FTL_CHECK(startup_info->environment().get() != nullptr)
-      << "The ApplicationEnvironment is null. If this is expected, use "
-         "CreateFromStartupInfoNotChecked() to allow |environment| to be null.";
-  return startup_info;
+  // The environment used to be checked for null here, but an interface
+  // pointer bound to a fresh request never is, so there is nothing to check
+  // without connecting to the environment eagerly.
+  return CreateFromStartupInfoNotChecked();
 }
 
 std::unique_ptr<ApplicationContext>
 ApplicationContext::CreateFromStartupInfoNotChecked() {
   mx_handle_t service_request = mx_get_startup_handle(PA_SERVICE_REQUEST);
   mx_handle_t services = mx_get_startup_handle(PA_APP_SERVICES);
-  return std::make_unique<ApplicationContext>(
-      GetServiceRoot(), mx::channel(service_request),
+  auto context = std::make_unique<ApplicationContext>(
+      mx::channel(), mx::channel(service_request),
       fidl::InterfaceRequest<ServiceProvider>(mx::channel(services)));
+  context->use_namespace_ = true;
+  return context;
 }
 
 std::unique_ptr<ApplicationContext> ApplicationContext::CreateFrom(
@@ -77,15 +77,45 @@ std::unique_ptr<ApplicationContext> ApplicationContext::CreateFrom(
   }
 
   return std::make_unique<ApplicationContext>(
-      GetServiceRoot(), std::move(startup_info->launch_info->service_request),
+      std::move(service_root),
+      std::move(startup_info->launch_info->service_request),
       std::move(startup_info->launch_info->services));
 }
 
+const ApplicationEnvironmentPtr& ApplicationContext::environment() const {
+  if (!environment_)
+    ConnectToEnvironmentService(environment_.NewRequest());
+  return environment_;
+}
+
+bool ApplicationContext::has_environment_services() const {
+  return !!GetServiceRoot();
+}
+
+const ApplicationLauncherPtr& ApplicationContext::launcher() const {
+  if (!launcher_)
+    ConnectToEnvironmentService(launcher_.NewRequest());
+  return launcher_;
+}
+
 void ApplicationContext::ConnectToEnvironmentService(
     const std::string& interface_name,
-    mx::channel channel) {
+    mx::channel channel) const {
+  // Connecting by path sends the open request straight to the namespace's
+  // /svc directory, without first opening a handle to the directory itself.
+  if (use_namespace_ && !service_root_) {
+    std::string path = std::string(kServiceRootPath) + "/" + interface_name;
+    mxio_service_connect(path.c_str(), channel.release());
+    return;
+  }
   mxio_service_connect_at(service_root_.get(), interface_name.c_str(),
                           channel.release());
 }
 
+const mx::channel& ApplicationContext::GetServiceRoot() const {
+  if (use_namespace_ && !service_root_)
+    service_root_ = OpenServiceRoot();
+  return service_root_;
+}
+
 }  // namespace app
@@ -35,33 +35,34 @@ class ApplicationContext {
   // retrieve the handles supplied to the application by the application
   // manager.
   //
-  // This function will call FTL_CHECK and stack dump if the environment is
-  // null. However, a null environment services pointer is allowed.
+  // The environment services are reached through the /svc directory of the
+  // process's namespace. No connection is made until one is needed.
   //
   // The returned unique_ptr is never null.
   static std::unique_ptr<ApplicationContext> CreateFromStartupInfo();
 
-  // Like CreateFromStartupInfo(), but allows both the environment and the
-  // environment services to be null so that callers can validate the values
-  // and provide meaningful error messages.
+  // Same as CreateFromStartupInfo(). Kept for callers that validate the
+  // environment themselves.
   static std::unique_ptr<ApplicationContext> CreateFromStartupInfoNotChecked();
 
   static std::unique_ptr<ApplicationContext> CreateFrom(
       ApplicationStartupInfoPtr startup_info);
 
-  // Gets the application's environment.
+  // Gets the application's environment, connecting to it on first use.
   //
-  // May be null if the application does not have access to its environment.
-  const ApplicationEnvironmentPtr& environment() const { return environment_; }
+  // The connection is closed if the application does not have access to its
+  // environment.
+  const ApplicationEnvironmentPtr& environment() const;
 
   // Whether this application was given services by its environment.
-  bool has_environment_services() const { return !!service_root_; }
+  bool has_environment_services() const;
 
   // Gets the application launcher service provided to the application by
-  // its environment.
+  // its environment, connecting to it on first use.
   //
-  // May be null if the application does not have access to its environment.
-  const ApplicationLauncherPtr& launcher() const { return launcher_; }
+  // The connection is closed if the application does not have access to its
+  // environment.
+  const ApplicationLauncherPtr& launcher() const;
 
   // Gets a service provider implementation by which the application can
   // provide outgoing services back to its creator.
@@ -90,13 +91,20 @@ class ApplicationContext {
   // Connects to a service provided by the application's environment,
   // binding the service to a channel.
   void ConnectToEnvironmentService(const std::string& interface_name,
-                                   mx::channel channel);
+                                   mx::channel channel) const;
 
  private:
-  ApplicationEnvironmentPtr environment_;
+  // Returns the directory of environment services, opening the /svc
+  // directory of the namespace if the context was created from it.
+  const mx::channel& GetServiceRoot() const;
+
+  mutable ApplicationEnvironmentPtr environment_;
   ServiceNamespace outgoing_services_;
-  mx::channel service_root_;
-  ApplicationLauncherPtr launcher_;
+  mutable mx::channel service_root_;
+  // Whether environment services are connected through the /svc directory of
+  // the namespace rather than through |service_root_|.
+  bool use_namespace_ = false;
+  mutable ApplicationLauncherPtr launcher_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationContext);
 };
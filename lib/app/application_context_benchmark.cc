@@ -0,0 +1,64 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures what setting up an ApplicationContext costs an application at
+// startup, with and without connecting to the environment services.
+
+#include <stdio.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "application/lib/app/application_context.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace {
+
+constexpr char kIterations[] = "iterations";
+constexpr size_t kDefaultIterations = 1000u;
+
+void Measure(const char* name,
+             size_t iterations,
+             const std::function<void(app::ApplicationContext*)>& use) {
+  ftl::TimePoint start = ftl::TimePoint::Now();
+  for (size_t i = 0; i < iterations; ++i) {
+    auto context = app::ApplicationContext::CreateFromStartupInfoNotChecked();
+    use(context.get());
+  }
+  ftl::TimeDelta elapsed = ftl::TimePoint::Now() - start;
+  printf("%-12s %8.2f us per context\n", name,
+         elapsed.ToSecondsF() * 1e6 / iterations);
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+  size_t iterations = kDefaultIterations;
+  std::string value;
+  if (command_line.GetOptionValue(kIterations, &value) &&
+      (!ftl::StringToNumberWithError(value, &iterations) || !iterations)) {
+    fprintf(stderr, "Usage: %s [--%s=<count>]\n", argv[0], kIterations);
+    return 1;
+  }
+
+  mtl::MessageLoop message_loop;
+
+  // Most applications never touch their environment or launcher.
+  Measure("lazy", iterations, [](app::ApplicationContext* context) {});
+  Measure("launcher", iterations,
+          [](app::ApplicationContext* context) { context->launcher(); });
+  // What every application used to pay in the constructor.
+  Measure("eager", iterations, [](app::ApplicationContext* context) {
+    context->has_environment_services();
+    context->environment();
+    context->launcher();
+  });
+  return 0;
+}
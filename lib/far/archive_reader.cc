@@ -12,6 +12,7 @@
 
 #include "application/lib/far/file_operations.h"
 #include "application/lib/far/format.h"
+#include "application/lib/far/hash.h"
 
 namespace archive {
 namespace {
@@ -31,7 +32,7 @@ ArchiveReader::ArchiveReader(ftl::UniqueFD fd) : fd_(std::move(fd)) {}
 ArchiveReader::~ArchiveReader() = default;
 
 bool ArchiveReader::Read() {
-  return ReadIndex() && ReadDirectory();
+  return ReadIndex() && ReadDirectory() && ReadDirectoryHashes();
 }
 
 bool ArchiveReader::ExtractFile(ftl::StringView archive_path,
@@ -39,6 +40,11 @@ bool ArchiveReader::ExtractFile(ftl::StringView archive_path,
   DirectoryTableEntry entry;
   if (!GetDirectoryEntry(archive_path, &entry))
     return false;
+  if (IsBlobReference(entry)) {
+    fprintf(stderr, "error: File is stored as blob %s.\n",
+            HashToString(GetFileHash(entry)).c_str());
+    return false;
+  }
   if (lseek(fd_.get(), entry.data_offset, SEEK_SET) < 0) {
     fprintf(stderr, "error: Failed to seek to offset of file.\n");
     return false;
@@ -54,6 +60,11 @@ bool ArchiveReader::CopyFile(ftl::StringView archive_path, int dst_fd) const {
   DirectoryTableEntry entry;
   if (!GetDirectoryEntry(archive_path, &entry))
     return false;
+  if (IsBlobReference(entry)) {
+    fprintf(stderr, "error: File is stored as blob %s.\n",
+            HashToString(GetFileHash(entry)).c_str());
+    return false;
+  }
   if (lseek(fd_.get(), entry.data_offset, SEEK_SET) < 0) {
     fprintf(stderr, "error: Failed to seek to offset of file.\n");
     return false;
@@ -78,6 +89,20 @@ bool ArchiveReader::GetDirectoryEntry(ftl::StringView archive_path,
   return true;
 }
 
+const uint8_t* ArchiveReader::GetFileHash(
+    const DirectoryTableEntry& entry) const {
+  if (!has_hashes())
+    return nullptr;
+  PathComparator comparator;
+  comparator.reader = this;
+
+  auto it = std::lower_bound(directory_table_.begin(), directory_table_.end(),
+                             GetPathView(entry), comparator);
+  if (it == directory_table_.end())
+    return nullptr;
+  return hashes_.data() + (it - directory_table_.begin()) * kHashLength;
+}
+
 ftl::UniqueFD ArchiveReader::TakeFileDescriptor() {
   return std::move(fd_);
 }
@@ -190,6 +215,40 @@ bool ArchiveReader::ReadDirectory() {
   return true;
 }
 
+bool ArchiveReader::ReadDirectoryHashes() {
+  const IndexEntry* dirhash_entry = GetIndexEntry(kDirHashType);
+  if (!dirhash_entry)
+    return true;  // The directory hash chunk is optional.
+
+  uint64_t expected_length = sizeof(DirectoryHashChunk) +
+                             directory_table_.size() * kHashLength;
+  if (dirhash_entry->length != expected_length) {
+    fprintf(stderr,
+            "error: Invalid directory hash chunk length: %" PRIu64 ".\n",
+            dirhash_entry->length);
+    return false;
+  }
+  if (lseek(fd_.get(), dirhash_entry->offset, SEEK_SET) < 0) {
+    fprintf(stderr, "error: Failed to seek to directory hash chunk.\n");
+    return false;
+  }
+  DirectoryHashChunk header;
+  if (!ReadObject(fd_.get(), &header)) {
+    fprintf(stderr, "error: Failed to read directory hash chunk.\n");
+    return false;
+  }
+  if (header.algorithm != kHashAlgorithm || header.hash_length != kHashLength) {
+    fprintf(stderr, "error: Unsupported directory hash algorithm.\n");
+    return false;
+  }
+  hashes_.resize(directory_table_.size() * kHashLength);
+  if (!ReadVector(fd_.get(), &hashes_)) {
+    fprintf(stderr, "error: Failed to read directory hashes.\n");
+    return false;
+  }
+  return true;
+}
+
 const IndexEntry* ArchiveReader::GetIndexEntry(uint64_t type) const {
   for (auto& entry : index_) {
     if (entry.type == type)
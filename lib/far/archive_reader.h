@@ -44,9 +44,23 @@ class ArchiveReader {
 
   ftl::StringView GetPathView(const DirectoryTableEntry& entry) const;
 
+  // Whether the archive has a directory hash chunk.
+  bool has_hashes() const { return !hashes_.empty(); }
+
+  // Returns the kHashLength byte hash of the file described by |entry|, or
+  // null if the archive has no directory hash chunk.
+  const uint8_t* GetFileHash(const DirectoryTableEntry& entry) const;
+
+  // Whether the contents of the file described by |entry| are the blob named
+  // by its hash rather than stored in the archive.
+  bool IsBlobReference(const DirectoryTableEntry& entry) const {
+    return has_hashes() && entry.data_offset == kBlobDataOffset;
+  }
+
  private:
   bool ReadIndex();
   bool ReadDirectory();
+  bool ReadDirectoryHashes();
 
   const IndexEntry* GetIndexEntry(uint64_t type) const;
 
@@ -54,6 +68,8 @@ class ArchiveReader {
   std::vector<IndexEntry> index_;
   std::vector<DirectoryTableEntry> directory_table_;
   std::vector<char> path_data_;
+  // The hashes of the files, in the order of |directory_table_|.
+  std::vector<uint8_t> hashes_;
 };
 
 }  // namespace archive
@@ -21,6 +21,7 @@
 #include "application/lib/far/alignment.h"
 #include "application/lib/far/file_operations.h"
 #include "application/lib/far/format.h"
+#include "application/lib/far/hash.h"
 #include "lib/ftl/files/file_descriptor.h"
 #include "lib/ftl/files/unique_fd.h"
 
@@ -57,7 +58,8 @@ bool ArchiveWriter::Write(int fd) {
     return false;
   }
 
-  uint64_t index_count = entries_.empty() ? 0 : 2;
+  const bool use_blobs = !blob_directory_.empty();
+  uint64_t index_count = entries_.empty() ? 0 : (use_blobs ? 3 : 2);
   uint64_t next_chunk = 0;
 
   IndexChunk index;
@@ -81,6 +83,21 @@ bool ArchiveWriter::Write(int fd) {
     return false;
   }
 
+  // Index entries are sorted by type, which puts the directory hash chunk
+  // between the directory and directory names chunks.
+  if (use_blobs) {
+    IndexEntry dirhash_entry;
+    dirhash_entry.type = kDirHashType;
+    dirhash_entry.offset = next_chunk;
+    dirhash_entry.length =
+        sizeof(DirectoryHashChunk) + entries_.size() * kHashLength;
+    next_chunk += dirhash_entry.length;
+    if (!WriteObject(fd, dirhash_entry)) {
+      fprintf(stderr, "error: Failed to write directory hash index chunk.\n");
+      return false;
+    }
+  }
+
   IndexEntry dirnames_entry;
   dirnames_entry.type = kDirnamesType;
   dirnames_entry.offset = next_chunk;
@@ -93,7 +110,9 @@ bool ArchiveWriter::Write(int fd) {
 
   uint32_t name_offset = 0;
   uint64_t data_offset = AlignToPage(next_chunk);
+  uint64_t data_end = next_chunk;
   std::vector<DirectoryTableEntry> directory_table(entries_.size());
+  std::vector<uint8_t> hashes(use_blobs ? entries_.size() * kHashLength : 0);
   for (size_t i = 0; i < entries_.size(); ++i) {
     const ArchiveEntry& entry = entries_[i];
     DirectoryTableEntry& directory_entry = directory_table[i];
@@ -114,11 +133,21 @@ bool ArchiveWriter::Write(int fd) {
 
     directory_entry.name_offset = name_offset;
     directory_entry.name_length = entry.dst_path.size();
-    directory_entry.data_offset = data_offset;
     directory_entry.data_length = data_length;
-
     name_offset += directory_entry.name_length;
-    data_offset = AlignToPage(data_offset + data_length);
+
+    if (use_blobs) {
+      uint8_t* hash = &hashes[i * kHashLength];
+      if (!HashFile(entry.src_path.c_str(), hash) ||
+          !StoreBlob(entry, hash, data_length))
+        return false;
+      directory_entry.data_offset = kBlobDataOffset;
+      continue;
+    }
+
+    directory_entry.data_offset = data_offset;
+    data_end = data_offset + data_length;
+    data_offset = AlignToPage(data_end);
   }
 
   if (!WriteVector(fd, directory_table)) {
@@ -126,6 +155,14 @@ bool ArchiveWriter::Write(int fd) {
     return false;
   }
 
+  if (use_blobs) {
+    DirectoryHashChunk dirhash;
+    if (!WriteObject(fd, dirhash) || !WriteVector(fd, hashes)) {
+      fprintf(stderr, "error: Failed to write directory hashes.\n");
+      return false;
+    }
+  }
+
   std::vector<char> path_data(total_path_length_);
   char* pos = path_data.data();
   for (const auto& entry : entries_) {
@@ -138,7 +175,8 @@ bool ArchiveWriter::Write(int fd) {
     return false;
   }
 
-  for (size_t i = 0; i < entries_.size(); ++i) {
+  // Blobs were stored as the directory table was built.
+  for (size_t i = 0; !use_blobs && i < entries_.size(); ++i) {
     const ArchiveEntry& entry = entries_[i];
     const DirectoryTableEntry& directory_entry = directory_table[i];
 
@@ -155,9 +193,8 @@ bool ArchiveWriter::Write(int fd) {
   }
 
   if (!entries_.empty()) {
-    const DirectoryTableEntry& directory_entry = directory_table.back();
-    uint64_t end = directory_entry.data_offset + directory_entry.data_length;
-    if (ftruncate(fd, AlignToPage(end)) < 0) {
+    uint64_t end = use_blobs ? data_end : AlignToPage(data_end);
+    if (ftruncate(fd, end) < 0) {
       fprintf(stderr, "error: Failed to truncate archive to proper length.\n");
       return false;
     }
@@ -166,6 +203,29 @@ bool ArchiveWriter::Write(int fd) {
   return true;
 }
 
+bool ArchiveWriter::StoreBlob(const ArchiveEntry& entry,
+                              const uint8_t* hash,
+                              uint64_t length) {
+  std::string blob_path = blob_directory_ + "/" + HashToString(hash);
+  if (access(blob_path.c_str(), F_OK) == 0)
+    return true;  // Another archive already stored this blob.
+
+  // Write to a temporary file so that a partially written blob is never
+  // found under its hash.
+  std::string temp_path = blob_path + ".tmp";
+  ftl::UniqueFD blob_fd(open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+  if (!blob_fd.is_valid() ||
+      !CopyPathToFile(entry.src_path.c_str(), blob_fd.get(), length) ||
+      rename(temp_path.c_str(), blob_path.c_str()) != 0) {
+    fprintf(stderr, "error: Failed to store blob for file: %s\n",
+            entry.src_path.c_str());
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
 bool ArchiveWriter::HasDuplicateEntries() {
   for (size_t i = 0; i + 1 < entries_.size(); ++i) {
     if (entries_[i].dst_path == entries_[i + 1].dst_path) {
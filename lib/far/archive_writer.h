@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+#include <string>
 #include <vector>
 
 #include "application/lib/far/archive_entry.h"
@@ -19,15 +20,25 @@ class ArchiveWriter {
   ~ArchiveWriter();
   ArchiveWriter(const ArchiveWriter& other) = delete;
 
+  // Stores the files in |directory|, named by their hashes, instead of in the
+  // archive, which then records the hash of each file. Identical files are
+  // stored once, however many archives they belong to.
+  void set_blob_directory(std::string directory) {
+    blob_directory_ = std::move(directory);
+  }
+
   bool Add(ArchiveEntry entry);
   bool Write(int fd);
 
  private:
   bool HasDuplicateEntries();
+  bool StoreBlob(const ArchiveEntry& entry, const uint8_t* hash,
+                 uint64_t length);
 
   std::vector<ArchiveEntry> entries_;
   bool dirty_ = true;
   uint64_t total_path_length_ = 0;
+  std::string blob_directory_;
 };
 
 }  // namespace archive
@@ -0,0 +1,117 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/far/archive_writer.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+
+#include <string>
+
+#include "application/lib/far/archive_entry.h"
+#include "application/lib/far/archive_reader.h"
+#include "application/lib/far/hash.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/ftl/files/unique_fd.h"
+
+namespace archive {
+namespace {
+
+class ArchiveWriterTest : public ::testing::Test {
+ protected:
+  std::string NewFile(const std::string& contents) {
+    std::string path;
+    EXPECT_TRUE(temp_dir_.NewTempFile(&path));
+    EXPECT_TRUE(files::WriteFile(path, contents.data(), contents.size()));
+    return path;
+  }
+
+  std::unique_ptr<ArchiveReader> Write(ArchiveWriter* writer) {
+    std::string path;
+    EXPECT_TRUE(temp_dir_.NewTempFile(&path));
+    ftl::UniqueFD fd(open(path.c_str(), O_RDWR | O_TRUNC));
+    EXPECT_TRUE(writer->Write(fd.get()));
+    auto reader = std::make_unique<ArchiveReader>(
+        ftl::UniqueFD(open(path.c_str(), O_RDONLY)));
+    EXPECT_TRUE(reader->Read());
+    return reader;
+  }
+
+  size_t CountBlobs(const std::string& directory) {
+    size_t count = 0u;
+    DIR* dir = opendir(directory.c_str());
+    while (struct dirent* entry = readdir(dir)) {
+      if (entry->d_name[0] != '.')
+        ++count;
+    }
+    closedir(dir);
+    return count;
+  }
+
+  files::ScopedTempDir temp_dir_;
+};
+
+TEST_F(ArchiveWriterTest, StoresFilesInArchiveByDefault) {
+  ArchiveWriter writer;
+  ASSERT_TRUE(writer.Add(ArchiveEntry(NewFile("hello"), "a")));
+  auto reader = Write(&writer);
+
+  EXPECT_FALSE(reader->has_hashes());
+  DirectoryTableEntry entry;
+  ASSERT_TRUE(reader->GetDirectoryEntry("a", &entry));
+  EXPECT_FALSE(reader->IsBlobReference(entry));
+  EXPECT_EQ(nullptr, reader->GetFileHash(entry));
+}
+
+TEST_F(ArchiveWriterTest, StoresIdenticalFilesAsOneBlob) {
+  std::string blob_directory;
+  ASSERT_TRUE(temp_dir_.NewTempDir(&blob_directory));
+  std::string shared = NewFile("shared data");
+
+  ArchiveWriter first;
+  first.set_blob_directory(blob_directory);
+  ASSERT_TRUE(first.Add(ArchiveEntry(shared, "data/icu")));
+  ASSERT_TRUE(first.Add(ArchiveEntry(NewFile("first"), "bin/app")));
+  auto first_reader = Write(&first);
+
+  ArchiveWriter second;
+  second.set_blob_directory(blob_directory);
+  ASSERT_TRUE(second.Add(ArchiveEntry(shared, "lib/icudata")));
+  ASSERT_TRUE(second.Add(ArchiveEntry(NewFile("second"), "bin/app")));
+  auto second_reader = Write(&second);
+
+  EXPECT_EQ(3u, CountBlobs(blob_directory));
+
+  DirectoryTableEntry first_entry;
+  ASSERT_TRUE(first_reader->GetDirectoryEntry("data/icu", &first_entry));
+  DirectoryTableEntry second_entry;
+  ASSERT_TRUE(second_reader->GetDirectoryEntry("lib/icudata", &second_entry));
+  EXPECT_TRUE(first_reader->IsBlobReference(first_entry));
+  EXPECT_EQ(11u, first_entry.data_length);
+
+  const uint8_t* first_hash = first_reader->GetFileHash(first_entry);
+  const uint8_t* second_hash = second_reader->GetFileHash(second_entry);
+  ASSERT_NE(nullptr, first_hash);
+  ASSERT_NE(nullptr, second_hash);
+  EXPECT_EQ(HashToString(first_hash), HashToString(second_hash));
+
+  uint8_t expected[kHashLength];
+  HashData("shared data", expected);
+  EXPECT_EQ(HashToString(expected), HashToString(first_hash));
+
+  std::string blob;
+  ASSERT_TRUE(files::ReadFileToString(
+      blob_directory + "/" + HashToString(first_hash), &blob));
+  EXPECT_EQ("shared data", blob);
+
+  // The contents are not in the archive to extract.
+  std::string output;
+  ASSERT_TRUE(temp_dir_.NewTempFile(&output));
+  EXPECT_FALSE(first_reader->ExtractFile("data/icu", output.c_str()));
+}
+
+}  // namespace
+}  // namespace archive
@@ -12,6 +12,13 @@ namespace archive {
 constexpr uint64_t kMagic = 0x11c5abad480bbfc8;
 constexpr uint64_t kDirType = 0x2d2d2d2d2d524944;
 constexpr uint64_t kDirnamesType = 0x53454d414e524944;
+constexpr uint64_t kDirHashType = 0x2d48534148524944;
+
+// In archives with a directory hash chunk, files whose data offset is
+// kBlobDataOffset are not stored in the archive. Their contents are the blob
+// named by their hash. No stored file can start at this offset, which holds
+// the index chunk.
+constexpr uint64_t kBlobDataOffset = 0;
 
 constexpr uint32_t kHashAlgorithm = 1;
 constexpr uint32_t kHashLength = 32;
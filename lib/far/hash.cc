@@ -0,0 +1,64 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/far/hash.h"
+
+#include <fcntl.h>
+#include <openssl/sha.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "lib/ftl/files/unique_fd.h"
+
+namespace archive {
+namespace {
+
+constexpr size_t kReadChunkSize = 64 * 1024;
+
+}  // namespace
+
+static_assert(SHA256_DIGEST_LENGTH == kHashLength,
+              "Archive hashes must be SHA-256 digests.");
+
+void HashData(ftl::StringView data, uint8_t* hash) {
+  SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(), hash);
+}
+
+bool HashFile(const char* path, uint8_t* hash) {
+  return HashFile(path, hash, [](ftl::StringView data) { return true; });
+}
+
+bool HashFile(const char* path,
+              uint8_t* hash,
+              const std::function<bool(ftl::StringView data)>& consumer) {
+  ftl::UniqueFD fd(open(path, O_RDONLY));
+  if (!fd.is_valid())
+    return false;
+  SHA256_CTX context;
+  SHA256_Init(&context);
+  std::vector<char> buffer(kReadChunkSize);
+  ssize_t actual;
+  while ((actual = read(fd.get(), buffer.data(), buffer.size())) > 0) {
+    SHA256_Update(&context, buffer.data(), actual);
+    if (!consumer(ftl::StringView(buffer.data(), actual)))
+      return false;
+  }
+  if (actual < 0)
+    return false;
+  SHA256_Final(hash, &context);
+  return true;
+}
+
+std::string HashToString(const uint8_t* hash) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string result(kHashLength * 2, '\0');
+  for (size_t i = 0; i < kHashLength; ++i) {
+    result[2 * i] = kDigits[hash[i] >> 4];
+    result[2 * i + 1] = kDigits[hash[i] & 0xf];
+  }
+  return result;
+}
+
+}  // namespace archive
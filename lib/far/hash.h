@@ -0,0 +1,38 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_FAR_HASH_H_
+#define APPLICATION_LIB_FAR_HASH_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+
+#include "application/lib/far/format.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace archive {
+
+// Computes the SHA-256 hash of |data| into |hash|, which must hold
+// kHashLength bytes.
+void HashData(ftl::StringView data, uint8_t* hash);
+
+// Computes the SHA-256 hash of the file at |path| into |hash|. Returns false
+// if the file cannot be read.
+bool HashFile(const char* path, uint8_t* hash);
+
+// Like HashFile(), but also passes the contents of the file to |consumer| as
+// they are read, so that the file is read only once. Stops and returns false
+// if |consumer| returns false.
+bool HashFile(const char* path,
+              uint8_t* hash,
+              const std::function<bool(ftl::StringView data)>& consumer);
+
+// Returns |hash| in lowercase hexadecimal, which is how blobs are named.
+std::string HashToString(const uint8_t* hash);
+
+}  // namespace archive
+
+#endif  // APPLICATION_LIB_FAR_HASH_H_
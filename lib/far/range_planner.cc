@@ -0,0 +1,107 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/far/range_planner.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "application/lib/far/format.h"
+
+namespace archive {
+namespace {
+
+bool IsPriorityPath(ftl::StringView path,
+                    const std::vector<std::string>& priority_paths) {
+  for (const auto& prefix : priority_paths) {
+    if (path.size() >= prefix.size() &&
+        path.substr(0, prefix.size()) == prefix)
+      return true;
+  }
+  return false;
+}
+
+// Sorts |ranges| and merges the ones separated by at most |max_gap| bytes.
+void MergeRanges(std::vector<ByteRange>* ranges, uint64_t max_gap) {
+  std::sort(ranges->begin(), ranges->end(),
+            [](const ByteRange& lhs, const ByteRange& rhs) {
+              return lhs.offset < rhs.offset;
+            });
+  std::vector<ByteRange> merged;
+  for (const auto& range : *ranges) {
+    if (!range.length)
+      continue;
+    if (!merged.empty() && range.offset <= merged.back().end() + max_gap) {
+      ByteRange& last = merged.back();
+      last.length = std::max(last.end(), range.end()) - last.offset;
+    } else {
+      merged.push_back(range);
+    }
+  }
+  ranges->swap(merged);
+}
+
+}  // namespace
+
+bool GetIndexRange(ftl::StringView header, ByteRange* range) {
+  if (header.size() < kHeaderLength)
+    return false;
+  IndexChunk chunk;
+  memcpy(&chunk, header.data(), sizeof(chunk));
+  if (chunk.magic != kMagic || chunk.length % sizeof(IndexEntry) != 0 ||
+      chunk.length > std::numeric_limits<uint64_t>::max() - kHeaderLength)
+    return false;
+  range->offset = kHeaderLength;
+  range->length = chunk.length;
+  return true;
+}
+
+bool GetMetadataRange(ftl::StringView index, ByteRange* range) {
+  if (index.size() % sizeof(IndexEntry) != 0)
+    return false;
+  uint64_t end = kHeaderLength + index.size();
+  for (size_t offset = 0; offset < index.size();
+       offset += sizeof(IndexEntry)) {
+    IndexEntry entry;
+    memcpy(&entry, index.data() + offset, sizeof(entry));
+    // Chunks are tightly packed after the index, as ArchiveReader checks.
+    if (entry.offset != end ||
+        entry.length > std::numeric_limits<uint64_t>::max() - entry.offset)
+      return false;
+    end = entry.offset + entry.length;
+  }
+  range->offset = 0;
+  range->length = end;
+  return true;
+}
+
+std::vector<ByteRange> PlanFileRanges(
+    const ArchiveReader& reader,
+    const std::vector<std::string>& priority_paths,
+    uint64_t max_gap,
+    size_t* priority_count) {
+  std::vector<ByteRange> priority;
+  std::vector<ByteRange> rest;
+  reader.ListDirectory([&](const DirectoryTableEntry& entry) {
+    if (reader.IsBlobReference(entry))
+      return;
+    ByteRange range;
+    range.offset = entry.data_offset;
+    range.length = entry.data_length;
+    if (IsPriorityPath(reader.GetPathView(entry), priority_paths))
+      priority.push_back(range);
+    else
+      rest.push_back(range);
+  });
+  MergeRanges(&priority, max_gap);
+  MergeRanges(&rest, max_gap);
+
+  *priority_count = priority.size();
+  priority.insert(priority.end(), rest.begin(), rest.end());
+  return priority;
+}
+
+}  // namespace archive
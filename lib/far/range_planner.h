@@ -0,0 +1,60 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_FAR_RANGE_PLANNER_H_
+#define APPLICATION_LIB_FAR_RANGE_PLANNER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "application/lib/far/archive_reader.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace archive {
+
+// Plans the order in which to fetch an archive that is read by byte range,
+// such as one served by an HTTP server, so that the files needed to start an
+// application arrive first.
+//
+// An archive is fetched in three steps:
+//  1. The first |kHeaderLength| bytes, which give the length of the index.
+//  2. The metadata: the index and the chunks it lists, which are packed
+//     right after it and hold the directory.
+//  3. The files, as planned by PlanFileRanges().
+
+struct ByteRange {
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  uint64_t end() const { return offset + length; }
+};
+
+constexpr uint64_t kHeaderLength = sizeof(IndexChunk);
+
+// Returns the range of the index, given the first |kHeaderLength| bytes of
+// the archive. Returns false if |header| does not start an archive.
+bool GetIndexRange(ftl::StringView header, ByteRange* range);
+
+// Returns the range from the start of the archive to the end of the last
+// chunk listed in the index, given the bytes in the range returned by
+// GetIndexRange(). Returns false if the index is malformed.
+bool GetMetadataRange(ftl::StringView index, ByteRange* range);
+
+// Returns the ranges holding the files stored in the archive read by
+// |reader|, leaving out the files that are blob references.
+// Files whose paths equal or start with one of |priority_paths| come first;
+// the number of ranges holding them is stored in |priority_count|. Within
+// each group, ranges are sorted by offset, and ranges separated by at most
+// |max_gap| bytes are merged.
+std::vector<ByteRange> PlanFileRanges(
+    const ArchiveReader& reader,
+    const std::vector<std::string>& priority_paths,
+    uint64_t max_gap,
+    size_t* priority_count);
+
+}  // namespace archive
+
+#endif  // APPLICATION_LIB_FAR_RANGE_PLANNER_H_
@@ -0,0 +1,174 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/far/range_planner.h"
+
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+#include "application/lib/far/archive_entry.h"
+#include "application/lib/far/archive_writer.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/ftl/files/unique_fd.h"
+
+namespace archive {
+namespace {
+
+// Stands in for an HTTP server answering range requests for an archive.
+class FakeRangeServer {
+ public:
+  explicit FakeRangeServer(std::string contents)
+      : contents_(std::move(contents)) {}
+
+  const std::string& contents() const { return contents_; }
+  uint64_t bytes_served() const { return bytes_served_; }
+
+  std::string Read(const ByteRange& range) {
+    if (range.offset > contents_.size())
+      return std::string();
+    std::string data = contents_.substr(range.offset, range.length);
+    bytes_served_ += data.size();
+    return data;
+  }
+
+ private:
+  const std::string contents_;
+  uint64_t bytes_served_ = 0u;
+};
+
+class RangePlannerTest : public ::testing::Test {
+ protected:
+  void AddFile(const std::string& path, const std::string& contents) {
+    std::string src;
+    ASSERT_TRUE(temp_dir_.NewTempFile(&src));
+    ASSERT_TRUE(files::WriteFile(src, contents.data(), contents.size()));
+    ASSERT_TRUE(writer_.Add(ArchiveEntry(src, path)));
+  }
+
+  std::string WriteArchive() {
+    std::string path;
+    std::string contents;
+    EXPECT_TRUE(temp_dir_.NewTempFile(&path));
+    ftl::UniqueFD fd(open(path.c_str(), O_WRONLY | O_TRUNC));
+    EXPECT_TRUE(writer_.Write(fd.get()));
+    fd.reset();
+    EXPECT_TRUE(files::ReadFileToString(path, &contents));
+    return contents;
+  }
+
+  // Writes the bytes fetched so far to a file, leaving the rest as zeros, and
+  // returns a reader for it.
+  std::unique_ptr<ArchiveReader> OpenPartialArchive(const std::string& data) {
+    std::string path;
+    EXPECT_TRUE(temp_dir_.NewTempFile(&path));
+    EXPECT_TRUE(files::WriteFile(path, data.data(), data.size()));
+    auto reader = std::make_unique<ArchiveReader>(
+        ftl::UniqueFD(open(path.c_str(), O_RDONLY)));
+    return reader;
+  }
+
+  files::ScopedTempDir temp_dir_;
+  ArchiveWriter writer_;
+};
+
+void Store(const ByteRange& range, const std::string& bytes,
+           std::string* data) {
+  data->replace(range.offset, bytes.size(), bytes);
+}
+
+TEST_F(RangePlannerTest, FetchesLaunchFilesFirst) {
+  AddFile("bin/app", std::string(5000, 'a'));
+  AddFile("data/large", std::string(200000, 'd'));
+  AddFile("meta/sandbox", "{}");
+  AddFile("zzz/other", std::string(3000, 'z'));
+  FakeRangeServer server(WriteArchive());
+  std::string data(server.contents().size(), '\0');
+
+  ByteRange header{0, kHeaderLength};
+  Store(header, server.Read(header), &data);
+  ByteRange index;
+  ASSERT_TRUE(
+      GetIndexRange(ftl::StringView(data.data(), kHeaderLength), &index));
+  Store(index, server.Read(index), &data);
+  ByteRange metadata;
+  ASSERT_TRUE(GetMetadataRange(
+      ftl::StringView(data.data() + index.offset, index.length), &metadata));
+  Store(metadata, server.Read(metadata), &data);
+
+  auto reader = OpenPartialArchive(data);
+  ASSERT_TRUE(reader->Read());
+  size_t priority_count = 0u;
+  std::vector<ByteRange> ranges =
+      PlanFileRanges(*reader, {"meta/", "bin/app"}, 4096u, &priority_count);
+  ASSERT_GE(ranges.size(), priority_count);
+  ASSERT_GT(priority_count, 0u);
+
+  for (size_t i = 0; i < priority_count; ++i)
+    Store(ranges[i], server.Read(ranges[i]), &data);
+  // The application can start without the large data file.
+  EXPECT_LT(server.bytes_served(), 100000u);
+  DirectoryTableEntry entry;
+  ASSERT_TRUE(reader->GetDirectoryEntry("bin/app", &entry));
+  EXPECT_EQ(std::string(5000, 'a'),
+            data.substr(entry.data_offset, entry.data_length));
+  ASSERT_TRUE(reader->GetDirectoryEntry("meta/sandbox", &entry));
+  EXPECT_EQ("{}", data.substr(entry.data_offset, entry.data_length));
+
+  for (size_t i = priority_count; i < ranges.size(); ++i)
+    Store(ranges[i], server.Read(ranges[i]), &data);
+  ASSERT_TRUE(reader->GetDirectoryEntry("data/large", &entry));
+  EXPECT_EQ(std::string(200000, 'd'),
+            data.substr(entry.data_offset, entry.data_length));
+  ASSERT_TRUE(reader->GetDirectoryEntry("zzz/other", &entry));
+  EXPECT_EQ(std::string(3000, 'z'),
+            data.substr(entry.data_offset, entry.data_length));
+}
+
+TEST_F(RangePlannerTest, MergesNearbyRanges) {
+  AddFile("a", "1");
+  AddFile("b", "2");
+  AddFile("c", "3");
+  FakeRangeServer server(WriteArchive());
+  auto reader = OpenPartialArchive(server.contents());
+  ASSERT_TRUE(reader->Read());
+
+  size_t priority_count = 0u;
+  std::vector<ByteRange> ranges =
+      PlanFileRanges(*reader, {}, 4096u, &priority_count);
+  EXPECT_EQ(0u, priority_count);
+  // Files are page aligned, so a gap of a page merges them into one range.
+  ASSERT_EQ(1u, ranges.size());
+
+  ranges = PlanFileRanges(*reader, {"b"}, 0u, &priority_count);
+  EXPECT_EQ(1u, priority_count);
+  ASSERT_EQ(3u, ranges.size());
+  DirectoryTableEntry entry;
+  ASSERT_TRUE(reader->GetDirectoryEntry("b", &entry));
+  EXPECT_EQ(entry.data_offset, ranges[0].offset);
+  EXPECT_EQ(entry.data_length, ranges[0].length);
+}
+
+TEST(RangePlanner, RejectsMalformedHeaders) {
+  ByteRange range;
+  EXPECT_FALSE(GetIndexRange(ftl::StringView("short"), &range));
+  std::string header(kHeaderLength, '\0');
+  EXPECT_FALSE(GetIndexRange(header, &range));
+
+  IndexChunk chunk;
+  chunk.length = sizeof(IndexEntry) + 1;
+  header.assign(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+  EXPECT_FALSE(GetIndexRange(header, &range));
+
+  IndexEntry entry;
+  entry.offset = 12345u;
+  std::string index(reinterpret_cast<const char*>(&entry), sizeof(entry));
+  EXPECT_FALSE(GetMetadataRange(index, &range));
+}
+
+}  // namespace
+}  // namespace archive
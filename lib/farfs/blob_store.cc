@@ -0,0 +1,116 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/farfs/blob_store.h"
+
+#include <magenta/syscalls.h>
+#include <string.h>
+
+#include <atomic>
+#include <utility>
+
+#include "application/lib/far/format.h"
+#include "application/lib/far/hash.h"
+#include "lib/ftl/logging.h"
+
+namespace archive {
+namespace {
+
+std::atomic<BlobStore*> g_default_store;
+
+mx::vmo Clone(const mx::vmo& vmo, uint64_t length) {
+  mx_handle_t result = MX_HANDLE_INVALID;
+  mx_vmo_clone(vmo.get(), MX_VMO_CLONE_COPY_ON_WRITE, 0u, length, &result);
+  return mx::vmo(result);
+}
+
+}  // namespace
+
+BlobStore::BlobStore(std::string directory, uint64_t max_cached_bytes)
+    : directory_(std::move(directory)), max_cached_bytes_(max_cached_bytes) {}
+
+BlobStore::~BlobStore() = default;
+
+BlobStore* BlobStore::GetDefault() {
+  return g_default_store.load();
+}
+
+void BlobStore::SetDefault(BlobStore* store) {
+  g_default_store.store(store);
+}
+
+mx::vmo BlobStore::GetBlob(const uint8_t* hash, uint64_t length) {
+  std::string name = HashToString(hash);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blobs_.find(name);
+    if (it != blobs_.end() && it->second.length == length) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      return Clone(it->second.vmo, length);
+    }
+  }
+
+  // Blobs are read without holding the lock, so two threads may both load a
+  // blob missing from the cache. The second one to finish replaces the first.
+  mx::vmo vmo = LoadBlob(name, hash, length);
+  if (!vmo)
+    return mx::vmo();
+  mx::vmo clone = Clone(vmo, length);
+  if (length > max_cached_bytes_)
+    return clone;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = blobs_.find(name);
+  if (it != blobs_.end()) {
+    cached_bytes_ -= it->second.length;
+    lru_.erase(it->second.lru_position);
+    blobs_.erase(it);
+  }
+  while (cached_bytes_ + length > max_cached_bytes_ && !lru_.empty()) {
+    auto last = blobs_.find(lru_.back());
+    cached_bytes_ -= last->second.length;
+    blobs_.erase(last);
+    lru_.pop_back();
+  }
+  lru_.push_front(name);
+  Entry& entry = blobs_[name];
+  entry.vmo = std::move(vmo);
+  entry.length = length;
+  entry.lru_position = lru_.begin();
+  cached_bytes_ += length;
+  return clone;
+}
+
+mx::vmo BlobStore::LoadBlob(const std::string& name,
+                            const uint8_t* hash,
+                            uint64_t length) {
+  mx::vmo vmo;
+  if (mx::vmo::create(length, 0u, &vmo) != MX_OK)
+    return mx::vmo();
+
+  // The blob is written into the VMO as it is read and hashed, rather than
+  // read into memory first and copied.
+  std::string path = directory_ + "/" + name;
+  uint64_t offset = 0u;
+  uint8_t actual_hash[kHashLength];
+  bool read = HashFile(
+      path.c_str(), actual_hash, [&vmo, &offset, length](ftl::StringView data) {
+        size_t actual = 0u;
+        if (data.size() > length - offset ||
+            vmo.write(data.data(), offset, data.size(), &actual) != MX_OK ||
+            actual != data.size())
+          return false;
+        offset += actual;
+        return true;
+      });
+  if (!read || offset != length ||
+      memcmp(actual_hash, hash, kHashLength) != 0) {
+    FTL_LOG(ERROR) << "Blob " << path
+                   << " is missing or does not match its hash";
+    return mx::vmo();
+  }
+  return vmo;
+}
+
+}  // namespace archive
@@ -0,0 +1,69 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_FARFS_BLOB_STORE_H_
+#define APPLICATION_LIB_FARFS_BLOB_STORE_H_
+
+#include <mx/vmo.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "lib/ftl/macros.h"
+
+namespace archive {
+
+// Loads blobs, the contents of files that archives reference by hash instead
+// of storing, from a directory of files named by their hashes (see
+// ArchiveWriter::set_blob_directory()).
+//
+// Each blob is read straight into a VMO and checked against its hash once,
+// then shared as copy-on-write clones by every archive that references it, so
+// identical files are backed by one set of pages. Blobs are kept in memory,
+// least recently used first out, up to a byte budget. Safe to use from any
+// thread.
+class BlobStore {
+ public:
+  BlobStore(std::string directory, uint64_t max_cached_bytes);
+  ~BlobStore();
+
+  // Returns the store installed for the process, or null if there is none.
+  static BlobStore* GetDefault();
+
+  // Installs |store| as the store for the process. |store| must outlive
+  // every archive::FileSystem created while it is installed.
+  static void SetDefault(BlobStore* store);
+
+  // Returns a copy-on-write clone of the blob with the given kHashLength byte
+  // |hash|, or an invalid VMO if the blob is missing, is not |length| bytes
+  // long or does not match |hash|.
+  mx::vmo GetBlob(const uint8_t* hash, uint64_t length);
+
+ private:
+  struct Entry {
+    mx::vmo vmo;
+    uint64_t length;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  mx::vmo LoadBlob(const std::string& name, const uint8_t* hash,
+                   uint64_t length);
+
+  const std::string directory_;
+  const uint64_t max_cached_bytes_;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> blobs_;
+  // Names of the cached blobs, most recently used first.
+  std::list<std::string> lru_;
+  uint64_t cached_bytes_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(BlobStore);
+};
+
+}  // namespace archive
+
+#endif  // APPLICATION_LIB_FARFS_BLOB_STORE_H_
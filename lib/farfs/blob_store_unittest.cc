@@ -0,0 +1,132 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/farfs/blob_store.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "application/lib/far/hash.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+
+namespace archive {
+namespace {
+
+constexpr uint64_t kBlobLength = 100u;
+
+struct Blob {
+  explicit Blob(char c) : contents(kBlobLength, c) {
+    HashData(contents, hash);
+  }
+
+  std::string contents;
+  uint8_t hash[kHashLength];
+};
+
+std::string ReadBlob(const mx::vmo& vmo) {
+  std::string contents(kBlobLength, '\0');
+  size_t actual = 0u;
+  if (vmo.read(&contents[0], 0u, contents.size(), &actual) != MX_OK)
+    return std::string();
+  contents.resize(actual);
+  return contents;
+}
+
+class BlobStoreTest : public ::testing::Test {
+ protected:
+  // Stores |contents| in the blob directory under the name of |hash|.
+  void WriteBlob(const uint8_t* hash, const std::string& contents) {
+    ASSERT_TRUE(files::WriteFile(BlobPath(hash), contents.data(),
+                                 contents.size()));
+  }
+
+  void DeleteBlob(const uint8_t* hash) {
+    ASSERT_EQ(0, unlink(BlobPath(hash).c_str()));
+  }
+
+  std::string BlobPath(const uint8_t* hash) {
+    return temp_dir_.path() + "/" + HashToString(hash);
+  }
+
+  files::ScopedTempDir temp_dir_;
+};
+
+TEST_F(BlobStoreTest, LoadsAndKeepsBlob) {
+  BlobStore store(temp_dir_.path(), kBlobLength);
+  Blob blob('a');
+  WriteBlob(blob.hash, blob.contents);
+
+  EXPECT_EQ(blob.contents, ReadBlob(store.GetBlob(blob.hash, kBlobLength)));
+
+  // Later archives get the cached copy.
+  DeleteBlob(blob.hash);
+  EXPECT_EQ(blob.contents, ReadBlob(store.GetBlob(blob.hash, kBlobLength)));
+}
+
+TEST_F(BlobStoreTest, RejectsBlobThatDoesNotMatchItsHash) {
+  BlobStore store(temp_dir_.path(), kBlobLength);
+  Blob blob('a');
+  WriteBlob(blob.hash, std::string(kBlobLength, 'b'));
+  EXPECT_FALSE(store.GetBlob(blob.hash, kBlobLength));
+
+  WriteBlob(blob.hash, blob.contents + "extra");
+  EXPECT_FALSE(store.GetBlob(blob.hash, kBlobLength));
+
+  // Nor is a blob shorter than the archive expects.
+  WriteBlob(blob.hash, blob.contents);
+  EXPECT_FALSE(store.GetBlob(blob.hash, kBlobLength + 1u));
+}
+
+TEST_F(BlobStoreTest, EvictsLeastRecentlyUsed) {
+  BlobStore store(temp_dir_.path(), 2 * kBlobLength);
+  Blob a('a'), b('b'), c('c');
+  WriteBlob(a.hash, a.contents);
+  WriteBlob(b.hash, b.contents);
+  WriteBlob(c.hash, c.contents);
+
+  EXPECT_TRUE(store.GetBlob(a.hash, kBlobLength));
+  EXPECT_TRUE(store.GetBlob(b.hash, kBlobLength));
+  EXPECT_TRUE(store.GetBlob(a.hash, kBlobLength));
+  EXPECT_TRUE(store.GetBlob(c.hash, kBlobLength));
+
+  DeleteBlob(a.hash);
+  DeleteBlob(b.hash);
+  DeleteBlob(c.hash);
+  EXPECT_TRUE(store.GetBlob(a.hash, kBlobLength));
+  EXPECT_FALSE(store.GetBlob(b.hash, kBlobLength));
+  EXPECT_TRUE(store.GetBlob(c.hash, kBlobLength));
+}
+
+TEST_F(BlobStoreTest, RacingLoadsOfSameBlob) {
+  BlobStore store(temp_dir_.path(), 2 * kBlobLength);
+  Blob a('a'), b('b');
+  WriteBlob(a.hash, a.contents);
+  WriteBlob(b.hash, b.contents);
+
+  std::string results[2];
+  std::thread threads[2];
+  for (size_t i = 0; i < 2; ++i) {
+    threads[i] = std::thread([&store, &a, &results, i] {
+      results[i] = ReadBlob(store.GetBlob(a.hash, kBlobLength));
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(a.contents, results[0]);
+  EXPECT_EQ(a.contents, results[1]);
+
+  // The blob is cached once, so there is still room for another.
+  EXPECT_TRUE(store.GetBlob(b.hash, kBlobLength));
+  DeleteBlob(a.hash);
+  DeleteBlob(b.hash);
+  EXPECT_TRUE(store.GetBlob(a.hash, kBlobLength));
+  EXPECT_TRUE(store.GetBlob(b.hash, kBlobLength));
+}
+
+}  // namespace
+}  // namespace archive
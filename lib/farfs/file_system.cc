@@ -6,11 +6,32 @@
 
 #include <fcntl.h>
 
+#include <memory>
+#include <utility>
+
+#include "application/lib/farfs/blob_store.h"
+#include "application/lib/vfs/dispatcher_pool.h"
 #include "lib/mtl/vfs/vfs_serve.h"
 
 namespace archive {
 namespace {
 
+// vmofs::VnodeDir does not own the names of its entries, which point into the
+// path data of the archive's reader. This one keeps the reader alive for as
+// long as the vnode is, even after the file system is gone.
+class SharedVnodeDir : public vmofs::VnodeDir {
+ public:
+  SharedVnodeDir(fs::Dispatcher* dispatcher,
+                 std::shared_ptr<const ArchiveReader> reader,
+                 mxtl::Array<mxtl::StringPiece> names,
+                 mxtl::Array<mxtl::RefPtr<vmofs::Vnode>> children)
+      : vmofs::VnodeDir(dispatcher, std::move(names), std::move(children)),
+        reader_(std::move(reader)) {}
+
+ private:
+  std::shared_ptr<const ArchiveReader> reader_;
+};
+
 struct DirRecord {
   DirRecord() = default;
   DirRecord(DirRecord&& other)
@@ -22,7 +43,9 @@ struct DirRecord {
     children.swap(other.children);
   }
 
-  mxtl::RefPtr<vmofs::VnodeDir> CreateDirectory(fs::Dispatcher* dispatcher) {
+  mxtl::RefPtr<vmofs::VnodeDir> CreateDirectory(
+      fs::Dispatcher* dispatcher,
+      std::shared_ptr<const ArchiveReader> reader) {
     size_t count = names.size();
     mxtl::Array<mxtl::StringPiece> names_array(new mxtl::StringPiece[count],
                                                count);
@@ -33,8 +56,9 @@ struct DirRecord {
       children_array[i] = std::move(children[i]);
     }
 
-    return mxtl::AdoptRef(new vmofs::VnodeDir(
-        dispatcher, std::move(names_array), std::move(children_array)));
+    return mxtl::AdoptRef(new SharedVnodeDir(dispatcher, std::move(reader),
+                                             std::move(names_array),
+                                             std::move(children_array)));
   }
 
   mtl::VFSDispatcher dispatcher_;
@@ -70,17 +94,34 @@ mxtl::StringPiece ToStringPiece(ftl::StringView view) {
   return mxtl::StringPiece(view.data(), view.size());
 }
 
+// vmofs::VnodeFile does not own the VMO it reads from. This one keeps it
+// alive for as long as the vnode is, even after the file system is gone.
+class SharedVnodeFile : public vmofs::VnodeFile {
+ public:
+  SharedVnodeFile(fs::Dispatcher* dispatcher,
+                  std::shared_ptr<const mx::vmo> vmo,
+                  uint64_t offset,
+                  uint64_t length)
+      : vmofs::VnodeFile(dispatcher, vmo->get(), offset, length),
+        vmo_(std::move(vmo)) {}
+
+ private:
+  std::shared_ptr<const mx::vmo> vmo_;
+};
+
 mxtl::RefPtr<vmofs::VnodeFile> CreateFile(fs::Dispatcher* dispatcher,
-                                          mx_handle_t vmo,
+                                          std::shared_ptr<const mx::vmo> vmo,
+                                          uint64_t offset,
                                           const DirectoryTableEntry& entry) {
-  return mxtl::AdoptRef(new vmofs::VnodeFile(dispatcher, vmo, entry.data_offset,
-                                             entry.data_length));
+  return mxtl::AdoptRef(new SharedVnodeFile(dispatcher, std::move(vmo), offset,
+                                            entry.data_length));
 }
 
 void LeaveDirectory(fs::Dispatcher* dispatcher,
+                    const std::shared_ptr<const ArchiveReader>& reader,
                     ftl::StringView name,
                     std::vector<DirRecord>* stack) {
-  auto child = stack->back().CreateDirectory(dispatcher);
+  auto child = stack->back().CreateDirectory(dispatcher, reader);
   stack->pop_back();
   DirRecord& parent = stack->back();
   parent.names.push_back(ToStringPiece(name));
@@ -89,15 +130,23 @@ void LeaveDirectory(fs::Dispatcher* dispatcher,
 
 }  // namespace
 
-FileSystem::FileSystem(mx::vmo vmo) : vmo_(vmo.get()) {
+FileSystem::FileSystem(mx::vmo vmo) {
+  dispatcher_ = vfs::DispatcherPool::GetDefault();
+  if (!dispatcher_)
+    dispatcher_ = &owned_dispatcher_;
+
   uint64_t num_bytes = 0;
   mx_status_t status = vmo.get_size(&num_bytes);
   if (status != MX_OK)
     return;
+  mx::vmo duplicate;
+  if (vmo.duplicate(MX_RIGHT_SAME_RIGHTS, &duplicate) != MX_OK)
+    return;
+  vmo_ = std::make_shared<const mx::vmo>(std::move(duplicate));
   ftl::UniqueFD fd(mxio_vmo_fd(vmo.release(), 0, num_bytes));
   if (!fd.is_valid())
     return;
-  reader_ = std::make_unique<ArchiveReader>(std::move(fd));
+  reader_ = std::make_shared<ArchiveReader>(std::move(fd));
   CreateDirectory();
 }
 
@@ -120,10 +169,13 @@ mx::vmo FileSystem::GetFileAsVMO(ftl::StringView path) {
   if (!reader_)
     return mx::vmo();
   DirectoryTableEntry entry;
-  if (!reader_->GetDirectoryEntry(path, &entry))
+  SharedVmo vmo;
+  uint64_t offset;
+  if (!reader_->GetDirectoryEntry(path, &entry) ||
+      !GetFileData(entry, &vmo, &offset))
     return mx::vmo();
   mx_handle_t result = MX_HANDLE_INVALID;
-  mx_vmo_clone(vmo_, MX_VMO_CLONE_COPY_ON_WRITE, entry.data_offset,
+  mx_vmo_clone(vmo->get(), MX_VMO_CLONE_COPY_ON_WRITE, offset,
                entry.data_length, &result);
   return mx::vmo(result);
 }
@@ -132,23 +184,44 @@ bool FileSystem::GetFileAsString(ftl::StringView path, std::string* result) {
   if (!reader_)
     return false;
   DirectoryTableEntry entry;
-  if (!reader_->GetDirectoryEntry(path, &entry))
+  SharedVmo vmo;
+  uint64_t offset;
+  if (!reader_->GetDirectoryEntry(path, &entry) ||
+      !GetFileData(entry, &vmo, &offset))
     return false;
   std::string data;
   data.resize(entry.data_length);
   size_t actual;
-  mx_status_t status = mx_vmo_read(vmo_, &data[0], entry.data_offset,
-                                   entry.data_length, &actual);
+  mx_status_t status =
+      mx_vmo_read(vmo->get(), &data[0], offset, entry.data_length, &actual);
   if (status != MX_OK || actual != entry.data_length)
     return false;
   result->swap(data);
   return true;
 }
 
+bool FileSystem::GetFileData(const DirectoryTableEntry& entry,
+                             SharedVmo* vmo,
+                             uint64_t* offset) const {
+  if (!reader_->IsBlobReference(entry)) {
+    *vmo = vmo_;
+    *offset = entry.data_offset;
+    return true;
+  }
+  auto it = blobs_.find(entry.name_offset);
+  if (it == blobs_.end())
+    return false;
+  *vmo = it->second;
+  *offset = 0u;
+  return true;
+}
+
 void FileSystem::CreateDirectory() {
   if (!reader_ || !reader_->Read())
     return;
 
+  BlobStore* blob_store = BlobStore::GetDefault();
+
   std::vector<DirRecord> stack;
   stack.push_back(DirRecord());
   ftl::StringView current_dir;
@@ -156,8 +229,27 @@ void FileSystem::CreateDirectory() {
   reader_->ListDirectory([&](const DirectoryTableEntry& entry) {
     ftl::StringView path = reader_->GetPathView(entry);
 
-    while (path.substr(0, current_dir.size()) != current_dir)
-      LeaveDirectory(&dispatcher_, PopLastDirectory(&current_dir), &stack);
+    if (reader_->IsBlobReference(entry)) {
+      mx::vmo blob;
+      if (blob_store)
+        blob = blob_store->GetBlob(reader_->GetFileHash(entry),
+                                   entry.data_length);
+      if (!blob) {
+        FTL_LOG(ERROR) << "Leaving out " << path.ToString()
+                       << " because its blob could not be loaded";
+        return;
+      }
+      blobs_[entry.name_offset] =
+          std::make_shared<const mx::vmo>(std::move(blob));
+    }
+    SharedVmo vmo;
+    uint64_t offset;
+    GetFileData(entry, &vmo, &offset);
+
+    while (path.substr(0, current_dir.size()) != current_dir) {
+      LeaveDirectory(dispatcher_, reader_, PopLastDirectory(&current_dir),
+                     &stack);
+    }
 
     ftl::StringView remaining = path.substr(current_dir.size());
     while (PopFirstDirectory(&remaining))
@@ -167,15 +259,17 @@ void FileSystem::CreateDirectory() {
 
     DirRecord& parent = stack.back();
     parent.names.push_back(ToStringPiece(remaining));
-    parent.children.push_back(CreateFile(&dispatcher_, vmo_, entry));
+    parent.children.push_back(CreateFile(dispatcher_, vmo, offset, entry));
   });
 
-  while (!current_dir.empty())
-    LeaveDirectory(&dispatcher_, PopLastDirectory(&current_dir), &stack);
+  while (!current_dir.empty()) {
+    LeaveDirectory(dispatcher_, reader_, PopLastDirectory(&current_dir),
+                   &stack);
+  }
 
   FTL_DCHECK(stack.size() == 1);
 
-  directory_ = stack.back().CreateDirectory(&dispatcher_);
+  directory_ = stack.back().CreateDirectory(dispatcher_, reader_);
 }
 
 }  // namespace archive
@@ -10,6 +10,7 @@
 #include <vmofs/vmofs.h>
 
 #include <memory>
+#include <unordered_map>
 
 #include "application/lib/far/archive_reader.h"
 #include "lib/ftl/files/unique_fd.h"
@@ -19,6 +20,8 @@ namespace archive {
 
 class FileSystem {
  public:
+  // Files that the archive references by hash are loaded from the
+  // process's BlobStore, if one is installed; without one they are left out.
   explicit FileSystem(mx::vmo vmo);
   ~FileSystem();
 
@@ -44,12 +47,30 @@ class FileSystem {
  private:
   void CreateDirectory();
 
-  // The owning reference to the vmo is stored inside |reader_| as a file
-  /// descriptor.
-  mx_handle_t vmo_;
-  mtl::VFSDispatcher dispatcher_;
-  std::unique_ptr<ArchiveReader> reader_;
+  // Shared by the file system and the vnodes of the files it holds, so that
+  // the vnodes can outlive the file system.
+  using SharedVmo = std::shared_ptr<const mx::vmo>;
+
+  // Finds the VMO holding the contents of |entry| and the offset of the
+  // contents in it. Returns false if the contents are a blob that could not
+  // be loaded.
+  bool GetFileData(const DirectoryTableEntry& entry,
+                   SharedVmo* vmo,
+                   uint64_t* offset) const;
+
+  // A duplicate of the handle that |reader_| reads from as a file descriptor.
+  SharedVmo vmo_;
+  mtl::VFSDispatcher owned_dispatcher_;
+  // Either |owned_dispatcher_| or the process's vfs::DispatcherPool, if one
+  // was installed when the file system was created. Connections served by a
+  // pool can outlive the file system; the vnodes they use keep the VMOs they
+  // read from and |reader_|, which holds the names of the entries, alive.
+  fs::Dispatcher* dispatcher_;
+  std::shared_ptr<ArchiveReader> reader_;
   mxtl::RefPtr<vmofs::VnodeDir> directory_;
+  // The blobs referenced by the archive, indexed by the name offset of the
+  // entry referencing them.
+  std::unordered_map<uint32_t, SharedVmo> blobs_;
 };
 
 }  // namespace archive
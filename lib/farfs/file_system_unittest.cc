@@ -0,0 +1,119 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/farfs/file_system.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <magenta/processargs.h>
+#include <mxio/util.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "application/lib/far/archive_entry.h"
+#include "application/lib/far/archive_writer.h"
+#include "application/lib/vfs/dispatcher_pool.h"
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/ftl/files/unique_fd.h"
+
+namespace archive {
+namespace {
+
+ftl::UniqueFD OpenChannelAsFD(mx::channel channel) {
+  mx_handle_t handle = channel.release();
+  uint32_t type = PA_MXIO_REMOTE;
+  int fd = -1;
+  if (mxio_create_fd(&handle, &type, 1u, &fd) != MX_OK)
+    return ftl::UniqueFD();
+  return ftl::UniqueFD(fd);
+}
+
+std::string ReadFD(int fd) {
+  std::string contents;
+  char buffer[256];
+  ssize_t actual;
+  while ((actual = read(fd, buffer, sizeof(buffer))) > 0)
+    contents.append(buffer, actual);
+  return contents;
+}
+
+class FileSystemTest : public ::testing::Test {
+ protected:
+  FileSystemTest() : pool_(1u) {}
+
+  void TearDown() override { vfs::DispatcherPool::SetDefault(nullptr); }
+
+  void AddFile(const std::string& path, const std::string& contents) {
+    std::string src;
+    ASSERT_TRUE(temp_dir_.NewTempFile(&src));
+    ASSERT_TRUE(files::WriteFile(src, contents.data(), contents.size()));
+    ASSERT_TRUE(writer_.Add(ArchiveEntry(src, path)));
+  }
+
+  mx::vmo WriteArchive() {
+    std::string path;
+    std::string contents;
+    EXPECT_TRUE(temp_dir_.NewTempFile(&path));
+    ftl::UniqueFD fd(open(path.c_str(), O_WRONLY | O_TRUNC));
+    EXPECT_TRUE(writer_.Write(fd.get()));
+    fd.reset();
+    EXPECT_TRUE(files::ReadFileToString(path, &contents));
+
+    mx::vmo vmo;
+    size_t actual = 0u;
+    EXPECT_EQ(MX_OK, mx::vmo::create(contents.size(), 0u, &vmo));
+    EXPECT_EQ(MX_OK, vmo.write(contents.data(), 0u, contents.size(), &actual));
+    return vmo;
+  }
+
+  files::ScopedTempDir temp_dir_;
+  ArchiveWriter writer_;
+  vfs::DispatcherPool pool_;
+};
+
+TEST_F(FileSystemTest, ServesFiles) {
+  AddFile("bin/app", "app");
+  AddFile("data/config", "config");
+  FileSystem file_system(WriteArchive());
+
+  std::string contents;
+  EXPECT_TRUE(file_system.GetFileAsString("data/config", &contents));
+  EXPECT_EQ("config", contents);
+  EXPECT_FALSE(file_system.GetFileAsString("data/missing", &contents));
+}
+
+// Connections served by a dispatcher pool can outlive the file system, and
+// must still find the entries of the directories they read.
+TEST_F(FileSystemTest, ServesDirectoryAfterFileSystemIsGone) {
+  AddFile("bin/app", "app");
+  AddFile("data/config", "config");
+  vfs::DispatcherPool::SetDefault(&pool_);
+
+  auto file_system = std::make_unique<FileSystem>(WriteArchive());
+  ftl::UniqueFD root(OpenChannelAsFD(file_system->OpenAsDirectory()));
+  file_system.reset();
+  ASSERT_TRUE(root.is_valid());
+
+  ftl::UniqueFD file(openat(root.get(), "data/config", O_RDONLY));
+  ASSERT_TRUE(file.is_valid());
+  EXPECT_EQ("config", ReadFD(file.get()));
+
+  DIR* dir = fdopendir(openat(root.get(), "data", O_RDONLY | O_DIRECTORY));
+  ASSERT_NE(nullptr, dir);
+  bool found = false;
+  while (struct dirent* entry = readdir(dir)) {
+    if (std::string(entry->d_name) == "config")
+      found = true;
+  }
+  closedir(dir);
+  EXPECT_TRUE(found);
+}
+
+}  // namespace
+}  // namespace archive
@@ -0,0 +1,87 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_JSON_SNAPSHOT_FORMAT_H_
+#define APPLICATION_LIB_JSON_SNAPSHOT_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace json_snapshot {
+
+// A snapshot holds a set of JSON documents in a form that can be used in
+// place, without parsing. All integers are little-endian and all offsets are
+// from the start of the snapshot.
+//
+// The snapshot starts with a |SnapshotHeader|, which is followed by
+// |file_count| |FileEntry| records. The rest of the snapshot holds nodes and
+// strings.
+//
+// Each JSON value is a 16-byte |Node|. The elements of an array are stored as
+// consecutive nodes, and the members of an object as consecutive pairs of a
+// string node for the name and a node for the value. Strings are stored with
+// a terminating NUL.
+
+constexpr uint64_t kMagic = 0x31504e534e4f534aULL;  // "JSONSNP1"
+
+struct SnapshotHeader {
+  uint64_t magic;
+  uint32_t size;
+  uint32_t file_count;
+};
+
+// A document and the file it was compiled from.
+struct FileEntry {
+  // The path at which the file is found at run time.
+  uint32_t path_offset;
+  uint32_t path_length;
+  // The FNV-1a hash of the file's contents, which tells whether the snapshot
+  // is out of date.
+  uint64_t hash;
+  uint32_t root_offset;
+  uint32_t reserved;
+};
+
+enum class NodeType : uint32_t {
+  kNull = 0,
+  kFalse = 1,
+  kTrue = 2,
+  // |payload| is the value.
+  kUint = 3,
+  // |payload| is the two's complement bits of a negative value.
+  kInt = 4,
+  // |payload| is the IEEE 754 bits of the value.
+  kDouble = 5,
+  // |count| is the length and |payload| the offset of the characters.
+  kString = 6,
+  // |count| is the number of elements and |payload| the offset of the first.
+  kArray = 7,
+  // |count| is the number of members and |payload| the offset of the first
+  // name.
+  kObject = 8,
+};
+
+struct Node {
+  NodeType type;
+  uint32_t count;
+  uint64_t payload;
+};
+
+static_assert(sizeof(SnapshotHeader) == 16, "Unexpected header size");
+static_assert(sizeof(FileEntry) == 24, "Unexpected file entry size");
+static_assert(sizeof(Node) == 16, "Unexpected node size");
+
+// Returns the 64-bit FNV-1a hash of |size| bytes at |data|.
+inline uint64_t Fnv1a(const char* data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+}  // namespace json_snapshot
+
+#endif  // APPLICATION_LIB_JSON_SNAPSHOT_FORMAT_H_
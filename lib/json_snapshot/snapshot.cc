@@ -0,0 +1,173 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/json_snapshot/snapshot.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "lib/ftl/files/file_descriptor.h"
+#include "lib/ftl/files/unique_fd.h"
+
+namespace json_snapshot {
+namespace {
+
+// Deeper documents are rejected so that validation cannot overflow the stack.
+constexpr size_t kMaxDepth = 64u;
+
+template <typename T>
+T ReadAt(const char* data, size_t offset) {
+  T result;
+  memcpy(&result, data + offset, sizeof(T));
+  return result;
+}
+
+}  // namespace
+
+Snapshot::Snapshot() = default;
+
+Snapshot::~Snapshot() {
+  Reset();
+}
+
+void Snapshot::Reset() {
+  if (mapping_)
+    munmap(mapping_, size_);
+  mapping_ = nullptr;
+  buffer_.clear();
+  data_ = nullptr;
+  size_ = 0u;
+}
+
+bool Snapshot::Load(const std::string& path) {
+  Reset();
+  ftl::UniqueFD fd(open(path.c_str(), O_RDONLY));
+  if (!fd.is_valid())
+    return false;
+  struct stat info;
+  if (fstat(fd.get(), &info) != 0 || info.st_size <= 0)
+    return false;
+
+  void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                       fd.get(), 0);
+  if (mapping != MAP_FAILED) {
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(mapping);
+    size_ = info.st_size;
+    if (Validate())
+      return true;
+    Reset();
+    return false;
+  }
+
+  // Not every file system supports mapping files.
+  std::string data(info.st_size, '\0');
+  if (ftl::ReadFileDescriptor(fd.get(), &data[0], data.size()) !=
+      static_cast<ssize_t>(data.size()))
+    return false;
+  return LoadFromData(std::move(data));
+}
+
+bool Snapshot::LoadFromData(std::string data) {
+  Reset();
+  buffer_ = std::move(data);
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+  if (Validate())
+    return true;
+  Reset();
+  return false;
+}
+
+bool Snapshot::Find(const std::string& path,
+                    const std::string& contents,
+                    Value* root) const {
+  if (!data_)
+    return false;
+  auto header = ReadAt<SnapshotHeader>(data_, 0u);
+  for (uint32_t i = 0; i < header.file_count; ++i) {
+    auto file = ReadAt<FileEntry>(
+        data_, sizeof(SnapshotHeader) + i * sizeof(FileEntry));
+    if (file.path_length != path.size() ||
+        memcmp(data_ + file.path_offset, path.data(), path.size()) != 0)
+      continue;
+    if (file.hash != Fnv1a(contents.data(), contents.size()))
+      return false;
+    *root = Value(data_, data_ + file.root_offset);
+    return true;
+  }
+  return false;
+}
+
+bool Snapshot::Validate() const {
+  if (size_ < sizeof(SnapshotHeader))
+    return false;
+  auto header = ReadAt<SnapshotHeader>(data_, 0u);
+  if (header.magic != kMagic || header.size != size_)
+    return false;
+  size_t files_end =
+      sizeof(SnapshotHeader) + size_t(header.file_count) * sizeof(FileEntry);
+  if (files_end > size_)
+    return false;
+  // A tree visits each node once, so more visits than there is room for nodes
+  // means that nodes are shared, which could make validation take very long.
+  size_t budget = size_ / sizeof(Node);
+  for (uint32_t i = 0; i < header.file_count; ++i) {
+    auto file = ReadAt<FileEntry>(
+        data_, sizeof(SnapshotHeader) + i * sizeof(FileEntry));
+    if (size_t(file.path_offset) + file.path_length > size_ ||
+        !ValidateNode(file.root_offset, 0u, &budget))
+      return false;
+  }
+  return true;
+}
+
+bool Snapshot::ValidateNode(size_t offset,
+                            size_t depth,
+                            size_t* budget) const {
+  if (depth > kMaxDepth || !*budget || offset > size_ ||
+      size_ - offset < sizeof(Node))
+    return false;
+  --*budget;
+  auto node = ReadAt<Node>(data_, offset);
+  switch (node.type) {
+    case NodeType::kNull:
+    case NodeType::kFalse:
+    case NodeType::kTrue:
+    case NodeType::kUint:
+    case NodeType::kInt:
+    case NodeType::kDouble:
+      return true;
+    case NodeType::kString:
+      // The characters must be followed by a NUL within the snapshot.
+      return node.payload < size_ && size_ - node.payload > node.count &&
+             data_[node.payload + node.count] == '\0';
+    case NodeType::kArray:
+    case NodeType::kObject: {
+      size_t children = node.type == NodeType::kArray ? node.count
+                                                      : 2u * size_t(node.count);
+      if (node.payload > size_ ||
+          (size_ - node.payload) / sizeof(Node) < children)
+        return false;
+      for (size_t i = 0; i < children; ++i) {
+        size_t child = node.payload + i * sizeof(Node);
+        // Member names must be strings.
+        if (node.type == NodeType::kObject && i % 2u == 0u &&
+            ReadAt<Node>(data_, child).type != NodeType::kString)
+          return false;
+        if (!ValidateNode(child, depth + 1u, budget))
+          return false;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace json_snapshot
@@ -0,0 +1,54 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_JSON_SNAPSHOT_SNAPSHOT_H_
+#define APPLICATION_LIB_JSON_SNAPSHOT_SNAPSHOT_H_
+
+#include <string>
+
+#include "application/lib/json_snapshot/value.h"
+#include "lib/ftl/macros.h"
+
+namespace json_snapshot {
+
+// A set of JSON documents compiled ahead of time by |SnapshotWriter|.
+//
+// Loading a snapshot maps it into memory and checks that it is well formed,
+// after which its documents can be read without parsing.
+class Snapshot {
+ public:
+  Snapshot();
+  ~Snapshot();
+
+  // Loads the snapshot at |path|. Returns false if the file does not exist or
+  // is not a well-formed snapshot.
+  bool Load(const std::string& path);
+
+  // Like |Load|, but takes the contents of the snapshot.
+  bool LoadFromData(std::string data);
+
+  // Finds the document compiled from the file at |path|. Returns false if the
+  // snapshot does not contain the file, or if |contents|, the file's current
+  // contents, differ from the ones it was compiled from.
+  bool Find(const std::string& path,
+            const std::string& contents,
+            Value* root) const;
+
+ private:
+  void Reset();
+  bool Validate() const;
+  bool ValidateNode(size_t offset, size_t depth, size_t* budget) const;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0u;
+  // Set if the snapshot is mapped rather than read into |buffer_|.
+  void* mapping_ = nullptr;
+  std::string buffer_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(Snapshot);
+};
+
+}  // namespace json_snapshot
+
+#endif  // APPLICATION_LIB_JSON_SNAPSHOT_SNAPSHOT_H_
@@ -0,0 +1,98 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/json_snapshot/snapshot.h"
+
+#include "application/lib/json_snapshot/snapshot_writer.h"
+#include "gtest/gtest.h"
+
+namespace json_snapshot {
+namespace {
+
+constexpr char kPath[] = "/system/data/example.config";
+constexpr char kContents[] = R"JSON({
+  "apps": [ "a", [ "b", "--flag" ] ],
+  "count": 4,
+  "big": 5000000000,
+  "negative": -2,
+  "ratio": 0.5,
+  "enabled": true,
+  "nothing": null
+})JSON";
+
+std::string Compile(const std::string& contents) {
+  SnapshotWriter writer;
+  std::string error;
+  EXPECT_TRUE(writer.AddDocument(kPath, contents, &error)) << error;
+  return writer.Finish();
+}
+
+TEST(Snapshot, RoundTrip) {
+  Snapshot snapshot;
+  ASSERT_TRUE(snapshot.LoadFromData(Compile(kContents)));
+
+  Value root;
+  ASSERT_TRUE(snapshot.Find(kPath, kContents, &root));
+  ASSERT_TRUE(root.IsObject());
+  EXPECT_EQ(7u, root.GetObject().MemberCount());
+
+  auto apps_it = root.FindMember("apps");
+  ASSERT_NE(root.MemberEnd(), apps_it);
+  const auto apps = apps_it->value.GetArray();
+  ASSERT_EQ(2u, apps.Size());
+  EXPECT_STREQ("a", apps[0].GetString());
+  ASSERT_TRUE(apps[1].IsArray());
+  EXPECT_STREQ("--flag", apps[1].GetArray()[1].GetString());
+
+  EXPECT_TRUE(root.FindMember("count")->value.IsUint());
+  EXPECT_EQ(4u, root.FindMember("count")->value.GetUint());
+  EXPECT_FALSE(root.FindMember("big")->value.IsUint());
+  EXPECT_EQ(5000000000u, root.FindMember("big")->value.GetUint64());
+  EXPECT_EQ(-2, root.FindMember("negative")->value.GetInt64());
+  EXPECT_EQ(0.5, root.FindMember("ratio")->value.GetDouble());
+  EXPECT_TRUE(root.FindMember("enabled")->value.GetBool());
+  EXPECT_TRUE(root.FindMember("nothing")->value.IsNull());
+  EXPECT_EQ(root.MemberEnd(), root.FindMember("missing"));
+
+  size_t members = 0u;
+  for (const auto& member : root.GetObject()) {
+    EXPECT_TRUE(member.name.IsString());
+    ++members;
+  }
+  EXPECT_EQ(7u, members);
+}
+
+TEST(Snapshot, StaleOrMissingFile) {
+  Snapshot snapshot;
+  ASSERT_TRUE(snapshot.LoadFromData(Compile(kContents)));
+
+  Value root;
+  EXPECT_FALSE(snapshot.Find(kPath, std::string(kContents) + " ", &root));
+  EXPECT_FALSE(snapshot.Find("/system/data/other.config", kContents, &root));
+}
+
+TEST(Snapshot, RejectsMalformedData) {
+  Snapshot snapshot;
+  EXPECT_FALSE(snapshot.LoadFromData(std::string()));
+
+  std::string data = Compile(kContents);
+  EXPECT_FALSE(snapshot.LoadFromData(data.substr(0, data.size() - 1)));
+
+  // Damaged snapshots must be rejected or loaded without crashing.
+  for (size_t i = 0; i < data.size(); ++i) {
+    std::string damaged = data;
+    damaged[i] ^= 0x5a;
+    snapshot.LoadFromData(damaged);
+  }
+}
+
+TEST(SnapshotWriter, RejectsInvalidJson) {
+  SnapshotWriter writer;
+  std::string error;
+  EXPECT_FALSE(writer.AddDocument(kPath, "{ \"apps\": ", &error));
+  EXPECT_FALSE(error.empty());
+}
+
+}  // namespace
+}  // namespace json_snapshot
@@ -0,0 +1,135 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/json_snapshot/snapshot_writer.h"
+
+#include <string.h>
+
+#include "application/lib/json_snapshot/format.h"
+#include "third_party/rapidjson/rapidjson/error/en.h"
+
+namespace json_snapshot {
+namespace {
+
+template <typename T>
+void WriteAt(std::string* data, size_t offset, const T& value) {
+  memcpy(&(*data)[offset], &value, sizeof(T));
+}
+
+}  // namespace
+
+SnapshotWriter::SnapshotWriter() = default;
+
+SnapshotWriter::~SnapshotWriter() = default;
+
+bool SnapshotWriter::AddDocument(const std::string& path,
+                                 const std::string& contents,
+                                 std::string* error) {
+  rapidjson::Document document;
+  document.Parse(contents);
+  if (document.HasParseError()) {
+    *error = std::string(rapidjson::GetParseError_En(
+                 document.GetParseError())) +
+             " at offset " + std::to_string(document.GetErrorOffset());
+    return false;
+  }
+  files_.push_back(File{path, contents});
+  return true;
+}
+
+std::string SnapshotWriter::Finish() const {
+  std::string data;
+  Reserve(&data, sizeof(SnapshotHeader) + files_.size() * sizeof(FileEntry));
+
+  for (size_t i = 0; i < files_.size(); ++i) {
+    const File& file = files_[i];
+    // The document was checked by AddDocument().
+    rapidjson::Document document;
+    document.Parse(file.contents);
+
+    FileEntry entry = {};
+    entry.path_offset = static_cast<uint32_t>(
+        WriteString(file.path.data(), file.path.size(), &data));
+    entry.path_length = static_cast<uint32_t>(file.path.size());
+    entry.hash = Fnv1a(file.contents.data(), file.contents.size());
+    entry.root_offset = static_cast<uint32_t>(Reserve(&data, sizeof(Node)));
+    WriteNode(document, entry.root_offset, &data);
+    WriteAt(&data, sizeof(SnapshotHeader) + i * sizeof(FileEntry), entry);
+  }
+
+  SnapshotHeader header = {};
+  header.magic = kMagic;
+  header.size = static_cast<uint32_t>(data.size());
+  header.file_count = static_cast<uint32_t>(files_.size());
+  WriteAt(&data, 0u, header);
+  return data;
+}
+
+size_t SnapshotWriter::Reserve(std::string* data, size_t size) const {
+  // Nodes are kept 8-byte aligned so that a mapped snapshot can be read
+  // efficiently.
+  data->resize((data->size() + 7u) & ~size_t(7u), '\0');
+  size_t offset = data->size();
+  data->resize(offset + size, '\0');
+  return offset;
+}
+
+size_t SnapshotWriter::WriteString(const char* string,
+                                   size_t length,
+                                   std::string* data) const {
+  size_t offset = data->size();
+  data->append(string, length);
+  data->push_back('\0');
+  return offset;
+}
+
+void SnapshotWriter::WriteNode(const rapidjson::Value& value,
+                               size_t offset,
+                               std::string* data) const {
+  Node node = {};
+  if (value.IsNull()) {
+    node.type = NodeType::kNull;
+  } else if (value.IsFalse()) {
+    node.type = NodeType::kFalse;
+  } else if (value.IsTrue()) {
+    node.type = NodeType::kTrue;
+  } else if (value.IsUint64()) {
+    node.type = NodeType::kUint;
+    node.payload = value.GetUint64();
+  } else if (value.IsInt64()) {
+    node.type = NodeType::kInt;
+    node.payload = static_cast<uint64_t>(value.GetInt64());
+  } else if (value.IsNumber()) {
+    node.type = NodeType::kDouble;
+    double number = value.GetDouble();
+    memcpy(&node.payload, &number, sizeof(number));
+  } else if (value.IsString()) {
+    node.type = NodeType::kString;
+    node.count = value.GetStringLength();
+    node.payload =
+        WriteString(value.GetString(), value.GetStringLength(), data);
+  } else if (value.IsArray()) {
+    node.type = NodeType::kArray;
+    node.count = value.Size();
+    node.payload = Reserve(data, node.count * sizeof(Node));
+    size_t child = node.payload;
+    for (const auto& element : value.GetArray()) {
+      WriteNode(element, child, data);
+      child += sizeof(Node);
+    }
+  } else if (value.IsObject()) {
+    node.type = NodeType::kObject;
+    node.count = value.MemberCount();
+    node.payload = Reserve(data, 2u * node.count * sizeof(Node));
+    size_t child = node.payload;
+    for (const auto& member : value.GetObject()) {
+      WriteNode(member.name, child, data);
+      WriteNode(member.value, child + sizeof(Node), data);
+      child += 2u * sizeof(Node);
+    }
+  }
+  WriteAt(data, offset, node);
+}
+
+}  // namespace json_snapshot
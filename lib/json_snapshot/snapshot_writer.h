@@ -0,0 +1,52 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_JSON_SNAPSHOT_SNAPSHOT_WRITER_H_
+#define APPLICATION_LIB_JSON_SNAPSHOT_SNAPSHOT_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "third_party/rapidjson/rapidjson/document.h"
+
+namespace json_snapshot {
+
+// Compiles JSON documents into a snapshot that |Snapshot| can load.
+class SnapshotWriter {
+ public:
+  SnapshotWriter();
+  ~SnapshotWriter();
+
+  // Adds the document in |contents|, which are the contents of the file found
+  // at |path| at run time. Returns false and sets |error| if |contents| are
+  // not valid JSON.
+  bool AddDocument(const std::string& path,
+                   const std::string& contents,
+                   std::string* error);
+
+  // Returns the snapshot holding the documents added so far.
+  std::string Finish() const;
+
+ private:
+  struct File {
+    std::string path;
+    std::string contents;
+  };
+
+  size_t Reserve(std::string* data, size_t size) const;
+  void WriteNode(const rapidjson::Value& value,
+                 size_t offset,
+                 std::string* data) const;
+  size_t WriteString(const char* string, size_t length, std::string* data)
+      const;
+
+  std::vector<File> files_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(SnapshotWriter);
+};
+
+}  // namespace json_snapshot
+
+#endif  // APPLICATION_LIB_JSON_SNAPSHOT_SNAPSHOT_WRITER_H_
@@ -0,0 +1,124 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/json_snapshot/value.h"
+
+#include <string.h>
+
+namespace json_snapshot {
+
+// Snapshots are not necessarily aligned in memory, so nodes are copied out
+// rather than accessed in place.
+
+NodeType Value::type() const {
+  if (!node_)
+    return NodeType::kNull;
+  NodeType type;
+  memcpy(&type, node_ + offsetof(Node, type), sizeof(type));
+  return type;
+}
+
+uint32_t Value::count() const {
+  if (!node_)
+    return 0u;
+  uint32_t count;
+  memcpy(&count, node_ + offsetof(Node, count), sizeof(count));
+  return count;
+}
+
+uint64_t Value::payload() const {
+  if (!node_)
+    return 0u;
+  uint64_t payload;
+  memcpy(&payload, node_ + offsetof(Node, payload), sizeof(payload));
+  return payload;
+}
+
+const char* Value::child(size_t index) const {
+  return base_ + payload() + index * sizeof(Node);
+}
+
+double Value::GetDouble() const {
+  switch (type()) {
+    case NodeType::kUint:
+      return static_cast<double>(payload());
+    case NodeType::kInt:
+      return static_cast<double>(GetInt64());
+    case NodeType::kDouble: {
+      uint64_t bits = payload();
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    default:
+      return 0.0;
+  }
+}
+
+const char* Value::GetString() const {
+  if (!IsString())
+    return "";
+  return base_ + payload();
+}
+
+ArrayView Value::GetArray() const {
+  return ArrayView(*this);
+}
+
+ObjectView Value::GetObject() const {
+  return ObjectView(*this);
+}
+
+MemberIterator Value::FindMember(const char* name) const {
+  MemberIterator end = MemberEnd();
+  if (!IsObject())
+    return end;
+  size_t length = strlen(name);
+  for (MemberIterator it(base_, child(0)); it != end; ++it) {
+    if (it->name.GetStringLength() == length &&
+        memcmp(it->name.GetString(), name, length) == 0)
+      return it;
+  }
+  return end;
+}
+
+MemberIterator Value::FindMember(const std::string& name) const {
+  return FindMember(name.c_str());
+}
+
+MemberIterator Value::MemberEnd() const {
+  if (!IsObject())
+    return MemberIterator(base_, nullptr);
+  return MemberIterator(base_, child(2u * count()));
+}
+
+MemberIterator::MemberIterator(const char* base, const char* node)
+    : base_(base), node_(node) {
+  if (node_)
+    member_ = Member{Value(base_, node_), Value(base_, node_ + sizeof(Node))};
+}
+
+MemberIterator& MemberIterator::operator++() {
+  node_ += 2u * sizeof(Node);
+  member_ = Member{Value(base_, node_), Value(base_, node_ + sizeof(Node))};
+  return *this;
+}
+
+ValueIterator ArrayView::begin() const {
+  return ValueIterator(value_.base_, value_.child(0));
+}
+
+ValueIterator ArrayView::end() const {
+  return ValueIterator(value_.base_, value_.child(Size()));
+}
+
+MemberIterator ObjectView::begin() const {
+  return MemberIterator(value_.base_, value_.child(0));
+}
+
+MemberIterator ObjectView::end() const {
+  return MemberIterator(value_.base_, value_.child(2u * MemberCount()));
+}
+
+}  // namespace json_snapshot
@@ -0,0 +1,163 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_JSON_SNAPSHOT_VALUE_H_
+#define APPLICATION_LIB_JSON_SNAPSHOT_VALUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "application/lib/json_snapshot/format.h"
+
+namespace json_snapshot {
+
+class ArrayView;
+class MemberIterator;
+class ObjectView;
+
+// A JSON value stored in a snapshot.
+//
+// The accessors mirror those of rapidjson::Value, so code that reads a
+// document can be written once, as a template, for both representations. A
+// value is only valid while its snapshot is alive.
+class Value {
+ public:
+  Value() = default;
+
+  bool IsNull() const { return type() == NodeType::kNull; }
+  bool IsBool() const {
+    return type() == NodeType::kFalse || type() == NodeType::kTrue;
+  }
+  bool IsNumber() const {
+    return type() == NodeType::kUint || type() == NodeType::kInt ||
+           type() == NodeType::kDouble;
+  }
+  bool IsUint() const {
+    return type() == NodeType::kUint && payload() <= UINT32_MAX;
+  }
+  bool IsUint64() const { return type() == NodeType::kUint; }
+  bool IsInt64() const {
+    return type() == NodeType::kInt ||
+           (type() == NodeType::kUint && payload() <= INT64_MAX);
+  }
+  bool IsDouble() const { return type() == NodeType::kDouble; }
+  bool IsString() const { return type() == NodeType::kString; }
+  bool IsArray() const { return type() == NodeType::kArray; }
+  bool IsObject() const { return type() == NodeType::kObject; }
+
+  bool GetBool() const { return type() == NodeType::kTrue; }
+  uint32_t GetUint() const { return static_cast<uint32_t>(payload()); }
+  uint64_t GetUint64() const { return payload(); }
+  int64_t GetInt64() const { return static_cast<int64_t>(payload()); }
+  double GetDouble() const;
+  const char* GetString() const;
+  uint32_t GetStringLength() const { return count(); }
+
+  ArrayView GetArray() const;
+  ObjectView GetObject() const;
+
+  MemberIterator FindMember(const char* name) const;
+  MemberIterator FindMember(const std::string& name) const;
+  MemberIterator MemberEnd() const;
+
+ private:
+  friend class ArrayView;
+  friend class MemberIterator;
+  friend class ObjectView;
+  friend class Snapshot;
+  friend class ValueIterator;
+
+  Value(const char* base, const char* node) : base_(base), node_(node) {}
+
+  NodeType type() const;
+  uint32_t count() const;
+  uint64_t payload() const;
+  const char* child(size_t index) const;
+
+  const char* base_ = nullptr;
+  const char* node_ = nullptr;
+};
+
+struct Member {
+  Value name;
+  Value value;
+};
+
+// Iterates over the elements of an array.
+class ValueIterator {
+ public:
+  ValueIterator(const char* base, const char* node)
+      : base_(base), node_(node) {}
+
+  Value operator*() const { return Value(base_, node_); }
+  ValueIterator& operator++() {
+    node_ += sizeof(Node);
+    return *this;
+  }
+  bool operator==(const ValueIterator& other) const {
+    return node_ == other.node_;
+  }
+  bool operator!=(const ValueIterator& other) const {
+    return node_ != other.node_;
+  }
+
+ private:
+  const char* base_;
+  const char* node_;
+};
+
+// Iterates over the members of an object.
+class MemberIterator {
+ public:
+  MemberIterator(const char* base, const char* node);
+
+  const Member& operator*() const { return member_; }
+  const Member* operator->() const { return &member_; }
+  MemberIterator& operator++();
+  bool operator==(const MemberIterator& other) const {
+    return node_ == other.node_;
+  }
+  bool operator!=(const MemberIterator& other) const {
+    return node_ != other.node_;
+  }
+
+ private:
+  const char* base_;
+  const char* node_;
+  Member member_;
+};
+
+class ArrayView {
+ public:
+  explicit ArrayView(const Value& value) : value_(value) {}
+
+  size_t Size() const { return value_.count(); }
+  bool Empty() const { return Size() == 0u; }
+  Value operator[](size_t index) const {
+    return Value(value_.base_, value_.child(index));
+  }
+  ValueIterator begin() const;
+  ValueIterator end() const;
+
+ private:
+  Value value_;
+};
+
+class ObjectView {
+ public:
+  explicit ObjectView(const Value& value) : value_(value) {}
+
+  size_t MemberCount() const { return value_.count(); }
+  MemberIterator begin() const;
+  MemberIterator end() const;
+
+ private:
+  Value value_;
+};
+
+}  // namespace json_snapshot
+
+#endif  // APPLICATION_LIB_JSON_SNAPSHOT_VALUE_H_
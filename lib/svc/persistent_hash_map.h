@@ -0,0 +1,300 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_SVC_PERSISTENT_HASH_MAP_H_
+#define APPLICATION_LIB_SVC_PERSISTENT_HASH_MAP_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace app {
+
+// A map from strings to values whose copies share structure.
+//
+// The map is a hash array mapped trie whose nodes are never modified once
+// built. Copying a map is O(1), and changing a map only copies the nodes on
+// the path to the changed key, so copies of a map are unaffected.
+template <typename Value, typename Hash = std::hash<std::string>>
+class PersistentHashMap {
+ public:
+  PersistentHashMap() = default;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0u; }
+
+  // Returns the value for |key|, or null if there is none. The pointer is
+  // valid until the map is changed or destroyed.
+  const Value* Find(const std::string& key) const {
+    size_t hash = Hash()(key);
+    const Node* node = root_.get();
+    for (size_t shift = 0; node; shift += kBits) {
+      if (shift >= kHashBits) {
+        for (const auto& entry : node->collisions) {
+          if (entry->key == key)
+            return &entry->value;
+        }
+        return nullptr;
+      }
+      uint32_t bit = BitFor(hash, shift);
+      if (!(node->bitmap & bit))
+        return nullptr;
+      const Slot& slot = node->slots[IndexOf(node->bitmap, bit)];
+      if (!slot.child)
+        return slot.entry->key == key ? &slot.entry->value : nullptr;
+      node = slot.child.get();
+    }
+    return nullptr;
+  }
+
+  // Sets the value for |key|, replacing any previous value.
+  void Set(std::string key, Value value) {
+    size_t hash = Hash()(key);
+    auto entry = std::make_shared<const Entry>(
+        Entry{hash, std::move(key), std::move(value)});
+    bool added = false;
+    root_ = Insert(root_.get(), 0u, std::move(entry), &added);
+    if (added)
+      ++size_;
+  }
+
+  // Removes the value for |key|, if any.
+  void Erase(const std::string& key) {
+    bool erased = false;
+    root_ = Remove(root_, 0u, Hash()(key), key, &erased);
+    if (erased)
+      --size_;
+  }
+
+  // Removes every value for which |keep| returns false. Only the nodes on the
+  // paths to removed keys are copied; subtrees that keep all their values are
+  // shared with copies of the map.
+  void Retain(
+      const std::function<bool(const std::string&, const Value&)>& keep) {
+    size_t removed = 0u;
+    root_ = Retain(root_, keep, &removed);
+    size_ -= removed;
+  }
+
+  // Calls |callback| with each key and value, in no particular order.
+  void ForEach(
+      const std::function<void(const std::string&, const Value&)>& callback)
+      const {
+    Visit(root_.get(), callback);
+  }
+
+ private:
+  static constexpr size_t kBits = 5u;
+  static constexpr size_t kMask = (1u << kBits) - 1u;
+  static constexpr size_t kHashBits = sizeof(size_t) * 8u;
+
+  struct Entry {
+    size_t hash;
+    std::string key;
+    Value value;
+  };
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  // Holds either an entry or, when several keys share the hash bits of this
+  // level, a child node.
+  struct Slot {
+    EntryPtr entry;
+    NodePtr child;
+  };
+
+  struct Node {
+    // The slot for hash bits |b| exists if bit |b| is set.
+    uint32_t bitmap = 0u;
+    // The slots in order of their bits.
+    std::vector<Slot> slots;
+    // Once all the hash bits are used, entries are kept in a list instead.
+    std::vector<EntryPtr> collisions;
+  };
+
+  static uint32_t BitFor(size_t hash, size_t shift) {
+    return 1u << ((hash >> shift) & kMask);
+  }
+
+  static size_t IndexOf(uint32_t bitmap, uint32_t bit) {
+    return __builtin_popcount(bitmap & (bit - 1u));
+  }
+
+  static NodePtr Insert(const Node* node,
+                        size_t shift,
+                        EntryPtr entry,
+                        bool* added) {
+    auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+
+    if (shift >= kHashBits) {
+      for (auto& existing : copy->collisions) {
+        if (existing->key == entry->key) {
+          existing = std::move(entry);
+          return copy;
+        }
+      }
+      copy->collisions.push_back(std::move(entry));
+      *added = true;
+      return copy;
+    }
+
+    uint32_t bit = BitFor(entry->hash, shift);
+    size_t index = IndexOf(copy->bitmap, bit);
+    if (!(copy->bitmap & bit)) {
+      copy->bitmap |= bit;
+      copy->slots.insert(copy->slots.begin() + index,
+                         Slot{std::move(entry), nullptr});
+      *added = true;
+      return copy;
+    }
+
+    Slot& slot = copy->slots[index];
+    if (slot.child) {
+      slot.child = Insert(slot.child.get(), shift + kBits, std::move(entry),
+                          added);
+    } else if (slot.entry->key == entry->key) {
+      slot.entry = std::move(entry);
+    } else {
+      // Two keys share the hash bits of this level, so push both down.
+      bool ignored = false;
+      NodePtr child =
+          Insert(nullptr, shift + kBits, std::move(slot.entry), &ignored);
+      slot.child = Insert(child.get(), shift + kBits, std::move(entry), added);
+      slot.entry = nullptr;
+    }
+    return copy;
+  }
+
+  static NodePtr Remove(const NodePtr& node,
+                        size_t shift,
+                        size_t hash,
+                        const std::string& key,
+                        bool* erased) {
+    if (!node)
+      return node;
+
+    if (shift >= kHashBits) {
+      for (size_t i = 0; i < node->collisions.size(); ++i) {
+        if (node->collisions[i]->key != key)
+          continue;
+        *erased = true;
+        if (node->collisions.size() == 1u)
+          return nullptr;
+        auto copy = std::make_shared<Node>(*node);
+        copy->collisions.erase(copy->collisions.begin() + i);
+        return copy;
+      }
+      return node;
+    }
+
+    uint32_t bit = BitFor(hash, shift);
+    if (!(node->bitmap & bit))
+      return node;
+    size_t index = IndexOf(node->bitmap, bit);
+    const Slot& slot = node->slots[index];
+
+    NodePtr child;
+    if (slot.child) {
+      child = Remove(slot.child, shift + kBits, hash, key, erased);
+      if (!*erased)
+        return node;
+    } else if (slot.entry->key == key) {
+      *erased = true;
+    } else {
+      return node;
+    }
+
+    auto copy = std::make_shared<Node>(*node);
+    if (child) {
+      copy->slots[index].child = std::move(child);
+    } else {
+      copy->bitmap &= ~bit;
+      copy->slots.erase(copy->slots.begin() + index);
+    }
+    if (copy->slots.empty())
+      return nullptr;
+    return copy;
+  }
+
+  static NodePtr Retain(
+      const NodePtr& node,
+      const std::function<bool(const std::string&, const Value&)>& keep,
+      size_t* removed) {
+    if (!node)
+      return node;
+
+    bool changed = false;
+    std::vector<EntryPtr> collisions;
+    for (const auto& entry : node->collisions) {
+      if (keep(entry->key, entry->value)) {
+        collisions.push_back(entry);
+      } else {
+        ++*removed;
+        changed = true;
+      }
+    }
+
+    uint32_t bitmap = 0u;
+    std::vector<Slot> slots;
+    size_t index = 0u;
+    for (uint32_t bit = 1u; bit && index < node->slots.size(); bit <<= 1) {
+      if (!(node->bitmap & bit))
+        continue;
+      const Slot& slot = node->slots[index++];
+      Slot kept;
+      if (slot.child) {
+        kept.child = Retain(slot.child, keep, removed);
+        changed = changed || kept.child != slot.child;
+        if (!kept.child)
+          continue;
+      } else if (keep(slot.entry->key, slot.entry->value)) {
+        kept.entry = slot.entry;
+      } else {
+        ++*removed;
+        changed = true;
+        continue;
+      }
+      bitmap |= bit;
+      slots.push_back(std::move(kept));
+    }
+
+    if (!changed)
+      return node;
+    if (slots.empty() && collisions.empty())
+      return nullptr;
+    auto copy = std::make_shared<Node>();
+    copy->bitmap = bitmap;
+    copy->slots = std::move(slots);
+    copy->collisions = std::move(collisions);
+    return copy;
+  }
+
+  static void Visit(
+      const Node* node,
+      const std::function<void(const std::string&, const Value&)>& callback) {
+    if (!node)
+      return;
+    for (const auto& entry : node->collisions)
+      callback(entry->key, entry->value);
+    for (const auto& slot : node->slots) {
+      if (slot.child)
+        Visit(slot.child.get(), callback);
+      else
+        callback(slot.entry->key, slot.entry->value);
+    }
+  }
+
+  NodePtr root_;
+  size_t size_ = 0u;
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_LIB_SVC_PERSISTENT_HASH_MAP_H_
@@ -0,0 +1,137 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/svc/persistent_hash_map.h"
+
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+
+namespace app {
+namespace {
+
+// Sends every key down the same path to exercise the collision lists.
+struct ConstantHash {
+  size_t operator()(const std::string& key) const { return 42u; }
+};
+
+TEST(PersistentHashMap, SetFindErase) {
+  PersistentHashMap<int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(nullptr, map.Find("a"));
+
+  map.Set("a", 1);
+  map.Set("b", 2);
+  map.Set("a", 3);
+  EXPECT_EQ(2u, map.size());
+  ASSERT_NE(nullptr, map.Find("a"));
+  EXPECT_EQ(3, *map.Find("a"));
+  ASSERT_NE(nullptr, map.Find("b"));
+  EXPECT_EQ(2, *map.Find("b"));
+
+  map.Erase("a");
+  map.Erase("missing");
+  EXPECT_EQ(1u, map.size());
+  EXPECT_EQ(nullptr, map.Find("a"));
+  EXPECT_NE(nullptr, map.Find("b"));
+}
+
+TEST(PersistentHashMap, CopiesAreIndependent) {
+  PersistentHashMap<int> original;
+  for (int i = 0; i < 1000; ++i)
+    original.Set(ftl::NumberToString(i), i);
+
+  PersistentHashMap<int> copy = original;
+  copy.Erase("7");
+  copy.Set("8", -8);
+  copy.Set("new", 1);
+
+  EXPECT_EQ(1000u, original.size());
+  EXPECT_EQ(1000u, copy.size());
+  ASSERT_NE(nullptr, original.Find("7"));
+  EXPECT_EQ(nullptr, copy.Find("7"));
+  EXPECT_EQ(8, *original.Find("8"));
+  EXPECT_EQ(-8, *copy.Find("8"));
+  EXPECT_EQ(nullptr, original.Find("new"));
+
+  for (int i = 0; i < 1000; ++i) {
+    const int* value = original.Find(ftl::NumberToString(i));
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(i, *value);
+  }
+}
+
+TEST(PersistentHashMap, Collisions) {
+  PersistentHashMap<int, ConstantHash> map;
+  map.Set("a", 1);
+  map.Set("b", 2);
+  map.Set("c", 3);
+  EXPECT_EQ(3u, map.size());
+  EXPECT_EQ(2, *map.Find("b"));
+
+  PersistentHashMap<int, ConstantHash> copy = map;
+  copy.Erase("b");
+  EXPECT_EQ(nullptr, copy.Find("b"));
+  EXPECT_EQ(2, *map.Find("b"));
+  EXPECT_EQ(3, *copy.Find("c"));
+}
+
+TEST(PersistentHashMap, ForEach) {
+  PersistentHashMap<int> map;
+  for (int i = 0; i < 100; ++i)
+    map.Set(ftl::NumberToString(i), i);
+  map.Erase("50");
+
+  std::set<int> seen;
+  map.ForEach([&seen](const std::string& key, const int& value) {
+    EXPECT_EQ(ftl::NumberToString(value), key);
+    seen.insert(value);
+  });
+  EXPECT_EQ(99u, seen.size());
+  EXPECT_EQ(0u, seen.count(50));
+}
+
+TEST(PersistentHashMap, Retain) {
+  PersistentHashMap<int> original;
+  for (int i = 0; i < 1000; ++i)
+    original.Set(ftl::NumberToString(i), i);
+
+  PersistentHashMap<int> copy = original;
+  copy.Retain([](const std::string& key, const int& value) {
+    return value % 3 == 0;
+  });
+
+  EXPECT_EQ(1000u, original.size());
+  EXPECT_EQ(334u, copy.size());
+  for (int i = 0; i < 1000; ++i) {
+    std::string key = ftl::NumberToString(i);
+    ASSERT_NE(nullptr, original.Find(key));
+    EXPECT_EQ(i % 3 == 0, copy.Find(key) != nullptr);
+  }
+
+  copy.Retain([](const std::string& key, const int& value) { return true; });
+  EXPECT_EQ(334u, copy.size());
+  copy.Retain([](const std::string& key, const int& value) { return false; });
+  EXPECT_TRUE(copy.empty());
+  EXPECT_EQ(nullptr, copy.Find("0"));
+}
+
+TEST(PersistentHashMap, RetainCollisions) {
+  PersistentHashMap<int, ConstantHash> map;
+  map.Set("a", 1);
+  map.Set("b", 2);
+  map.Set("c", 3);
+
+  map.Retain([](const std::string& key, const int& value) {
+    return key != "b";
+  });
+  EXPECT_EQ(2u, map.size());
+  EXPECT_EQ(nullptr, map.Find("b"));
+  EXPECT_EQ(3, *map.Find("c"));
+}
+
+}  // namespace
+}  // namespace app
@@ -0,0 +1,101 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/svc/service_metrics_impl.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace app {
+namespace {
+
+constexpr char kOtherServices[] = "(other)";
+
+}  // namespace
+
+constexpr size_t ServiceMetricsImpl::kMaxServices;
+
+ServiceMetricsImpl::ServiceMetricsImpl() = default;
+
+ServiceMetricsImpl::~ServiceMetricsImpl() = default;
+
+void ServiceMetricsImpl::AddBinding(
+    fidl::InterfaceRequest<ServiceMetrics> request) {
+  bindings_.AddBinding(this, std::move(request));
+}
+
+void ServiceMetricsImpl::RecordConnect(const std::string& service_name,
+                                       ftl::TimeDelta latency) {
+  Stats* stats = GetStats(service_name);
+  ++stats->connects;
+  stats->total_connector_latency = stats->total_connector_latency + latency;
+  stats->max_connector_latency =
+      std::max(stats->max_connector_latency, latency);
+}
+
+void ServiceMetricsImpl::RecordMiss(const std::string& service_name) {
+  ++GetStats(service_name)->misses;
+}
+
+void ServiceMetricsImpl::RecordForward(const std::string& service_name) {
+  ++GetStats(service_name)->forwards;
+}
+
+fidl::Array<ServiceStatsPtr> ServiceMetricsImpl::GetTop(
+    size_t max_count) const {
+  using Entry = std::pair<uint64_t, const std::string*>;
+  std::vector<Entry> entries;
+  entries.reserve(stats_.size());
+  for (const auto& pair : stats_) {
+    const Stats& stats = pair.second;
+    entries.emplace_back(stats.connects + stats.misses + stats.forwards,
+                         &pair.first);
+  }
+  size_t count = std::min(max_count, entries.size());
+  std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                    [](const Entry& a, const Entry& b) {
+                      if (a.first != b.first)
+                        return a.first > b.first;
+                      return *a.second < *b.second;
+                    });
+
+  auto result = fidl::Array<ServiceStatsPtr>::New(count);
+  for (size_t i = 0; i < count; ++i) {
+    const Stats& stats = stats_.find(*entries[i].second)->second;
+    auto info = ServiceStats::New();
+    info->name = *entries[i].second;
+    info->connects = stats.connects;
+    info->misses = stats.misses;
+    info->forwards = stats.forwards;
+    info->total_connector_latency =
+        stats.total_connector_latency.ToNanoseconds();
+    info->max_connector_latency = stats.max_connector_latency.ToNanoseconds();
+    result[i] = std::move(info);
+  }
+  return result;
+}
+
+void ServiceMetricsImpl::GetTopServices(
+    uint32_t max_count,
+    const GetTopServicesCallback& callback) {
+  callback(GetTop(max_count));
+}
+
+void ServiceMetricsImpl::Reset() {
+  stats_.clear();
+}
+
+ServiceMetricsImpl::Stats* ServiceMetricsImpl::GetStats(
+    const std::string& service_name) {
+  auto it = stats_.find(service_name);
+  if (it != stats_.end())
+    return &it->second;
+  // Keep one slot for "(other)".
+  if (stats_.size() + 1u >= kMaxServices)
+    return &stats_[kOtherServices];
+  return &stats_[service_name];
+}
+
+}  // namespace app
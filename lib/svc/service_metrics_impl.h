@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_SVC_SERVICE_METRICS_IMPL_H_
+#define APPLICATION_LIB_SVC_SERVICE_METRICS_IMPL_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "application/services/service_metrics.fidl.h"
+#include "lib/fidl/cpp/bindings/binding_set.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
+
+namespace app {
+
+// Counts the connections that |ServiceNamespace| and |ServiceProviderBridge|
+// make to each service name, and reports the busiest ones.
+//
+// At most |kMaxServices| names are tracked so that clients connecting to
+// arbitrary names cannot grow the counts without bound. Later names are
+// counted together under "(other)". Must be used on a single thread.
+class ServiceMetricsImpl : public ServiceMetrics {
+ public:
+  static constexpr size_t kMaxServices = 512u;
+
+  ServiceMetricsImpl();
+  ~ServiceMetricsImpl() override;
+
+  void AddBinding(fidl::InterfaceRequest<ServiceMetrics> request);
+
+  // Records a connection handed to the connector of |service_name|, which
+  // took |latency| to return.
+  void RecordConnect(const std::string& service_name, ftl::TimeDelta latency);
+
+  // Records a connection to |service_name| that nothing provided.
+  void RecordMiss(const std::string& service_name);
+
+  // Records a connection to |service_name| passed on to something else.
+  void RecordForward(const std::string& service_name);
+
+  // Returns up to |max_count| services, most connected first, with ties
+  // broken by name.
+  fidl::Array<ServiceStatsPtr> GetTop(size_t max_count) const;
+
+  // ServiceMetrics implementation:
+
+  void GetTopServices(uint32_t max_count,
+                      const GetTopServicesCallback& callback) override;
+  void Reset() override;
+
+ private:
+  struct Stats {
+    uint64_t connects = 0u;
+    uint64_t misses = 0u;
+    uint64_t forwards = 0u;
+    ftl::TimeDelta total_connector_latency;
+    ftl::TimeDelta max_connector_latency;
+  };
+
+  Stats* GetStats(const std::string& service_name);
+
+  std::unordered_map<std::string, Stats> stats_;
+  fidl::BindingSet<ServiceMetrics> bindings_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ServiceMetricsImpl);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_LIB_SVC_SERVICE_METRICS_IMPL_H_
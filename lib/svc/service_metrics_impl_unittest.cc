@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/svc/service_metrics_impl.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+
+namespace app {
+namespace {
+
+TEST(ServiceMetricsImpl, CountsPerService) {
+  ServiceMetricsImpl metrics;
+  metrics.RecordConnect("a", ftl::TimeDelta::FromMicroseconds(3));
+  metrics.RecordConnect("a", ftl::TimeDelta::FromMicroseconds(5));
+  metrics.RecordMiss("b");
+  metrics.RecordForward("c");
+  metrics.RecordForward("c");
+  metrics.RecordForward("c");
+
+  auto top = metrics.GetTop(10u);
+  ASSERT_EQ(3u, top.size());
+  EXPECT_EQ("c", top[0]->name.get());
+  EXPECT_EQ(3u, top[0]->forwards);
+  EXPECT_EQ("a", top[1]->name.get());
+  EXPECT_EQ(2u, top[1]->connects);
+  EXPECT_EQ(8000, top[1]->total_connector_latency);
+  EXPECT_EQ(5000, top[1]->max_connector_latency);
+  EXPECT_EQ("b", top[2]->name.get());
+  EXPECT_EQ(1u, top[2]->misses);
+}
+
+TEST(ServiceMetricsImpl, LimitsReport) {
+  ServiceMetricsImpl metrics;
+  metrics.RecordMiss("b");
+  metrics.RecordMiss("a");
+  metrics.RecordMiss("c");
+  metrics.RecordMiss("c");
+
+  auto top = metrics.GetTop(2u);
+  ASSERT_EQ(2u, top.size());
+  EXPECT_EQ("c", top[0]->name.get());
+  // Ties are broken by name.
+  EXPECT_EQ("a", top[1]->name.get());
+
+  metrics.Reset();
+  EXPECT_EQ(0u, metrics.GetTop(2u).size());
+}
+
+TEST(ServiceMetricsImpl, BoundsTrackedNames) {
+  ServiceMetricsImpl metrics;
+  for (size_t i = 0; i < 2 * ServiceMetricsImpl::kMaxServices; ++i)
+    metrics.RecordMiss(ftl::NumberToString(i));
+
+  auto top = metrics.GetTop(2 * ServiceMetricsImpl::kMaxServices);
+  ASSERT_EQ(ServiceMetricsImpl::kMaxServices, top.size());
+  EXPECT_EQ("(other)", top[0]->name.get());
+  EXPECT_EQ(ServiceMetricsImpl::kMaxServices + 1u, top[0]->misses);
+}
+
+}  // namespace
+}  // namespace app
@@ -11,6 +11,7 @@
 #include <utility>
 
 #include "lib/ftl/files/unique_fd.h"
+#include "lib/ftl/time/time_point.h"
 #include "lib/mtl/vfs/vfs_serve.h"
 
 namespace app {
@@ -98,8 +99,18 @@ void ServiceNamespace::ConnectToService(const fidl::String& service_name,
 void ServiceNamespace::ConnectCommon(const std::string& service_name,
                                      mx::channel channel) {
   auto it = name_to_service_connector_.find(service_name);
-  if (it != name_to_service_connector_.end())
-    it->second(std::move(channel));
+  if (!metrics_) {
+    if (it != name_to_service_connector_.end())
+      it->second(std::move(channel));
+    return;
+  }
+  if (it == name_to_service_connector_.end()) {
+    metrics_->RecordMiss(service_name);
+    return;
+  }
+  ftl::TimePoint start = ftl::TimePoint::Now();
+  it->second(std::move(channel));
+  metrics_->RecordConnect(service_name, ftl::TimePoint::Now() - start);
 }
 
 }  // namespace app
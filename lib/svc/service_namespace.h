@@ -14,6 +14,7 @@
 #include <unordered_map>
 #include <utility>
 
+#include "application/lib/svc/service_metrics_impl.h"
 #include "application/services/service_provider.fidl.h"
 #include "lib/fidl/cpp/bindings/binding_set.h"
 #include "lib/ftl/macros.h"
@@ -97,6 +98,11 @@ class ServiceNamespace : public svcfs::ServiceProvider,
     RemoveServiceForName(service_name);
   }
 
+  // Records the connections made through this namespace in |metrics|, which
+  // must outlive the namespace. Null disables recording.
+  void set_metrics(ServiceMetricsImpl* metrics) { metrics_ = metrics; }
+  ServiceMetricsImpl* metrics() const { return metrics_; }
+
   // Serves a directory containing these services on the given channel.
   //
   // Returns true on success.
@@ -119,6 +125,7 @@ class ServiceNamespace : public svcfs::ServiceProvider,
   void ConnectCommon(const std::string& service_name, mx::channel channel);
 
   std::unordered_map<std::string, ServiceConnector> name_to_service_connector_;
+  ServiceMetricsImpl* metrics_ = nullptr;
 
   mtl::VFSDispatcher dispatcher_;
   mxtl::RefPtr<svcfs::VnodeDir> directory_;
@@ -8,19 +8,83 @@
 #include <magenta/device/vfs.h>
 #include <mxio/util.h>
 
+#include <deque>
 #include <utility>
 
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/handles/object_info.h"
 #include "lib/mtl/vfs/vfs_serve.h"
 
 namespace app {
+namespace {
+
+constexpr size_t kMaxPendingRoutes = 256u;
+
+// Changes whenever a bridge changes the way it routes services, which
+// invalidates every cached route.
+uint64_t g_route_generation = 1u;
+
+// A connection that a bridge with a route cache forwarded to its backend,
+// waiting to be provided by another bridge.
+struct PendingRoute {
+  ftl::WeakPtr<ServiceProviderBridge> origin;
+  std::string service_name;
+};
+
+// Pending routes keyed by the koid of the forwarded channel, which stays the
+// same as the channel travels through the backends.
+struct PendingRoutes {
+  std::unordered_map<mx_koid_t, PendingRoute> routes;
+  // The keys of |routes| in insertion order, for eviction. May contain keys
+  // that have already been resolved.
+  std::deque<mx_koid_t> order;
+};
+
+PendingRoutes* GetPendingRoutes() {
+  static PendingRoutes* pending = new PendingRoutes();
+  return pending;
+}
+
+void AddPendingRoute(mx_koid_t koid, PendingRoute route) {
+  PendingRoutes* pending = GetPendingRoutes();
+  while (pending->order.size() >= kMaxPendingRoutes) {
+    pending->routes.erase(pending->order.front());
+    pending->order.pop_front();
+  }
+  pending->routes[koid] = std::move(route);
+  pending->order.push_back(koid);
+}
+
+}  // namespace
 
 ServiceProviderBridge::ServiceProviderBridge()
-    : directory_(mxtl::AdoptRef(new svcfs::VnodeProviderDir(&dispatcher_))) {
+    : directory_(mxtl::AdoptRef(new svcfs::VnodeProviderDir(&dispatcher_))),
+      weak_ptr_factory_(this) {
   directory_->SetServiceProvider(this);
 }
 
 ServiceProviderBridge::~ServiceProviderBridge() {
   directory_->SetServiceProvider(nullptr);
+  ++g_route_generation;
+}
+
+void ServiceProviderBridge::set_backend(app::ServiceProviderPtr backend) {
+  backend_ = std::move(backend);
+  ++g_route_generation;
+}
+
+void ServiceProviderBridge::InvalidateCachedRoutes() {
+  ++g_route_generation;
+}
+
+// static
+size_t ServiceProviderBridge::GetPendingRouteCountForTesting() {
+  return GetPendingRoutes()->routes.size();
+}
+
+void ServiceProviderBridge::set_registry(ServiceRegistryImpl* registry) {
+  registry_ = registry;
+  ++g_route_generation;
 }
 
 void ServiceProviderBridge::AddBinding(
@@ -31,6 +95,7 @@ void ServiceProviderBridge::AddBinding(
 void ServiceProviderBridge::AddServiceForName(ServiceConnector connector,
                                               const std::string& service_name) {
   name_to_service_connector_[service_name] = std::move(connector);
+  ++g_route_generation;
 }
 
 bool ServiceProviderBridge::ServeDirectory(mx::channel channel) const {
@@ -61,16 +126,73 @@ int ServiceProviderBridge::OpenAsFileDescriptor() {
 void ServiceProviderBridge::Connect(const char* name,
                                     size_t len,
                                     mx::channel channel) {
+  ++directory_connect_count_;
   ConnectToService(fidl::String(name, len), std::move(channel));
 }
 
 void ServiceProviderBridge::ConnectToService(const fidl::String& service_name,
                                              mx::channel channel) {
   auto it = name_to_service_connector_.find(service_name.get());
-  if (it != name_to_service_connector_.end())
+  if (it != name_to_service_connector_.end()) {
+    if (!GetPendingRoutes()->routes.empty())
+      ResolvePendingRoute(service_name.get(), channel);
+    if (!metrics_) {
+      it->second(std::move(channel));
+      return;
+    }
+    ftl::TimePoint start = ftl::TimePoint::Now();
     it->second(std::move(channel));
-  else
-    backend_->ConnectToService(std::move(service_name), std::move(channel));
+    metrics_->RecordConnect(service_name.get(), ftl::TimePoint::Now() - start);
+    return;
+  }
+
+  if (registry_ && registry_->ConnectToService(service_name.get(), &channel)) {
+    if (metrics_)
+      metrics_->RecordForward(service_name.get());
+    return;
+  }
+
+  if (cache_routes_) {
+    auto route_it = routes_.find(service_name.get());
+    if (route_it != routes_.end()) {
+      const Route& route = route_it->second;
+      if (route.provider && route.generation == g_route_generation) {
+        if (metrics_)
+          metrics_->RecordForward(service_name.get());
+        route.provider->ConnectToService(service_name, std::move(channel));
+        return;
+      }
+      routes_.erase(route_it);
+    }
+    AddPendingRoute(mtl::GetKoid(channel.get()),
+                    PendingRoute{weak_ptr_factory_.GetWeakPtr(),
+                                 service_name.get()});
+  }
+
+  if (!backend_) {
+    if (metrics_)
+      metrics_->RecordMiss(service_name.get());
+    return;
+  }
+  if (metrics_)
+    metrics_->RecordForward(service_name.get());
+  backend_->ConnectToService(std::move(service_name), std::move(channel));
+}
+
+void ServiceProviderBridge::ResolvePendingRoute(
+    const std::string& service_name,
+    const mx::channel& channel) {
+  PendingRoutes* pending = GetPendingRoutes();
+  auto it = pending->routes.find(mtl::GetKoid(channel.get()));
+  if (it == pending->routes.end())
+    return;
+  PendingRoute route = std::move(it->second);
+  pending->routes.erase(it);
+  if (route.origin && route.origin.get() != this &&
+      route.service_name == service_name) {
+    route.origin->routes_[service_name] =
+        Route{weak_ptr_factory_.GetWeakPtr(), g_route_generation};
+  }
 }
 
 }  // namespace app
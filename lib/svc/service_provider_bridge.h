@@ -14,9 +14,12 @@
 #include <unordered_map>
 #include <utility>
 
+#include "application/lib/svc/service_metrics_impl.h"
+#include "application/lib/svc/service_registry_impl.h"
 #include "application/services/service_provider.fidl.h"
 #include "lib/fidl/cpp/bindings/binding_set.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
 #include "lib/mtl/vfs/vfs_dispatcher.h"
 
 namespace app {
@@ -52,9 +55,44 @@ class ServiceProviderBridge : public svcfs::ServiceProvider,
         service_name);
   }
 
-  void set_backend(app::ServiceProviderPtr backend) {
-    backend_ = std::move(backend);
-  }
+  void set_backend(app::ServiceProviderPtr backend);
+
+  // Sets a registry to consult for services that the bridge does not provide
+  // itself, before forwarding them to the backend. Services in the registry
+  // are connected directly to the directories that provide them, so
+  // registered names take over services of the backend but never the bridge's
+  // own. The registry must outlive the bridge.
+  void set_registry(ServiceRegistryImpl* registry);
+
+  // Enables the route cache. When a service that this bridge forwards to its
+  // backend turns out to be provided by another bridge in this process, later
+  // connections to that service go straight to that bridge instead of through
+  // the chain of backends.
+  //
+  // The cache assumes that the backends forward a given service name the same
+  // way each time. Adding a service to or changing the backend of any bridge
+  // in the process invalidates every cached route. All bridges that take part
+  // must be used on the same thread.
+  void set_cache_routes(bool cache_routes) { cache_routes_ = cache_routes; }
+  bool cache_routes() const { return cache_routes_; }
+
+  // Records the connections made and forwarded by this bridge in |metrics|,
+  // which must outlive the bridge. Null disables recording.
+  void set_metrics(ServiceMetricsImpl* metrics) { metrics_ = metrics; }
+  ServiceMetricsImpl* metrics() const { return metrics_; }
+
+  // Invalidates every cached route in the process. Called when something that
+  // bridges consult, such as a registry, changes.
+  static void InvalidateCachedRoutes();
+
+  // Returns the number of connections made through the directory interface,
+  // which is how applications reach the services of their environment.
+  // Connections forwarded from other bridges are not counted.
+  uint64_t directory_connect_count() const { return directory_connect_count_; }
+
+  // Returns the number of forwarded connections whose provider has not been
+  // found yet, across the process. Bounded by an internal limit.
+  static size_t GetPendingRouteCountForTesting();
 
   void AddBinding(fidl::InterfaceRequest<app::ServiceProvider> request);
   bool ServeDirectory(mx::channel channel) const;
@@ -70,12 +108,30 @@ class ServiceProviderBridge : public svcfs::ServiceProvider,
   void ConnectToService(const fidl::String& service_name,
                         mx::channel channel) override;
 
+  struct Route {
+    ftl::WeakPtr<ServiceProviderBridge> provider;
+    uint64_t generation;
+  };
+
+  // Called when this bridge provides |service_name| on |channel| so that the
+  // bridge that forwarded the channel, if any, can learn the route.
+  void ResolvePendingRoute(const std::string& service_name,
+                           const mx::channel& channel);
+
   mtl::VFSDispatcher dispatcher_;
   fidl::BindingSet<app::ServiceProvider> bindings_;
   mxtl::RefPtr<svcfs::VnodeProviderDir> directory_;
 
   std::map<std::string, ServiceConnector> name_to_service_connector_;
   app::ServiceProviderPtr backend_;
+  ServiceRegistryImpl* registry_ = nullptr;
+  ServiceMetricsImpl* metrics_ = nullptr;
+  uint64_t directory_connect_count_ = 0u;
+
+  bool cache_routes_ = false;
+  std::unordered_map<std::string, Route> routes_;
+
+  ftl::WeakPtrFactory<ServiceProviderBridge> weak_ptr_factory_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ServiceProviderBridge);
 };
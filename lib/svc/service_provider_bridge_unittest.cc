@@ -0,0 +1,184 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/svc/service_provider_bridge.h"
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+constexpr char kService[] = "test.Service";
+// More connections than the bridges keep pending routes for.
+constexpr size_t kUnansweredCount = 300u;
+
+// A bridge that provides |kService| and counts the connections to it.
+class ProvidingBridge {
+ public:
+  ProvidingBridge() : bridge(std::make_unique<ServiceProviderBridge>()) {
+    bridge->AddServiceForName([this](mx::channel channel) { ++connects; },
+                              kService);
+  }
+
+  ServiceProviderPtr NewBackend() {
+    ServiceProviderPtr backend;
+    bridge->AddBinding(backend.NewRequest());
+    return backend;
+  }
+
+  std::unique_ptr<ServiceProviderBridge> bridge;
+  int connects = 0;
+};
+
+// Connects to |service_name| through |bridge| as a client of its directory
+// would. Connections that the bridge serves or routes itself are handled
+// before this returns; forwarded ones need the message loop to run.
+void Connect(ServiceProviderBridge* bridge,
+             const std::string& service_name = kService) {
+  mx::channel h1, h2;
+  ASSERT_EQ(MX_OK, mx::channel::create(0, &h1, &h2));
+  static_cast<app::ServiceProvider*>(bridge)->ConnectToService(
+      service_name, std::move(h1));
+}
+
+TEST(ServiceProviderBridge, CountsDirectoryConnections) {
+  mtl::MessageLoop message_loop;
+  ProvidingBridge provider;
+  ServiceProviderBridge bridge;
+  bridge.set_backend(provider.NewBackend());
+
+  mx::channel h1, h2;
+  ASSERT_EQ(MX_OK, mx::channel::create(0, &h1, &h2));
+  static_cast<svcfs::ServiceProvider*>(&bridge)->Connect(
+      kService, strlen(kService), std::move(h1));
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(1, provider.connects);
+  EXPECT_EQ(1u, bridge.directory_connect_count());
+
+  // Connections forwarded to the provider are not its applications'.
+  EXPECT_EQ(0u, provider.bridge->directory_connect_count());
+  Connect(&bridge);
+  EXPECT_EQ(1u, bridge.directory_connect_count());
+}
+
+TEST(ServiceProviderBridge, LearnsRouteToProvider) {
+  mtl::MessageLoop message_loop;
+  ProvidingBridge provider;
+  ServiceProviderBridge bridge;
+  bridge.set_cache_routes(true);
+  bridge.set_backend(provider.NewBackend());
+
+  // The first connection goes through the backend.
+  Connect(&bridge);
+  EXPECT_EQ(0, provider.connects);
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(1, provider.connects);
+
+  // Later ones go straight to the provider.
+  Connect(&bridge);
+  EXPECT_EQ(2, provider.connects);
+}
+
+TEST(ServiceProviderBridge, DoesNotCacheRoutesUnlessEnabled) {
+  mtl::MessageLoop message_loop;
+  ProvidingBridge provider;
+  ServiceProviderBridge bridge;
+  bridge.set_backend(provider.NewBackend());
+
+  Connect(&bridge);
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(1, provider.connects);
+
+  Connect(&bridge);
+  EXPECT_EQ(1, provider.connects);
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(2, provider.connects);
+}
+
+TEST(ServiceProviderBridge, ForgetsRoutesWhenRoutingChanges) {
+  mtl::MessageLoop message_loop;
+  ProvidingBridge provider;
+  ServiceProviderBridge bridge;
+  bridge.set_cache_routes(true);
+  bridge.set_backend(provider.NewBackend());
+
+  Connect(&bridge);
+  message_loop.RunUntilIdle();
+  ASSERT_EQ(1, provider.connects);
+
+  // Adding a service to any bridge invalidates the cached routes, so the
+  // next connection goes through the backend again and relearns the route.
+  ServiceProviderBridge other;
+  other.AddServiceForName([](mx::channel channel) {}, "test.Other");
+  Connect(&bridge);
+  EXPECT_EQ(1, provider.connects);
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(2, provider.connects);
+  Connect(&bridge);
+  EXPECT_EQ(3, provider.connects);
+
+  ServiceProviderBridge::InvalidateCachedRoutes();
+  Connect(&bridge);
+  EXPECT_EQ(3, provider.connects);
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(4, provider.connects);
+}
+
+TEST(ServiceProviderBridge, DropsRouteToDestroyedProvider) {
+  mtl::MessageLoop message_loop;
+  ProvidingBridge provider;
+  ServiceProviderBridge bridge;
+  bridge.set_cache_routes(true);
+  bridge.set_backend(provider.NewBackend());
+
+  Connect(&bridge);
+  message_loop.RunUntilIdle();
+  ASSERT_EQ(1, provider.connects);
+
+  // The route must not be used once its provider is gone. The connection
+  // goes to the backend, whose other end has been closed.
+  provider.bridge.reset();
+  Connect(&bridge);
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(1, provider.connects);
+}
+
+TEST(ServiceProviderBridge, BoundsPendingRoutes) {
+  mtl::MessageLoop message_loop;
+  ServiceProviderBridge bridge;
+  bridge.set_cache_routes(true);
+  // A backend that never answers leaves every forwarded connection pending.
+  // |backend_request| is kept open so that the connections stay queued.
+  ServiceProviderPtr backend;
+  auto backend_request = backend.NewRequest();
+  bridge.set_backend(std::move(backend));
+
+  for (size_t i = 0; i < kUnansweredCount; ++i)
+    Connect(&bridge, "test.Unknown" + ftl::NumberToString(i));
+  size_t pending = ServiceProviderBridge::GetPendingRouteCountForTesting();
+  EXPECT_GT(pending, 0u);
+  EXPECT_LT(pending, kUnansweredCount);
+
+  // Older pending routes have been evicted, but new ones are still learned.
+  ProvidingBridge provider;
+  ServiceProviderBridge learning;
+  learning.set_cache_routes(true);
+  learning.set_backend(provider.NewBackend());
+  Connect(&learning);
+  message_loop.RunUntilIdle();
+  ASSERT_EQ(1, provider.connects);
+  Connect(&learning);
+  EXPECT_EQ(2, provider.connects);
+}
+
+}  // namespace
+}  // namespace app
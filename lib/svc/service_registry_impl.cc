@@ -0,0 +1,101 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/svc/service_registry_impl.h"
+
+#include <mxio/util.h>
+
+#include <unordered_set>
+#include <utility>
+
+#include "application/lib/svc/service_provider_bridge.h"
+#include "lib/mtl/vfs/vfs_serve.h"
+
+namespace app {
+
+ServiceRegistryImpl::ServiceRegistryImpl()
+    : ServiceRegistryImpl(ServiceMap()) {}
+
+ServiceRegistryImpl::ServiceRegistryImpl(ServiceMap services)
+    : services_(std::move(services)),
+      directory_(mxtl::AdoptRef(new svcfs::VnodeProviderDir(&dispatcher_))) {
+  directory_->SetServiceProvider(this);
+}
+
+ServiceRegistryImpl::~ServiceRegistryImpl() {
+  directory_->SetServiceProvider(nullptr);
+}
+
+std::unique_ptr<ServiceRegistryImpl> ServiceRegistryImpl::Clone() const {
+  return std::unique_ptr<ServiceRegistryImpl>(
+      new ServiceRegistryImpl(services_));
+}
+
+void ServiceRegistryImpl::AddBinding(
+    fidl::InterfaceRequest<ServiceRegistry> request) {
+  bindings_.AddBinding(this, std::move(request));
+}
+
+bool ServiceRegistryImpl::ServeDirectory(mx::channel channel) const {
+  return mtl::VFSServe(directory_, std::move(channel));
+}
+
+bool ServiceRegistryImpl::ConnectToService(const std::string& service_name,
+                                           mx::channel* channel) {
+  const Directory* directory = services_.Find(service_name);
+  if (!directory)
+    return false;
+  mxio_service_connect_at((*directory)->get(), service_name.c_str(),
+                          channel->release());
+  return true;
+}
+
+void ServiceRegistryImpl::Duplicate(
+    fidl::InterfaceRequest<ServiceRegistry> services) {
+  AddBinding(std::move(services));
+}
+
+void ServiceRegistryImpl::Fork(
+    fidl::InterfaceRequest<ServiceRegistry> services) {
+  // The fork lives as long as someone is connected to it, so it is only
+  // created for a request that can be bound. A binding that never binds is
+  // never removed from the set, and would keep the fork alive forever.
+  if (!services.is_pending())
+    return;
+  ServiceRegistryImpl* fork = Clone().release();
+  fork->bindings_.set_on_empty_set_handler([fork] { delete fork; });
+  fork->AddBinding(std::move(services));
+}
+
+void ServiceRegistryImpl::Add(fidl::Array<fidl::String> names,
+                              mx::channel directory) {
+  if (!directory)
+    return;
+  auto shared = std::make_shared<const mx::channel>(std::move(directory));
+  for (const auto& name : names)
+    services_.Set(name.get(), shared);
+  ServiceProviderBridge::InvalidateCachedRoutes();
+}
+
+void ServiceRegistryImpl::Filter(fidl::Array<fidl::String> whitelist) {
+  std::unordered_set<std::string> names;
+  for (const auto& name : whitelist)
+    names.insert(name.get());
+  services_.Retain([&names](const std::string& name, const Directory&) {
+    return names.count(name) != 0u;
+  });
+  ServiceProviderBridge::InvalidateCachedRoutes();
+}
+
+void ServiceRegistryImpl::GetDirectory(mx::channel directory_request) {
+  ServeDirectory(std::move(directory_request));
+}
+
+void ServiceRegistryImpl::Connect(const char* name,
+                                  size_t len,
+                                  mx::channel channel) {
+  ConnectToService(std::string(name, len), &channel);
+}
+
+}  // namespace app
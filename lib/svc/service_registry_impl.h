@@ -0,0 +1,78 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_SVC_SERVICE_REGISTRY_IMPL_H_
+#define APPLICATION_LIB_SVC_SERVICE_REGISTRY_IMPL_H_
+
+#include <mx/channel.h>
+#include <mxtl/ref_ptr.h>
+#include <svcfs/svcfs.h>
+
+#include <memory>
+#include <string>
+
+#include "application/lib/svc/persistent_hash_map.h"
+#include "application/services/service_registry.fidl.h"
+#include "lib/fidl/cpp/bindings/binding_set.h"
+#include "lib/ftl/macros.h"
+#include "lib/mtl/vfs/vfs_dispatcher.h"
+
+namespace app {
+
+// Implements |ServiceRegistry| on top of a |PersistentHashMap|, which makes
+// forking a registry O(1) and lets filtering copy only the paths to the
+// services it removes.
+//
+// Each service is an entry in a directory that was given to |Add|.
+// Connections are made by opening the service in that directory.
+class ServiceRegistryImpl : public svcfs::ServiceProvider,
+                            public ServiceRegistry {
+ public:
+  ServiceRegistryImpl();
+  ~ServiceRegistryImpl() override;
+
+  // Returns a registry that starts with the services of this one. Later
+  // changes to either registry are not seen by the other.
+  std::unique_ptr<ServiceRegistryImpl> Clone() const;
+
+  void AddBinding(fidl::InterfaceRequest<ServiceRegistry> request);
+  bool ServeDirectory(mx::channel channel) const;
+
+  size_t size() const { return services_.size(); }
+
+  // Connects |channel| to |service_name| and returns true if the registry
+  // contains the service. Otherwise, returns false and leaves |channel|
+  // untouched.
+  bool ConnectToService(const std::string& service_name, mx::channel* channel);
+
+  // ServiceRegistry implementation:
+
+  void Duplicate(fidl::InterfaceRequest<ServiceRegistry> services) override;
+  void Fork(fidl::InterfaceRequest<ServiceRegistry> services) override;
+  void Add(fidl::Array<fidl::String> names, mx::channel directory) override;
+  void Filter(fidl::Array<fidl::String> whitelist) override;
+  void GetDirectory(mx::channel directory_request) override;
+
+ private:
+  // Shared by all the services added to the registry together.
+  using Directory = std::shared_ptr<const mx::channel>;
+  using ServiceMap = PersistentHashMap<Directory>;
+
+  explicit ServiceRegistryImpl(ServiceMap services);
+
+  // Overridden from |svcfs::ServiceProvider|:
+  void Connect(const char* name, size_t len, mx::channel channel) override;
+
+  ServiceMap services_;
+
+  mtl::VFSDispatcher dispatcher_;
+  mxtl::RefPtr<svcfs::VnodeProviderDir> directory_;
+  fidl::BindingSet<ServiceRegistry> bindings_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ServiceRegistryImpl);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_LIB_SVC_SERVICE_REGISTRY_IMPL_H_
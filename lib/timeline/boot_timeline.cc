@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/timeline/boot_timeline.h"
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace timeline {
+namespace {
+
+constexpr char kTimelineOption[] = "timeline";
+constexpr char kTimelineSecondsOption[] = "timeline-seconds";
+constexpr int64_t kDefaultTimelineSeconds = 30;
+
+}  // namespace
+
+BootTimeline::BootTimeline()
+    : delay_(ftl::TimeDelta::FromSeconds(kDefaultTimelineSeconds)) {}
+
+BootTimeline::~BootTimeline() {
+  if (recorder_ && Recorder::GetDefault() == recorder_.get())
+    Recorder::SetDefault(nullptr);
+}
+
+bool BootTimeline::InitFromCommandLine(const ftl::CommandLine& command_line,
+                                       size_t capacity) {
+  FTL_DCHECK(!recorder_);
+
+  std::string seconds_value;
+  if (command_line.GetOptionValue(kTimelineSecondsOption, &seconds_value)) {
+    int64_t seconds = 0;
+    if (!ftl::StringToNumberWithError(seconds_value, &seconds)) {
+      FTL_LOG(ERROR) << "Invalid --" << kTimelineSecondsOption
+                     << " value: " << seconds_value;
+      return false;
+    }
+    delay_ = ftl::TimeDelta::FromSeconds(seconds);
+  }
+
+  command_line.GetOptionValue(kTimelineOption, &path_);
+  if (!path_.empty()) {
+    recorder_ = std::make_unique<Recorder>(capacity);
+    Recorder::SetDefault(recorder_.get());
+  }
+  return true;
+}
+
+void BootTimeline::ScheduleWrite() {
+  if (!recorder_)
+    return;
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [this] { Write(); }, delay_);
+}
+
+void BootTimeline::Write() {
+  if (!recorder_->WriteChromeTrace(path_))
+    FTL_LOG(ERROR) << "Failed to write timeline to " << path_;
+}
+
+}  // namespace timeline
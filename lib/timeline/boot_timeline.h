@@ -0,0 +1,54 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_TIMELINE_BOOT_TIMELINE_H_
+#define APPLICATION_LIB_TIMELINE_BOOT_TIMELINE_H_
+
+#include <memory>
+#include <string>
+
+#include "application/lib/timeline/recorder.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
+
+namespace timeline {
+
+// Records boot events as requested on the command line of a program.
+//
+// With --timeline=<path>, a recorder is installed as the default for the
+// process, and its events are written to <path> in the Chrome trace format
+// once boot is expected to be over, --timeline-seconds (30 by default) after
+// ScheduleWrite() is called.
+class BootTimeline {
+ public:
+  BootTimeline();
+  ~BootTimeline();
+
+  // Reads the options from |command_line| and, with --timeline, installs a
+  // recorder that keeps the last |capacity| events. Returns false if the
+  // options are invalid.
+  bool InitFromCommandLine(const ftl::CommandLine& command_line,
+                           size_t capacity);
+
+  // Schedules writing the events on the current message loop, which must not
+  // outlive this object. Does nothing without --timeline.
+  void ScheduleWrite();
+
+  // Returns the installed recorder, or null without --timeline.
+  Recorder* recorder() const { return recorder_.get(); }
+
+ private:
+  void Write();
+
+  std::string path_;
+  ftl::TimeDelta delay_;
+  std::unique_ptr<Recorder> recorder_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(BootTimeline);
+};
+
+}  // namespace timeline
+
+#endif  // APPLICATION_LIB_TIMELINE_BOOT_TIMELINE_H_
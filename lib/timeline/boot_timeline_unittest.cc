@@ -0,0 +1,67 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/timeline/boot_timeline.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace timeline {
+namespace {
+
+ftl::CommandLine MakeCommandLine(std::vector<std::string> args) {
+  args.insert(args.begin(), "program");
+  return ftl::CommandLineFromIterators(args.begin(), args.end());
+}
+
+TEST(BootTimeline, DoesNothingWithoutOption) {
+  BootTimeline boot_timeline;
+  EXPECT_TRUE(boot_timeline.InitFromCommandLine(MakeCommandLine({}), 4u));
+  EXPECT_EQ(nullptr, boot_timeline.recorder());
+  EXPECT_EQ(nullptr, Recorder::GetDefault());
+}
+
+TEST(BootTimeline, RejectsInvalidSeconds) {
+  BootTimeline boot_timeline;
+  EXPECT_FALSE(boot_timeline.InitFromCommandLine(
+      MakeCommandLine({"--timeline=/tmp/timeline.json",
+                       "--timeline-seconds=soon"}),
+      4u));
+  EXPECT_EQ(nullptr, Recorder::GetDefault());
+}
+
+TEST(BootTimeline, InstallsRecorderAndWritesTrace) {
+  files::ScopedTempDir temp_dir;
+  std::string path;
+  ASSERT_TRUE(temp_dir.NewTempFile(&path));
+
+  mtl::MessageLoop message_loop;
+  {
+    BootTimeline boot_timeline;
+    ASSERT_TRUE(boot_timeline.InitFromCommandLine(
+        MakeCommandLine({"--timeline=" + path, "--timeline-seconds=0"}), 4u));
+    ASSERT_NE(nullptr, boot_timeline.recorder());
+    EXPECT_EQ(boot_timeline.recorder(), Recorder::GetDefault());
+
+    Instant("boot", "recorded");
+    boot_timeline.ScheduleWrite();
+    message_loop.task_runner()->PostDelayedTask(
+        [] { mtl::MessageLoop::GetCurrent()->QuitNow(); },
+        ftl::TimeDelta::FromMilliseconds(100));
+    message_loop.Run();
+  }
+  EXPECT_EQ(nullptr, Recorder::GetDefault());
+
+  std::string contents;
+  ASSERT_TRUE(files::ReadFileToString(path, &contents));
+  EXPECT_NE(std::string::npos, contents.find("\"recorded\""));
+}
+
+}  // namespace
+}  // namespace timeline
@@ -0,0 +1,145 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/timeline/recorder.h"
+
+#include <magenta/process.h>
+#include <magenta/threads.h>
+#include <threads.h>
+
+#include <utility>
+
+#include "lib/ftl/files/file.h"
+#include "lib/mtl/handles/object_info.h"
+#include "third_party/rapidjson/rapidjson/stringbuffer.h"
+#include "third_party/rapidjson/rapidjson/writer.h"
+
+namespace timeline {
+namespace {
+
+Recorder* g_default_recorder = nullptr;
+
+uint64_t GetCurrentThreadKoid() {
+  thread_local uint64_t koid =
+      mtl::GetKoid(thrd_get_mx_handle(thrd_current()));
+  return koid;
+}
+
+}  // namespace
+
+Recorder::Recorder(size_t capacity)
+    : capacity_(capacity ? capacity : 1u),
+      process_(mtl::GetKoid(mx_process_self())) {
+  events_.reserve(capacity_);
+}
+
+Recorder::~Recorder() = default;
+
+Recorder* Recorder::GetDefault() {
+  return g_default_recorder;
+}
+
+void Recorder::SetDefault(Recorder* recorder) {
+  g_default_recorder = recorder;
+}
+
+void Recorder::RecordInstant(const char* category,
+                             std::string name,
+                             std::string detail) {
+  Record(Event{'i', category, std::move(name), std::move(detail),
+               ftl::TimePoint::Now(), ftl::TimeDelta::Zero(),
+               GetCurrentThreadKoid()});
+}
+
+void Recorder::RecordComplete(const char* category,
+                              std::string name,
+                              std::string detail,
+                              ftl::TimePoint start) {
+  Record(Event{'X', category, std::move(name), std::move(detail), start,
+               ftl::TimePoint::Now() - start, GetCurrentThreadKoid()});
+}
+
+void Recorder::Record(Event event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (events_.size() < capacity_) {
+    events_.push_back(std::move(event));
+    return;
+  }
+  events_[next_] = std::move(event);
+  next_ = (next_ + 1) % capacity_;
+  ++dropped_count_;
+}
+
+uint64_t Recorder::dropped_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_count_;
+}
+
+std::string Recorder::ExportChromeTrace() const {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("traceEvents");
+  writer.StartArray();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < events_.size(); ++i) {
+      const Event& event = events_[(next_ + i) % events_.size()];
+      writer.StartObject();
+      writer.Key("name");
+      writer.String(event.name.data(), event.name.size());
+      writer.Key("cat");
+      writer.String(event.category);
+      writer.Key("ph");
+      writer.String(&event.phase, 1u);
+      writer.Key("ts");
+      writer.Int64(event.start.ToEpochDelta().ToMicroseconds());
+      if (event.phase == 'X') {
+        writer.Key("dur");
+        writer.Int64(event.duration.ToMicroseconds());
+      } else {
+        // Instant events are scoped to their thread.
+        writer.Key("s");
+        writer.String("t");
+      }
+      writer.Key("pid");
+      writer.Uint64(process_);
+      writer.Key("tid");
+      writer.Uint64(event.thread);
+      if (!event.detail.empty()) {
+        writer.Key("args");
+        writer.StartObject();
+        writer.Key("detail");
+        writer.String(event.detail.data(), event.detail.size());
+        writer.EndObject();
+      }
+      writer.EndObject();
+    }
+  }
+  writer.EndArray();
+  writer.EndObject();
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+bool Recorder::WriteChromeTrace(const std::string& path) const {
+  std::string trace = ExportChromeTrace();
+  return files::WriteFile(path, trace.data(), trace.size());
+}
+
+void Instant(const char* category, std::string name, std::string detail) {
+  if (Recorder* recorder = Recorder::GetDefault())
+    recorder->RecordInstant(category, std::move(name), std::move(detail));
+}
+
+void Complete(const char* category,
+              std::string name,
+              ftl::TimePoint start,
+              std::string detail) {
+  if (Recorder* recorder = Recorder::GetDefault()) {
+    recorder->RecordComplete(category, std::move(name), std::move(detail),
+                             start);
+  }
+}
+
+}  // namespace timeline
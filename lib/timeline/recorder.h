@@ -0,0 +1,99 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_TIMELINE_RECORDER_H_
+#define APPLICATION_LIB_TIMELINE_RECORDER_H_
+
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace timeline {
+
+// Records what happened when, for example during boot, so that it can be
+// viewed later in a trace viewer.
+//
+// Events are kept in memory in a ring buffer of fixed capacity; once it is
+// full, each new event replaces the oldest. Recording is safe from any thread.
+class Recorder {
+ public:
+  // Creates a recorder that keeps the last |capacity| events. A |capacity| of
+  // zero is treated as one.
+  explicit Recorder(size_t capacity);
+  ~Recorder();
+
+  // Returns the recorder installed for the process, or null if there is none.
+  static Recorder* GetDefault();
+
+  // Installs |recorder| as the recorder for the process. |recorder| must
+  // outlive every use of the free functions below.
+  static void SetDefault(Recorder* recorder);
+
+  // Records something that happened at a point in time. |category| must be a
+  // string literal.
+  void RecordInstant(const char* category,
+                     std::string name,
+                     std::string detail);
+
+  // Records something that took place between |start| and now.
+  void RecordComplete(const char* category,
+                      std::string name,
+                      std::string detail,
+                      ftl::TimePoint start);
+
+  // Returns the number of events that were replaced by newer ones.
+  uint64_t dropped_count() const;
+
+  // Returns the recorded events in the Chrome trace event format, oldest
+  // first.
+  std::string ExportChromeTrace() const;
+
+  // Writes the events to |path| in the Chrome trace event format.
+  bool WriteChromeTrace(const std::string& path) const;
+
+ private:
+  struct Event {
+    // 'i' for instant events and 'X' for complete events.
+    char phase;
+    const char* category;
+    std::string name;
+    std::string detail;
+    ftl::TimePoint start;
+    ftl::TimeDelta duration;
+    uint64_t thread;
+  };
+
+  void Record(Event event);
+
+  const size_t capacity_;
+  const uint64_t process_;
+
+  mutable std::mutex mutex_;
+  std::vector<Event> events_;  // Guarded by |mutex_|.
+  size_t next_ = 0u;           // Guarded by |mutex_|.
+  uint64_t dropped_count_ = 0u;  // Guarded by |mutex_|.
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(Recorder);
+};
+
+// Records an instant event with the default recorder, if one is installed.
+void Instant(const char* category,
+             std::string name,
+             std::string detail = std::string());
+
+// Records a complete event with the default recorder, if one is installed.
+void Complete(const char* category,
+              std::string name,
+              ftl::TimePoint start,
+              std::string detail = std::string());
+
+}  // namespace timeline
+
+#endif  // APPLICATION_LIB_TIMELINE_RECORDER_H_
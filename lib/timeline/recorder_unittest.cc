@@ -0,0 +1,68 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/timeline/recorder.h"
+
+#include "gtest/gtest.h"
+#include "third_party/rapidjson/rapidjson/document.h"
+
+namespace timeline {
+namespace {
+
+TEST(Recorder, ExportChromeTrace) {
+  Recorder recorder(8u);
+  recorder.RecordInstant("boot", "config", "/system/data/\"quoted\"");
+  recorder.RecordComplete("launch", "app", std::string(),
+                          ftl::TimePoint::Now());
+
+  rapidjson::Document document;
+  document.Parse(recorder.ExportChromeTrace());
+  ASSERT_TRUE(document.IsObject());
+  const auto& events = document["traceEvents"];
+  ASSERT_TRUE(events.IsArray());
+  ASSERT_EQ(2u, events.Size());
+
+  EXPECT_STREQ("config", events[0]["name"].GetString());
+  EXPECT_STREQ("boot", events[0]["cat"].GetString());
+  EXPECT_STREQ("i", events[0]["ph"].GetString());
+  EXPECT_STREQ("/system/data/\"quoted\"",
+               events[0]["args"]["detail"].GetString());
+
+  EXPECT_STREQ("app", events[1]["name"].GetString());
+  EXPECT_STREQ("X", events[1]["ph"].GetString());
+  EXPECT_TRUE(events[1].HasMember("dur"));
+  EXPECT_FALSE(events[1].HasMember("args"));
+}
+
+TEST(Recorder, KeepsNewestEvents) {
+  Recorder recorder(2u);
+  recorder.RecordInstant("boot", "first", std::string());
+  recorder.RecordInstant("boot", "second", std::string());
+  recorder.RecordInstant("boot", "third", std::string());
+  EXPECT_EQ(1u, recorder.dropped_count());
+
+  rapidjson::Document document;
+  document.Parse(recorder.ExportChromeTrace());
+  const auto& events = document["traceEvents"];
+  ASSERT_EQ(2u, events.Size());
+  EXPECT_STREQ("second", events[0]["name"].GetString());
+  EXPECT_STREQ("third", events[1]["name"].GetString());
+}
+
+TEST(Recorder, FreeFunctionsUseDefault) {
+  Instant("boot", "ignored");
+
+  Recorder recorder(4u);
+  Recorder::SetDefault(&recorder);
+  Instant("boot", "recorded");
+  Recorder::SetDefault(nullptr);
+
+  rapidjson::Document document;
+  document.Parse(recorder.ExportChromeTrace());
+  ASSERT_EQ(1u, document["traceEvents"].Size());
+  EXPECT_STREQ("recorded", document["traceEvents"][0]["name"].GetString());
+}
+
+}  // namespace
+}  // namespace timeline
@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/lib/vfs/dispatcher_pool.h"
+
+#include <future>
+
+#include "lib/ftl/strings/string_printf.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/threading/create_thread.h"
+
+namespace vfs {
+namespace {
+
+constexpr char kThreadNameFormat[] = "vfs-dispatcher-%zu";
+
+std::atomic<DispatcherPool*> g_default_pool;
+
+}  // namespace
+
+DispatcherPool::DispatcherPool(size_t thread_count) : next_thread_(0u) {
+  if (thread_count == 0u)
+    thread_count = 1u;
+  task_runners_.resize(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.push_back(mtl::CreateThread(
+        &task_runners_[i], ftl::StringPrintf(kThreadNameFormat, i)));
+    dispatchers_.push_back(std::make_unique<mtl::VFSDispatcher>());
+  }
+}
+
+DispatcherPool::~DispatcherPool() {
+  for (auto& task_runner : task_runners_)
+    task_runner->PostTask([] { mtl::MessageLoop::GetCurrent()->QuitNow(); });
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+DispatcherPool* DispatcherPool::GetDefault() {
+  return g_default_pool.load();
+}
+
+void DispatcherPool::SetDefault(DispatcherPool* pool) {
+  g_default_pool.store(pool);
+}
+
+mx_status_t DispatcherPool::AddVFSHandler(mx_handle_t h,
+                                          void* cb,
+                                          void* iostate) {
+  // mtl::VFSDispatcher registers handlers with the current message loop, so
+  // the registration has to happen on the thread that serves the connection.
+  // Connections opened from a connection the pool already serves stay on its
+  // thread. Waiting for another pool thread there could deadlock with a
+  // thread doing the same in the other direction.
+  for (size_t index = 0; index < task_runners_.size(); ++index) {
+    if (task_runners_[index]->RunsTasksOnCurrentThread())
+      return dispatchers_[index]->AddVFSHandler(h, cb, iostate);
+  }
+
+  size_t index = next_thread_.fetch_add(1u) % task_runners_.size();
+  mtl::VFSDispatcher* dispatcher = dispatchers_[index].get();
+  std::promise<mx_status_t> status;
+  task_runners_[index]->PostTask([dispatcher, h, cb, iostate, &status] {
+    status.set_value(dispatcher->AddVFSHandler(h, cb, iostate));
+  });
+  return status.get_future().get();
+}
+
+}  // namespace vfs
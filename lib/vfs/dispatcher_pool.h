@@ -0,0 +1,59 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_LIB_VFS_DISPATCHER_POOL_H_
+#define APPLICATION_LIB_VFS_DISPATCHER_POOL_H_
+
+#include <fs/dispatcher.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
+#include "lib/mtl/vfs/vfs_dispatcher.h"
+
+namespace vfs {
+
+// A dispatcher that serves VFS connections on a fixed set of threads.
+//
+// Each connection opened from outside the pool is served on one of the
+// threads, chosen in round-robin order, so many directories can share a few
+// threads. Connections opened through a connection the pool serves, such as
+// files opened in a served directory, stay on that connection's thread. Only
+// directories whose vnodes are safe to use from any thread, such as read-only
+// file systems, may be served from a pool.
+class DispatcherPool : public fs::Dispatcher {
+ public:
+  // Creates a pool with |thread_count| threads. A |thread_count| of zero is
+  // treated as one.
+  explicit DispatcherPool(size_t thread_count);
+  ~DispatcherPool() override;
+
+  // Returns the pool installed for the process, or null if there is none.
+  static DispatcherPool* GetDefault();
+
+  // Installs |pool| as the pool for the process. |pool| must outlive every
+  // directory created while it is installed.
+  static void SetDefault(DispatcherPool* pool);
+
+  // |fs::Dispatcher| implementation. Returns once the handler has been
+  // registered on its thread, with the result of the registration.
+  mx_status_t AddVFSHandler(mx_handle_t h, void* cb, void* iostate) override;
+
+ private:
+  std::vector<std::thread> threads_;
+  std::vector<ftl::RefPtr<ftl::TaskRunner>> task_runners_;
+  std::vector<std::unique_ptr<mtl::VFSDispatcher>> dispatchers_;
+  std::atomic<size_t> next_thread_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(DispatcherPool);
+};
+
+}  // namespace vfs
+
+#endif  // APPLICATION_LIB_VFS_DISPATCHER_POOL_H_
@@ -28,12 +28,13 @@ constexpr ftl::StringView kKnownCommands = "create, list, cat, or extract-file";
 // Options
 constexpr ftl::StringView kArchive = "archive";
 constexpr ftl::StringView kManifest = "manifest";
+constexpr ftl::StringView kBlobs = "blobs";
 constexpr ftl::StringView kFile = "file";
 constexpr ftl::StringView kOuput = "output";
 
 constexpr ftl::StringView kCatUsage = "cat --archive=<archive> --file=<path> ";
 constexpr ftl::StringView kCreateUsage =
-    "create --archive=<archive> --manifest=<manifest>";
+    "create --archive=<archive> --manifest=<manifest> [--blobs=<directory>]";
 constexpr ftl::StringView kListUsage = "list --archive=<archive>";
 constexpr ftl::StringView kExtractFileUsage =
     "extract-file --archive=<archive> --file=<path> --output=<path>";
@@ -63,6 +64,11 @@ int Create(const ftl::CommandLine& command_line) {
     return -1;
 
   archive::ArchiveWriter writer;
+  // With --blobs, the files are stored in the given directory, named by their
+  // hashes, and the archive only references them.
+  std::string blob_directory;
+  if (command_line.GetOptionValue(kBlobs, &blob_directory))
+    writer.set_blob_directory(blob_directory);
   for (const auto& manifest_path : manifest_paths) {
     if (!archive::ReadManifest(manifest_path, &writer))
       return -1;
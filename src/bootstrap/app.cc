@@ -10,9 +10,16 @@
 #include <magenta/process.h>
 #include <magenta/processargs.h>
 
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "application/lib/app/connect.h"
+#include "application/lib/timeline/recorder.h"
 #include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
 
 namespace bootstrap {
 namespace {
@@ -26,17 +33,57 @@ void LaunchNetstack(app::ServiceProvider* provider) {
   provider->ConnectToService("net.Netstack", std::move(h1));
 }
 
+// Orders the services to pre-warm, and the services they depend on, so that
+// each service comes after its dependencies. Services caught in a dependency
+// cycle come last.
+std::vector<std::string> OrderPrewarm(const Config::PrewarmMap& prewarm) {
+  std::map<std::string, std::set<std::string>> pending;
+  for (const auto& entry : prewarm) {
+    auto& dependencies = pending[entry.first];
+    for (const auto& dependency : entry.second) {
+      dependencies.insert(dependency);
+      pending[dependency];
+    }
+  }
+
+  std::vector<std::string> order;
+  while (!pending.empty()) {
+    std::vector<std::string> ready;
+    for (const auto& entry : pending) {
+      if (entry.second.empty())
+        ready.push_back(entry.first);
+    }
+    if (ready.empty()) {
+      FTL_LOG(WARNING) << "Pre-warmed services depend on each other in a cycle";
+      for (const auto& entry : pending)
+        order.push_back(entry.first);
+      break;
+    }
+    for (const auto& name : ready) {
+      pending.erase(name);
+      for (auto& entry : pending)
+        entry.second.erase(name);
+      order.push_back(name);
+    }
+  }
+  return order;
+}
+
 }  // namespace
 
 constexpr char kDefaultLabel[] = "boot";
 constexpr char kConfigDir[] = "/system/data/bootstrap/";
+constexpr char kConfigSnapshot[] = "/system/data/bootstrap.snapshot";
 
 App::App()
     : application_context_(app::ApplicationContext::CreateFromStartupInfo()),
-      env_host_binding_(this) {
+      env_host_binding_(this),
+      weak_ptr_factory_(this) {
   FTL_DCHECK(application_context_);
 
   Config config;
+  // The snapshot is optional; without it, the config files are parsed.
+  config.LoadSnapshot(kConfigSnapshot);
   char buf[PATH_MAX];
   if (strlcpy(buf, kConfigDir, PATH_MAX) >= PATH_MAX) {
     FTL_LOG(ERROR) << "Config directory path too long";
@@ -69,19 +116,21 @@ App::App()
       kDefaultLabel);
   env_->GetApplicationLauncher(env_launcher_.NewRequest());
 
-  // Register services.
-  for (auto& pair : config.TakeServices())
+  // Register services, starting the hot ones right away.
+  idle_timeouts_ = config.TakeIdleTimeouts();
+  auto services = config.TakeServices();
+  Prewarm(config.TakePrewarm(), services);
+  for (auto& pair : services)
     RegisterSingleton(pair.first, std::move(pair.second));
 
   // Ordering note: The impl of CreateNestedEnvironment will resolve the
   // delegating app loader. However, since its call back to the env host won't
   // happen until the next (first) message loop iteration, we'll be set up by
   // then.
-  RegisterAppLoaders(config.TakeAppLoaders());
+  RegisterAppLoaders(config.TakeAppLoaders(), config.loader_cache());
 
   // Launch startup applications.
-  for (auto& launch_info : config.TakeApps())
-    LaunchApplication(std::move(launch_info));
+  LaunchApplications(config.TakeApps());
 
   // TODO(abarth): Remove this hard-coded mention of netstack once netstack is
   // fully converted to using service namespaces.
@@ -94,43 +143,129 @@ void App::RegisterSingleton(std::string service_name,
                             app::ApplicationLaunchInfoPtr launch_info) {
   env_services_.AddServiceForName(
       ftl::MakeCopyable([
-        this, service_name, launch_info = std::move(launch_info),
-        controller = app::ApplicationControllerPtr()
+        this, service_name, launch_info = std::move(launch_info)
       ](mx::channel client_handle) mutable {
         FTL_VLOG(2) << "Servicing singleton service request for "
                     << service_name;
-        auto it = services_.find(launch_info->url);
-        if (it == services_.end()) {
+        Singleton* singleton;
+        auto it = singletons_.find(launch_info->url);
+        if (it == singletons_.end()) {
           FTL_VLOG(1) << "Starting singleton " << launch_info->url
                       << " for service " << service_name;
-          app::Services services;
-          auto dup_launch_info = app::ApplicationLaunchInfo::New();
-          dup_launch_info->url = launch_info->url;
-          dup_launch_info->arguments = launch_info->arguments.Clone();
-          dup_launch_info->service_request = services.NewRequest();
-          env_launcher_->CreateApplication(std::move(dup_launch_info),
-                                           controller.NewRequest());
-          controller.set_connection_error_handler(
-              [ this, url = launch_info->url, &controller ] {
-                FTL_LOG(ERROR) << "Singleton " << url << " died";
-                controller.reset();  // kills the singleton application
-                services_.erase(url);
-              });
-
-          std::tie(it, std::ignore) =
-              services_.emplace(launch_info->url, std::move(services));
+          timeline::Instant("singleton-start", launch_info->url,
+                            service_name);
+          singleton = StartSingleton(*launch_info);
+        } else {
+          singleton = it->second.get();
         }
 
-        it->second.ConnectToService(service_name, std::move(client_handle));
+        if (!singleton->connect_count) {
+          timeline::Instant("singleton-first-connect", launch_info->url,
+                            service_name);
+        }
+        if (singleton->prewarmed && !singleton->connect_count) {
+          FTL_VLOG(1) << "Pre-warmed singleton " << launch_info->url
+                      << " first used "
+                      << (ftl::TimePoint::Now() - singleton->start_time)
+                             .ToMilliseconds()
+                      << " ms after it was started";
+        }
+        ++singleton->connect_count;
+        singleton->last_connect_time = ftl::TimePoint::Now();
+        singleton->services.ConnectToService(service_name,
+                                             std::move(client_handle));
       }),
       service_name);
 }
 
-void App::RegisterAppLoaders(Config::ServiceMap app_loaders) {
+App::Singleton* App::StartSingleton(
+    const app::ApplicationLaunchInfo& launch_info) {
+  auto singleton = std::make_unique<Singleton>();
+  singleton->start_time = ftl::TimePoint::Now();
+  singleton->last_connect_time = singleton->start_time;
+  singleton->generation = next_singleton_generation_++;
+  auto dup_launch_info = app::ApplicationLaunchInfo::New();
+  dup_launch_info->url = launch_info.url;
+  dup_launch_info->arguments = launch_info.arguments.Clone();
+  dup_launch_info->service_request = singleton->services.NewRequest();
+  env_launcher_->CreateApplication(std::move(dup_launch_info),
+                                   singleton->controller.NewRequest());
+  singleton->controller.set_connection_error_handler(
+      [ this, url = launch_info.url ] {
+        FTL_LOG(ERROR) << "Singleton " << url << " died";
+        timeline::Instant("singleton-exit", url);
+        // Erasing the singleton destroys this handler, so copy |url| first.
+        std::string dead_url = url;
+        singletons_.erase(dead_url);  // kills the singleton application
+      });
+
+  auto timeout_it = idle_timeouts_.find(launch_info.url);
+  if (timeout_it != idle_timeouts_.end())
+    ScheduleIdleCheck(launch_info.url, singleton->generation,
+                      timeout_it->second);
+
+  Singleton* result = singleton.get();
+  singletons_[launch_info.url] = std::move(singleton);
+  return result;
+}
+
+void App::Prewarm(const Config::PrewarmMap& prewarm,
+                  const Config::ServiceMap& services) {
+  // The launches are all requested now so that they overlap. appmgr starts
+  // them in the order requested, so dependencies get going first.
+  for (const auto& service_name : OrderPrewarm(prewarm)) {
+    auto it = services.find(service_name);
+    if (it == services.end()) {
+      FTL_LOG(WARNING) << "Cannot pre-warm unknown service " << service_name;
+      continue;
+    }
+    if (singletons_.count(it->second->url))
+      continue;
+    FTL_VLOG(1) << "Pre-warming singleton " << it->second->url
+                << " for service " << service_name;
+    timeline::Instant("singleton-prewarm", it->second->url, service_name);
+    StartSingleton(*it->second)->prewarmed = true;
+  }
+}
+
+void App::ScheduleIdleCheck(const std::string& url,
+                            uint64_t generation,
+                            ftl::TimeDelta delay) {
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [ weak_this = weak_ptr_factory_.GetWeakPtr(), url, generation ] {
+        if (weak_this)
+          weak_this->CheckIdle(url, generation);
+      },
+      delay);
+}
+
+void App::CheckIdle(const std::string& url, uint64_t generation) {
+  auto it = singletons_.find(url);
+  // The chain of checks ends with the instance it was started for.
+  if (it == singletons_.end() || it->second->generation != generation)
+    return;
+  const Singleton& singleton = *it->second;
+  ftl::TimeDelta timeout = idle_timeouts_[url];
+  ftl::TimeDelta idle = ftl::TimePoint::Now() - singleton.last_connect_time;
+  if (idle < timeout) {
+    ScheduleIdleCheck(url, generation, timeout - idle);
+    return;
+  }
+
+  FTL_LOG(INFO) << "Stopping singleton " << url << " after "
+                << idle.ToSeconds() << " idle seconds and "
+                << singleton.connect_count << " connections; it will be "
+                << "restarted on the next connection";
+  singletons_.erase(it);  // kills the singleton application
+}
+
+void App::RegisterAppLoaders(Config::ServiceMap app_loaders,
+                             Config::LoaderCacheConfig cache_config) {
   app_loader_ = std::make_unique<DelegatingApplicationLoader>(
       std::move(app_loaders), env_launcher_.get(),
       application_context_
-          ->ConnectToEnvironmentService<app::ApplicationLoader>());
+          ->ConnectToEnvironmentService<app::ApplicationLoader>(),
+      std::move(cache_config));
 
   env_services_.AddService<app::ApplicationLoader>(
       [this](fidl::InterfaceRequest<app::ApplicationLoader> request) {
@@ -138,9 +273,17 @@ void App::RegisterAppLoaders(Config::ServiceMap app_loaders) {
       });
 }
 
-void App::LaunchApplication(app::ApplicationLaunchInfoPtr launch_info) {
-  FTL_VLOG(1) << "Bootstrapping application " << launch_info->url;
-  env_launcher_->CreateApplication(std::move(launch_info), nullptr);
+void App::LaunchApplications(Config::AppVector apps) {
+  if (apps.empty())
+    return;
+  auto requests = fidl::Array<app::ApplicationLaunchRequestPtr>::New(0);
+  for (auto& launch_info : apps) {
+    FTL_VLOG(1) << "Bootstrapping application " << launch_info->url;
+    auto request = app::ApplicationLaunchRequest::New();
+    request->launch_info = std::move(launch_info);
+    requests.push_back(std::move(request));
+  }
+  env_launcher_->CreateApplications(std::move(requests));
 }
 
 void App::GetApplicationEnvironmentServices(
@@ -16,6 +16,8 @@
 #include "application/services/application_environment.fidl.h"
 #include "application/src/bootstrap/delegating_application_loader.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_point.h"
 
 namespace bootstrap {
 
@@ -24,7 +26,8 @@ namespace bootstrap {
 //
 // The nested environment consists of the following system applications
 // which are started on demand then retained as singletons for the lifetime
-// of the environment.
+// of the environment, or until they have been idle for their configured idle
+// timeout.
 //
 // After setting up the nested environment, the bootstrap starts the app
 // specified on the command-line.
@@ -39,16 +42,41 @@ class App : public app::ApplicationEnvironmentHost {
       fidl::InterfaceRequest<app::ServiceProvider> environment_services)
       override;
 
+  // A running singleton application.
+  struct Singleton {
+    app::Services services;
+    app::ApplicationControllerPtr controller;
+    // Connections made to the singleton's services since it started.
+    uint64_t connect_count = 0u;
+    ftl::TimePoint start_time;
+    ftl::TimePoint last_connect_time;
+    // Whether the singleton was started ahead of its first connection.
+    bool prewarmed = false;
+    // Distinguishes this instance from earlier instances of the same URL, so
+    // that their pending idle checks do not apply to it.
+    uint64_t generation = 0u;
+  };
+
   void RegisterSingleton(std::string service_name,
                          app::ApplicationLaunchInfoPtr launch_info);
+  Singleton* StartSingleton(const app::ApplicationLaunchInfo& launch_info);
+  void Prewarm(const Config::PrewarmMap& prewarm,
+               const Config::ServiceMap& services);
+  void ScheduleIdleCheck(const std::string& url,
+                         uint64_t generation,
+                         ftl::TimeDelta delay);
+  void CheckIdle(const std::string& url, uint64_t generation);
   void RegisterDefaultServiceConnector();
-  void RegisterAppLoaders(Config::ServiceMap app_loaders);
-  void LaunchApplication(app::ApplicationLaunchInfoPtr launch_info);
+  void RegisterAppLoaders(Config::ServiceMap app_loaders,
+                          Config::LoaderCacheConfig cache_config);
+  void LaunchApplications(Config::AppVector apps);
 
   std::unique_ptr<app::ApplicationContext> application_context_;
 
-  // Keep track of all services, indexed by url.
-  std::map<std::string, app::Services> services_;
+  // Keep track of all running singletons, indexed by url.
+  std::map<std::string, std::unique_ptr<Singleton>> singletons_;
+  Config::IdleTimeoutMap idle_timeouts_;
+  uint64_t next_singleton_generation_ = 1u;
 
   // Nested environment within which the apps started by Bootstrap will run.
   app::ApplicationEnvironmentPtr env_;
@@ -60,6 +88,8 @@ class App : public app::ApplicationEnvironmentHost {
   std::unique_ptr<DelegatingApplicationLoader> app_loader_;
   fidl::BindingSet<app::ApplicationLoader> app_loader_bindings_;
 
+  ftl::WeakPtrFactory<App> weak_ptr_factory_;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(App);
 };
 
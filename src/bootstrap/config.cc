@@ -6,7 +6,10 @@
 
 #include <utility>
 
+#include "application/lib/timeline/recorder.h"
 #include "lib/ftl/files/file.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/time/time_point.h"
 #include "third_party/rapidjson/rapidjson/document.h"
 
 namespace bootstrap {
@@ -15,9 +18,14 @@ namespace {
 constexpr char kAppLoaders[] = "loaders";
 constexpr char kApps[] = "apps";
 constexpr char kServices[] = "services";
+constexpr char kIdleTimeouts[] = "idle-timeouts";
+constexpr char kPrewarm[] = "prewarm";
+constexpr char kLoaderCache[] = "loader-cache";
+constexpr char kTtlSeconds[] = "ttl-seconds";
+constexpr char kMaxBytes[] = "max-bytes";
 
-app::ApplicationLaunchInfoPtr GetLaunchInfo(
-    const rapidjson::Document::ValueType& value) {
+template <typename Value>
+app::ApplicationLaunchInfoPtr GetLaunchInfo(const Value& value) {
   auto launch_info = app::ApplicationLaunchInfo::New();
   if (value.IsString()) {
     launch_info->url = value.GetString();
@@ -37,7 +45,8 @@ app::ApplicationLaunchInfoPtr GetLaunchInfo(
   return launch_info;
 }
 
-bool ParseServiceMap(const rapidjson::Document& document,
+template <typename Value>
+bool ParseServiceMap(const Value& document,
                      const std::string& key,
                      Config::ServiceMap* services) {
   auto it = document.FindMember(key);
@@ -65,16 +74,37 @@ Config::Config() = default;
 Config::~Config() = default;
 
 bool Config::ReadFrom(const std::string& config_file) {
+  ftl::TimePoint start = ftl::TimePoint::Now();
   std::string data;
-  return files::ReadFileToString(config_file, &data) &&
-         Parse(data, config_file);
+  if (!files::ReadFileToString(config_file, &data))
+    return false;
+  json_snapshot::Value root;
+  if (snapshot_.Find(config_file, data, &root)) {
+    if (!ParseDocument(root))
+      return false;
+  } else if (!Parse(data, config_file)) {
+    return false;
+  }
+  timeline::Complete("config", config_file, start);
+  return true;
+}
+
+bool Config::LoadSnapshot(const std::string& path) {
+  return snapshot_.Load(path);
 }
 
 bool Config::Parse(const std::string& string, const std::string& config_file) {
   rapidjson::Document document;
   document.Parse(string);
-  FTL_CHECK(!document.HasParseError())
-      << "Could not parse file at " << config_file;
+  if (document.HasParseError()) {
+    FTL_LOG(ERROR) << "Could not parse file at " << config_file;
+    return false;
+  }
+  return ParseDocument(document);
+}
+
+template <typename Value>
+bool Config::ParseDocument(const Value& document) {
   if (!(document.IsObject() &&
         ParseServiceMap(document, kServices, &services_) &&
         ParseServiceMap(document, kAppLoaders, &app_loaders_)))
@@ -93,6 +123,55 @@ bool Config::Parse(const std::string& string, const std::string& config_file) {
     }
   }
 
+  auto idle_timeouts_it = document.FindMember(kIdleTimeouts);
+  if (idle_timeouts_it != document.MemberEnd()) {
+    const auto& value = idle_timeouts_it->value;
+    if (!value.IsObject())
+      return false;
+    for (const auto& entry : value.GetObject()) {
+      if (!entry.value.IsUint() || entry.value.GetUint() == 0u)
+        return false;
+      idle_timeouts_[entry.name.GetString()] =
+          ftl::TimeDelta::FromSeconds(entry.value.GetUint());
+    }
+  }
+
+  auto prewarm_it = document.FindMember(kPrewarm);
+  if (prewarm_it != document.MemberEnd()) {
+    const auto& value = prewarm_it->value;
+    if (!value.IsObject())
+      return false;
+    for (const auto& entry : value.GetObject()) {
+      if (!entry.value.IsArray())
+        return false;
+      auto& dependencies = prewarm_[entry.name.GetString()];
+      for (const auto& dependency : entry.value.GetArray()) {
+        if (!dependency.IsString())
+          return false;
+        dependencies.push_back(dependency.GetString());
+      }
+    }
+  }
+
+  auto loader_cache_it = document.FindMember(kLoaderCache);
+  if (loader_cache_it != document.MemberEnd()) {
+    const auto& value = loader_cache_it->value;
+    if (!value.IsObject())
+      return false;
+    auto ttl_it = value.FindMember(kTtlSeconds);
+    if (ttl_it != value.MemberEnd()) {
+      if (!ttl_it->value.IsUint())
+        return false;
+      loader_cache_.ttl = ftl::TimeDelta::FromSeconds(ttl_it->value.GetUint());
+    }
+    auto max_bytes_it = value.FindMember(kMaxBytes);
+    if (max_bytes_it != value.MemberEnd()) {
+      if (!max_bytes_it->value.IsUint64())
+        return false;
+      loader_cache_.max_bytes = max_bytes_it->value.GetUint64();
+    }
+  }
+
   return true;
 }
 
@@ -8,9 +8,12 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "application/lib/json_snapshot/snapshot.h"
 #include "application/services/application_launcher.fidl.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
 
 namespace bootstrap {
 
@@ -22,10 +25,26 @@ class Config {
   using ServiceMap =
       std::unordered_map<std::string, app::ApplicationLaunchInfoPtr>;
   using AppVector = std::vector<app::ApplicationLaunchInfoPtr>;
+  using IdleTimeoutMap = std::unordered_map<std::string, ftl::TimeDelta>;
+  // Maps services to pre-warm to the services they depend on.
+  using PrewarmMap =
+      std::unordered_map<std::string, std::vector<std::string>>;
+
+  // How packages loaded by app loaders are kept for reuse. Caching is off
+  // unless |max_bytes| is set.
+  struct LoaderCacheConfig {
+    ftl::TimeDelta ttl = ftl::TimeDelta::FromSeconds(60);
+    uint64_t max_bytes = 0u;
+  };
 
   Config();
   ~Config();
 
+  // Loads a snapshot made by config_compiler. Config files that the snapshot
+  // holds with their current contents are then read from the snapshot instead
+  // of being parsed.
+  bool LoadSnapshot(const std::string& path);
+
   bool ReadFrom(const std::string& config_file);
 
   bool Parse(const std::string& data, const std::string& config_file);
@@ -33,11 +52,21 @@ class Config {
   ServiceMap TakeServices() { return std::move(services_); }
   ServiceMap TakeAppLoaders() { return std::move(app_loaders_); }
   AppVector TakeApps() { return std::move(apps_); }
+  IdleTimeoutMap TakeIdleTimeouts() { return std::move(idle_timeouts_); }
+  PrewarmMap TakePrewarm() { return std::move(prewarm_); }
+  const LoaderCacheConfig& loader_cache() const { return loader_cache_; }
 
  private:
+  template <typename Value>
+  bool ParseDocument(const Value& document);
+
   ServiceMap services_;
   ServiceMap app_loaders_;
   AppVector apps_;
+  IdleTimeoutMap idle_timeouts_;
+  PrewarmMap prewarm_;
+  LoaderCacheConfig loader_cache_;
+  json_snapshot::Snapshot snapshot_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(Config);
 };
@@ -4,7 +4,12 @@
 
 #include "application/src/bootstrap/delegating_application_loader.h"
 
+#include <magenta/syscalls.h>
+
+#include <utility>
+
 #include "application/lib/app/connect.h"
+#include "application/lib/timeline/recorder.h"
 #include "lib/url/gurl.h"
 
 namespace bootstrap {
@@ -12,8 +17,11 @@ namespace bootstrap {
 DelegatingApplicationLoader::DelegatingApplicationLoader(
     Config::ServiceMap delegates,
     app::ApplicationLauncher* delegate_launcher,
-    app::ApplicationLoaderPtr fallback)
-    : delegate_launcher_(delegate_launcher), fallback_(std::move(fallback)) {
+    app::ApplicationLoaderPtr fallback,
+    Config::LoaderCacheConfig cache_config)
+    : delegate_launcher_(delegate_launcher),
+      fallback_(std::move(fallback)),
+      cache_(std::move(cache_config)) {
   for (auto& pair : delegates) {
     auto& record = delegate_instances_[pair.second->url];
     record.launch_info = std::move(pair.second);
@@ -30,11 +38,30 @@ void DelegatingApplicationLoader::LoadApplication(
   if (gurl.is_valid()) {
     auto it = delegates_by_scheme_.find(gurl.scheme());
     if (it != delegates_by_scheme_.end()) {
+      if (cache_.enabled()) {
+        mx::vmo data = cache_.Get(url);
+        if (data) {
+          auto package = app::ApplicationPackage::New();
+          package->data = std::move(data);
+          callback(std::move(package));
+          return;
+        }
+      }
+
+      auto& waiting = pending_loads_[url];
+      waiting.push_back(callback);
+      if (waiting.size() > 1u)
+        return;  // a load of |url| is already in flight
+
       auto* record = it->second;
       if (!record->loader) {
         StartDelegate(record);
       }
-      record->loader->LoadApplication(url, callback);
+      std::string key = url;
+      record->loader->LoadApplication(
+          url, [this, key](app::ApplicationPackagePtr package) {
+            OnDelegateLoaded(key, std::move(package));
+          });
       return;
     }
   }
@@ -42,8 +69,64 @@ void DelegatingApplicationLoader::LoadApplication(
   fallback_->LoadApplication(url, callback);
 }
 
+void DelegatingApplicationLoader::OnDelegateLoaded(
+    const std::string& url,
+    app::ApplicationPackagePtr package) {
+  auto it = pending_loads_.find(url);
+  if (it == pending_loads_.end())
+    return;
+  std::vector<LoadApplicationCallback> callbacks = std::move(it->second);
+  pending_loads_.erase(it);
+
+  if (!package || (!package->data && !package->range_reader)) {
+    for (const auto& callback : callbacks)
+      callback(nullptr);
+    return;
+  }
+
+  if (!package->data) {
+    // A package that is read by range has a single reader, so it can be
+    // neither shared nor cached. The other waiters load it on their own.
+    callbacks[0](std::move(package));
+    auto delegate_it = delegates_by_scheme_.find(url::GURL(url).scheme());
+    for (size_t i = 1; i < callbacks.size(); ++i)
+      delegate_it->second->loader->LoadApplication(url, callbacks[i]);
+    return;
+  }
+
+  mx::vmo data = cache_.Put(url, std::move(package->data));
+  uint64_t size = 0u;
+  data.get_size(&size);
+  for (size_t i = 0; i < callbacks.size(); ++i) {
+    auto waiter_package = app::ApplicationPackage::New();
+    if (i + 1 == callbacks.size()) {
+      waiter_package->data = std::move(data);
+    } else {
+      // Each waiter gets its own copy-on-write clone so that none of them can
+      // see changes made by another.
+      mx_handle_t clone = MX_HANDLE_INVALID;
+      mx_vmo_clone(data.get(), MX_VMO_CLONE_COPY_ON_WRITE, 0u, size, &clone);
+      waiter_package->data = mx::vmo(clone);
+    }
+    callbacks[i](std::move(waiter_package));
+  }
+}
+
+void DelegatingApplicationLoader::FailPendingLoads(
+    ApplicationLoaderRecord* record) {
+  std::vector<std::string> urls;
+  for (const auto& pair : pending_loads_) {
+    auto it = delegates_by_scheme_.find(url::GURL(pair.first).scheme());
+    if (it != delegates_by_scheme_.end() && it->second == record)
+      urls.push_back(pair.first);
+  }
+  for (const auto& url : urls)
+    OnDelegateLoaded(url, nullptr);
+}
+
 void DelegatingApplicationLoader::StartDelegate(
     ApplicationLoaderRecord* record) {
+  timeline::Instant("loader-start", record->launch_info->url);
   app::ServiceProviderPtr service_provider;
   auto dup_launch_info = app::ApplicationLaunchInfo::New();
   dup_launch_info->url = record->launch_info->url;
@@ -58,6 +141,7 @@ void DelegatingApplicationLoader::StartDelegate(
     // proactively kill the loader app entirely if its ApplicationLoader died on
     // us
     record->controller.reset();
+    FailPendingLoads(record);
   });
 }
 
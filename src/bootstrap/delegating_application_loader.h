@@ -5,9 +5,14 @@
 #ifndef APPLICATION_SRC_BOOTSTRAP_DELEGATING_APPLICATION_LOADER_H_
 #define APPLICATION_SRC_BOOTSTRAP_DELEGATING_APPLICATION_LOADER_H_
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "application/services/application_launcher.fidl.h"
 #include "application/services/application_loader.fidl.h"
 #include "application/src/bootstrap/config.h"
+#include "application/src/bootstrap/package_cache.h"
 #include "lib/ftl/macros.h"
 
 namespace bootstrap {
@@ -19,12 +24,18 @@ namespace bootstrap {
 // This loader executes in the bootstrap environment, reads a config file, and
 // can delegate mapped URI schemes to app loaders capable of handling them,
 // falling back on the root app loader for unmapped schemes.
+//
+// Concurrent loads of the same URL from a delegate share a single request to
+// the delegate, and packages loaded by delegates may be cached according to
+// |Config::LoaderCacheConfig|. Packages that delegates hand out for reading
+// by range are neither shared nor cached.
 class DelegatingApplicationLoader : public app::ApplicationLoader {
  public:
   explicit DelegatingApplicationLoader(
       Config::ServiceMap delegates,
       app::ApplicationLauncher* delegate_launcher,
-      app::ApplicationLoaderPtr fallback);
+      app::ApplicationLoaderPtr fallback,
+      Config::LoaderCacheConfig cache_config);
   ~DelegatingApplicationLoader() override;
 
   // |ApplicationLoader|:
@@ -40,6 +51,11 @@ class DelegatingApplicationLoader : public app::ApplicationLoader {
   };
 
   void StartDelegate(ApplicationLoaderRecord* record);
+  // Answers the loads of |url| that are waiting on a delegate.
+  void OnDelegateLoaded(const std::string& url,
+                        app::ApplicationPackagePtr package);
+  // Fails the loads waiting on |record| after its loader has gone away.
+  void FailPendingLoads(ApplicationLoaderRecord* record);
 
   // indexed by URL. This ignores differentiation by args but is on par with the
   // bootstrap app implementation.
@@ -53,6 +69,12 @@ class DelegatingApplicationLoader : public app::ApplicationLoader {
   std::unordered_map<std::string, ApplicationLoaderRecord*>
       delegates_by_scheme_;
 
+  // Callbacks waiting on a delegate, indexed by the URL being loaded.
+  std::unordered_map<std::string, std::vector<LoadApplicationCallback>>
+      pending_loads_;
+
+  PackageCache cache_;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(DelegatingApplicationLoader);
 };
 
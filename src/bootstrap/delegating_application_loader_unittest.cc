@@ -0,0 +1,227 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/bootstrap/delegating_application_loader.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "application/lib/app/service_provider_impl.h"
+#include "gtest/gtest.h"
+#include "lib/fidl/cpp/bindings/binding_set.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace bootstrap {
+namespace {
+
+constexpr char kScheme[] = "test";
+constexpr char kLoaderUrl[] = "file:///system/apps/test_loader";
+constexpr char kPackageUrl[] = "test://package";
+constexpr char kContents[] = "package";
+
+// Stands in for a loader application. Loads are held until the test answers
+// them.
+class FakeLoader : public app::ApplicationLoader {
+ public:
+  void LoadApplication(const fidl::String& url,
+                       const LoadApplicationCallback& callback) override {
+    urls.push_back(url);
+    callbacks.push_back(callback);
+  }
+
+  // Answers the oldest load with a package holding |kContents|.
+  void AnswerWithPackage() {
+    mx::vmo data;
+    ASSERT_EQ(MX_OK, mx::vmo::create(sizeof(kContents), 0u, &data));
+    size_t actual = 0u;
+    ASSERT_EQ(MX_OK, data.write(kContents, 0u, sizeof(kContents), &actual));
+    auto package = app::ApplicationPackage::New();
+    package->data = std::move(data);
+    Answer(std::move(package));
+  }
+
+  // Answers the oldest load with a package to be read by range.
+  void AnswerWithRangeReader() {
+    app::PackageByteRangeReaderPtr reader;
+    reader_requests.push_back(reader.NewRequest());
+    auto package = app::ApplicationPackage::New();
+    package->range_reader = reader.PassInterfaceHandle();
+    package->size = sizeof(kContents);
+    Answer(std::move(package));
+  }
+
+  void Answer(app::ApplicationPackagePtr package) {
+    ASSERT_FALSE(callbacks.empty());
+    auto callback = callbacks.front();
+    callbacks.erase(callbacks.begin());
+    callback(std::move(package));
+  }
+
+  fidl::BindingSet<app::ApplicationLoader> bindings;
+  std::vector<std::string> urls;
+  std::vector<LoadApplicationCallback> callbacks;
+  std::vector<fidl::InterfaceRequest<app::PackageByteRangeReader>>
+      reader_requests;
+};
+
+// Serves |loader| from every application it is asked to launch.
+class FakeLauncher : public app::ApplicationLauncher {
+ public:
+  explicit FakeLauncher(FakeLoader* loader) : loader_(loader) {}
+
+  void CreateApplication(
+      app::ApplicationLaunchInfoPtr launch_info,
+      fidl::InterfaceRequest<app::ApplicationController> controller) override {
+    ++launch_count;
+    auto services = std::make_unique<app::ServiceProviderImpl>(
+        std::move(launch_info->services));
+    services->AddService<app::ApplicationLoader>(
+        [this](fidl::InterfaceRequest<app::ApplicationLoader> request) {
+          loader_->bindings.AddBinding(loader_, std::move(request));
+        });
+    services_.push_back(std::move(services));
+  }
+
+  void CreateApplications(
+      fidl::Array<app::ApplicationLaunchRequestPtr> requests) override {}
+
+  int launch_count = 0;
+
+ private:
+  FakeLoader* const loader_;
+  std::vector<std::unique_ptr<app::ServiceProviderImpl>> services_;
+};
+
+Config::ServiceMap MakeDelegates() {
+  Config::ServiceMap delegates;
+  auto launch_info = app::ApplicationLaunchInfo::New();
+  launch_info->url = kLoaderUrl;
+  delegates[kScheme] = std::move(launch_info);
+  return delegates;
+}
+
+std::string ReadContents(const app::ApplicationPackagePtr& package) {
+  if (!package || !package->data)
+    return std::string();
+  std::string contents(sizeof(kContents), '\0');
+  size_t actual = 0u;
+  package->data.read(&contents[0], 0u, contents.size(), &actual);
+  contents.resize(actual);
+  return contents;
+}
+
+class DelegatingApplicationLoaderTest : public ::testing::Test {
+ protected:
+  DelegatingApplicationLoaderTest() : launcher_(&delegate_) {}
+
+  std::unique_ptr<DelegatingApplicationLoader> MakeLoader(
+      uint64_t cache_bytes) {
+    Config::LoaderCacheConfig cache_config;
+    cache_config.max_bytes = cache_bytes;
+    return std::make_unique<DelegatingApplicationLoader>(
+        MakeDelegates(), &launcher_, app::ApplicationLoaderPtr(),
+        std::move(cache_config));
+  }
+
+  // Loads |kPackageUrl| and stores the result in |packages_|.
+  void Load(DelegatingApplicationLoader* loader) {
+    loader->LoadApplication(kPackageUrl,
+                            [this](app::ApplicationPackagePtr package) {
+                              packages_.push_back(std::move(package));
+                            });
+  }
+
+  mtl::MessageLoop message_loop_;
+  FakeLoader delegate_;
+  FakeLauncher launcher_;
+  std::vector<app::ApplicationPackagePtr> packages_;
+};
+
+TEST_F(DelegatingApplicationLoaderTest, CoalescesConcurrentLoads) {
+  auto loader = MakeLoader(0u);
+  Load(loader.get());
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(1, launcher_.launch_count);
+  ASSERT_EQ(1u, delegate_.urls.size());
+  EXPECT_EQ(kPackageUrl, delegate_.urls[0]);
+
+  delegate_.AnswerWithPackage();
+  message_loop_.RunUntilIdle();
+  ASSERT_EQ(2u, packages_.size());
+  EXPECT_EQ(std::string(kContents, sizeof(kContents)),
+            ReadContents(packages_[0]));
+  EXPECT_EQ(std::string(kContents, sizeof(kContents)),
+            ReadContents(packages_[1]));
+  EXPECT_NE(packages_[0]->data.get(), packages_[1]->data.get());
+
+  // Without a cache, a later load goes back to the delegate.
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(2u, delegate_.urls.size());
+}
+
+TEST_F(DelegatingApplicationLoaderTest, ServesLaterLoadsFromCache) {
+  auto loader = MakeLoader(64 * 1024u);
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+  delegate_.AnswerWithPackage();
+  message_loop_.RunUntilIdle();
+  ASSERT_EQ(1u, packages_.size());
+
+  Load(loader.get());
+  ASSERT_EQ(2u, packages_.size());
+  EXPECT_EQ(std::string(kContents, sizeof(kContents)),
+            ReadContents(packages_[1]));
+  EXPECT_EQ(1u, delegate_.urls.size());
+}
+
+TEST_F(DelegatingApplicationLoaderTest, FailsAllWaitersOfFailedLoad) {
+  auto loader = MakeLoader(64 * 1024u);
+  Load(loader.get());
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+
+  delegate_.Answer(nullptr);
+  message_loop_.RunUntilIdle();
+  ASSERT_EQ(2u, packages_.size());
+  EXPECT_FALSE(packages_[0]);
+  EXPECT_FALSE(packages_[1]);
+
+  // Failures are not cached.
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(2u, delegate_.urls.size());
+}
+
+TEST_F(DelegatingApplicationLoaderTest, PassesRangeReadersThrough) {
+  auto loader = MakeLoader(64 * 1024u);
+  Load(loader.get());
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+  ASSERT_EQ(1u, delegate_.urls.size());
+
+  // The reader goes to the first waiter, and the second loads on its own.
+  delegate_.AnswerWithRangeReader();
+  message_loop_.RunUntilIdle();
+  ASSERT_EQ(1u, packages_.size());
+  EXPECT_FALSE(packages_[0]->data);
+  EXPECT_TRUE(packages_[0]->range_reader);
+  ASSERT_EQ(2u, delegate_.urls.size());
+
+  delegate_.AnswerWithRangeReader();
+  message_loop_.RunUntilIdle();
+  ASSERT_EQ(2u, packages_.size());
+  EXPECT_TRUE(packages_[1]->range_reader);
+
+  // Nothing was cached.
+  Load(loader.get());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(3u, delegate_.urls.size());
+}
+
+}  // namespace
+}  // namespace bootstrap
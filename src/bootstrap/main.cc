@@ -2,18 +2,30 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "application/lib/timeline/boot_timeline.h"
 #include "application/src/bootstrap/app.h"
 #include "lib/ftl/command_line.h"
 #include "lib/ftl/log_settings.h"
 #include "lib/mtl/tasks/message_loop.h"
 
+constexpr size_t kTimelineCapacity = 1024u;
+
 int main(int argc, const char** argv) {
   auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
   if (!ftl::SetLogSettingsFromCommandLine(command_line))
     return 1;
 
+  // With --timeline, boot events are recorded and written to the given path
+  // once boot is expected to be over.
+  timeline::BootTimeline boot_timeline;
+  if (!boot_timeline.InitFromCommandLine(command_line, kTimelineCapacity))
+    return 1;
+
   mtl::MessageLoop loop;
   bootstrap::App app;
+
+  boot_timeline.ScheduleWrite();
+
   loop.Run();
   return 0;
 }
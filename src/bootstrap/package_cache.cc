@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/bootstrap/package_cache.h"
+
+#include <magenta/syscalls.h>
+
+#include <utility>
+
+namespace bootstrap {
+namespace {
+
+mx::vmo Clone(const mx::vmo& vmo, uint64_t size) {
+  mx_handle_t result = MX_HANDLE_INVALID;
+  mx_vmo_clone(vmo.get(), MX_VMO_CLONE_COPY_ON_WRITE, 0u, size, &result);
+  return mx::vmo(result);
+}
+
+}  // namespace
+
+PackageCache::PackageCache(Config::LoaderCacheConfig config)
+    : config_(std::move(config)) {}
+
+PackageCache::~PackageCache() = default;
+
+mx::vmo PackageCache::Get(const std::string& url) {
+  auto it = entries_.find(url);
+  if (it == entries_.end())
+    return mx::vmo();
+  Entry& entry = it->second;
+
+  if (ftl::TimePoint::Now() - entry.load_time > config_.ttl) {
+    Erase(it);
+    return mx::vmo();
+  }
+
+  lru_.splice(lru_.begin(), lru_, entry.lru_position);
+  return Clone(entry.data, entry.size);
+}
+
+mx::vmo PackageCache::Put(const std::string& url, mx::vmo data) {
+  uint64_t size = 0u;
+  if (!enabled() || !data || data.get_size(&size) != MX_OK ||
+      size > config_.max_bytes)
+    return data;
+
+  mx::vmo clone = Clone(data, size);
+  if (!clone)
+    return data;
+
+  auto it = entries_.find(url);
+  if (it != entries_.end())
+    Erase(it);
+  while (total_bytes_ + size > config_.max_bytes && !lru_.empty())
+    Erase(entries_.find(lru_.back()));
+
+  lru_.push_front(url);
+  Entry& entry = entries_[url];
+  entry.data = std::move(clone);
+  entry.size = size;
+  entry.load_time = ftl::TimePoint::Now();
+  entry.lru_position = lru_.begin();
+  total_bytes_ += size;
+  return data;
+}
+
+void PackageCache::Erase(std::unordered_map<std::string, Entry>::iterator it) {
+  total_bytes_ -= it->second.size;
+  lru_.erase(it->second.lru_position);
+  entries_.erase(it);
+}
+
+}  // namespace bootstrap
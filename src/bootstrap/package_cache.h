@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_BOOTSTRAP_PACKAGE_CACHE_H_
+#define APPLICATION_SRC_BOOTSTRAP_PACKAGE_CACHE_H_
+
+#include <mx/vmo.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "application/src/bootstrap/config.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace bootstrap {
+
+// Keeps recently loaded packages so that launching them again does not go
+// back to the loader that fetched them.
+//
+// The cache holds a copy-on-write clone of each package taken when it is put,
+// and hands out clones of that, so neither the loader nor the callers can
+// change the cached copy. Entries expire after
+// |Config::LoaderCacheConfig::ttl|, and the least recently used entries are
+// evicted to stay within |Config::LoaderCacheConfig::max_bytes|.
+class PackageCache {
+ public:
+  explicit PackageCache(Config::LoaderCacheConfig config);
+  ~PackageCache();
+
+  bool enabled() const { return config_.max_bytes != 0u; }
+
+  // Returns a clone of the package loaded from |url|, or an invalid VMO if
+  // there is no fresh entry for |url|.
+  mx::vmo Get(const std::string& url);
+
+  // Caches a clone of |data|, the package loaded from |url|. Returns |data|
+  // to give to the caller. Nothing is cached if |data| is invalid, as it is
+  // for packages read by range.
+  mx::vmo Put(const std::string& url, mx::vmo data);
+
+ private:
+  struct Entry {
+    mx::vmo data;
+    uint64_t size;
+    ftl::TimePoint load_time;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  void Erase(std::unordered_map<std::string, Entry>::iterator it);
+
+  const Config::LoaderCacheConfig config_;
+  std::unordered_map<std::string, Entry> entries_;
+  // Cached URLs, most recently used first.
+  std::list<std::string> lru_;
+  uint64_t total_bytes_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PackageCache);
+};
+
+}  // namespace bootstrap
+
+#endif  // APPLICATION_SRC_BOOTSTRAP_PACKAGE_CACHE_H_
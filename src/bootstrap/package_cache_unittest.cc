@@ -0,0 +1,91 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/bootstrap/package_cache.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace bootstrap {
+namespace {
+
+constexpr uint64_t kPackageSize = 4096u;
+
+mx::vmo MakePackage(const std::string& contents) {
+  mx::vmo vmo;
+  EXPECT_EQ(MX_OK, mx::vmo::create(kPackageSize, 0u, &vmo));
+  size_t actual = 0u;
+  EXPECT_EQ(MX_OK, vmo.write(contents.data(), 0u, contents.size(), &actual));
+  return vmo;
+}
+
+std::string ReadPackage(const mx::vmo& vmo, size_t length) {
+  std::string contents(length, '\0');
+  size_t actual = 0u;
+  EXPECT_EQ(MX_OK, vmo.read(&contents[0], 0u, length, &actual));
+  contents.resize(actual);
+  return contents;
+}
+
+Config::LoaderCacheConfig CacheConfig(uint64_t max_packages) {
+  Config::LoaderCacheConfig config;
+  config.max_bytes = max_packages * kPackageSize;
+  return config;
+}
+
+TEST(PackageCache, KeepsNothingWhenDisabled) {
+  PackageCache cache(Config::LoaderCacheConfig{});
+  EXPECT_FALSE(cache.enabled());
+
+  mx::vmo data = cache.Put("test://a", MakePackage("a"));
+  EXPECT_TRUE(data);
+  EXPECT_FALSE(cache.Get("test://a"));
+}
+
+TEST(PackageCache, ReturnsCopyTakenOnPut) {
+  PackageCache cache(CacheConfig(1u));
+  mx::vmo data = cache.Put("test://a", MakePackage("before"));
+  ASSERT_TRUE(data);
+
+  // Writes to the loaded package do not reach the cached copy.
+  size_t actual = 0u;
+  EXPECT_EQ(MX_OK, data.write("after!", 0u, 6u, &actual));
+
+  mx::vmo cached = cache.Get("test://a");
+  ASSERT_TRUE(cached);
+  EXPECT_EQ("before", ReadPackage(cached, 6u));
+
+  // Nor do writes to a copy that was handed out.
+  EXPECT_EQ(MX_OK, cached.write("after!", 0u, 6u, &actual));
+  EXPECT_EQ("before", ReadPackage(cache.Get("test://a"), 6u));
+}
+
+TEST(PackageCache, EvictsLeastRecentlyUsed) {
+  PackageCache cache(CacheConfig(2u));
+  cache.Put("test://a", MakePackage("a"));
+  cache.Put("test://b", MakePackage("b"));
+  EXPECT_TRUE(cache.Get("test://a"));
+
+  cache.Put("test://c", MakePackage("c"));
+  EXPECT_TRUE(cache.Get("test://a"));
+  EXPECT_FALSE(cache.Get("test://b"));
+  EXPECT_TRUE(cache.Get("test://c"));
+}
+
+TEST(PackageCache, DropsExpiredEntries) {
+  Config::LoaderCacheConfig config = CacheConfig(1u);
+  config.ttl = ftl::TimeDelta::Zero();
+  PackageCache cache(std::move(config));
+  cache.Put("test://a", MakePackage("a"));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_FALSE(cache.Get("test://a"));
+}
+
+}  // namespace
+}  // namespace bootstrap
@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compiles the JSON config files of appmgr and bootstrap into a snapshot that
+// they load without parsing. Each config file is given as
+// <path on device>=<path to source>, for example:
+//
+//   config_compiler --output=bootstrap.snapshot \
+//     /system/data/bootstrap/services.config=src/bootstrap/services.config
+//
+// appmgr looks for the snapshot next to its config file, with a ".snapshot"
+// suffix, and bootstrap at /system/data/bootstrap.snapshot. A config file
+// whose contents no longer match the snapshot is parsed as usual.
+
+#include <stdio.h>
+
+#include <string>
+
+#include "application/lib/json_snapshot/snapshot_writer.h"
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/files/file.h"
+
+namespace {
+
+constexpr char kOutput[] = "output";
+constexpr char kUsage[] =
+    "Usage: config_compiler --output=<snapshot> "
+    "<path on device>=<source file>...\n";
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+
+  std::string output;
+  if (!command_line.GetOptionValue(kOutput, &output) ||
+      command_line.positional_args().empty()) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+
+  json_snapshot::SnapshotWriter writer;
+  for (const auto& arg : command_line.positional_args()) {
+    size_t separator = arg.find('=');
+    if (separator == std::string::npos || separator == 0u ||
+        separator + 1 == arg.size()) {
+      fprintf(stderr, "error: Invalid config file argument: %s\n%s",
+              arg.c_str(), kUsage);
+      return 1;
+    }
+    std::string device_path = arg.substr(0, separator);
+    std::string source_path = arg.substr(separator + 1);
+
+    std::string contents;
+    if (!files::ReadFileToString(source_path, &contents)) {
+      fprintf(stderr, "error: Failed to read %s\n", source_path.c_str());
+      return 1;
+    }
+    std::string error;
+    if (!writer.AddDocument(device_path, contents, &error)) {
+      fprintf(stderr, "error: Failed to parse %s: %s\n", source_path.c_str(),
+              error.c_str());
+      return 1;
+    }
+  }
+
+  std::string snapshot = writer.Finish();
+  if (!files::WriteFile(output, snapshot.data(), snapshot.size())) {
+    fprintf(stderr, "error: Failed to write %s\n", output.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -6,9 +6,13 @@
 
 #include <utility>
 
+#include "application/lib/timeline/recorder.h"
 #include "application/src/manager/application_environment_impl.h"
+#include "application/src/manager/task_stats.h"
 #include "lib/ftl/functional/closure.h"
-#include "lib/mtl/tasks/message_loop.h"
+#include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/logging.h"
+#include "lib/mtl/handles/object_info.h"
 
 namespace app {
 
@@ -17,14 +21,19 @@ ApplicationControllerImpl::ApplicationControllerImpl(
     ApplicationEnvironmentImpl* environment,
     std::unique_ptr<archive::FileSystem> fs,
     mx::process process,
-    std::string path)
+    std::string path,
+    ftl::TimeDelta launch_latency)
     : binding_(this),
       environment_(environment),
       fs_(std::move(fs)),
       process_(std::move(process)),
-      path_(std::move(path)) {
-  termination_handler_ = mtl::MessageLoop::GetCurrent()->AddHandler(
-      this, process_.get(), MX_TASK_TERMINATED);
+      path_(std::move(path)),
+      koid_(mtl::GetKoid(process_.get())),
+      start_time_(ftl::TimePoint::Now()),
+      launch_latency_(launch_latency),
+      last_active_time_(start_time_) {
+  termination_key_ =
+      environment_->termination_watcher()->Watch(process_, this);
   if (request.is_pending()) {
     binding_.Bind(std::move(request));
     binding_.set_connection_error_handler([this] { Kill(); });
@@ -32,15 +41,48 @@ ApplicationControllerImpl::ApplicationControllerImpl(
 }
 
 ApplicationControllerImpl::~ApplicationControllerImpl() {
-  mtl::MessageLoop::GetCurrent()->RemoveHandler(termination_handler_);
+  environment_->termination_watcher()->Unwatch(termination_key_);
   // Two ways we end up here:
-  // 1) OnHandleReady() destroys this object; in which case, process is dead.
+  // 1) OnProcessTerminated() destroys this object; in which case, process is
+  //    dead.
   // 2) Our owner destroys this object; in which case, the process may still be
   //    alive.
   if (process_)
     process_.kill();
 }
 
+void ApplicationControllerImpl::SampleMemory(uint64_t bytes,
+                                             ftl::TimePoint now) {
+  if (bytes != last_memory_bytes_)
+    last_active_time_ = now;
+  last_memory_bytes_ = bytes;
+}
+
+ApplicationInfoPtr ApplicationControllerImpl::GetInfo() const {
+  auto info = ApplicationInfo::New();
+  info->koid = koid_;
+  info->url = path_;
+  info->uptime = (ftl::TimePoint::Now() - start_time_).ToNanoseconds();
+  info->launch_latency = launch_latency_.ToNanoseconds();
+  info->memory_bytes = GetPrivateMemoryBytes(process_);
+  info->idle = (ftl::TimePoint::Now() - last_active_time_).ToNanoseconds();
+  return info;
+}
+
+void ApplicationControllerImpl::ServePackageWhenFetched(
+    std::unique_ptr<PackageFetcher> fetcher,
+    mx::channel pkg_request) {
+  package_fetcher_ = std::move(fetcher);
+  package_fetcher_->OnComplete(ftl::MakeCopyable(
+      [this, pkg_request = std::move(pkg_request)](bool success) mutable {
+        if (!success || !fs_ || !fs_->Serve(std::move(pkg_request))) {
+          FTL_LOG(ERROR) << "Killing " << path_
+                         << " because its package could not be fetched";
+          Kill();
+        }
+      }));
+}
+
 void ApplicationControllerImpl::Kill() {
   process_.kill();
 }
@@ -50,11 +92,9 @@ void ApplicationControllerImpl::Detach() {
 }
 
 // Called when process terminates, regardless of if Kill() was invoked.
-void ApplicationControllerImpl::OnHandleReady(mx_handle_t handle,
-                                              mx_signals_t pending) {
-  FTL_DCHECK(handle == process_.get());
-  FTL_DCHECK(pending & MX_TASK_TERMINATED);
-
+void ApplicationControllerImpl::OnProcessTerminated() {
+  timeline::Instant("exit", path_);
+  termination_key_ = 0u;
   process_.reset();
 
   environment_->ExtractApplication(this);
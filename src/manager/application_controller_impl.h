@@ -9,42 +9,74 @@
 
 #include "application/lib/farfs/file_system.h"
 #include "application/services/application_controller.fidl.h"
+#include "application/services/environment_inspector.fidl.h"
+#include "application/src/manager/package_fetcher.h"
+#include "application/src/manager/termination_watcher.h"
 #include "lib/fidl/cpp/bindings/binding.h"
 #include "lib/ftl/macros.h"
-#include "lib/mtl/tasks/message_loop.h"
-#include "lib/mtl/tasks/message_loop_handler.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
 
 namespace app {
 class ApplicationEnvironmentImpl;
 
 class ApplicationControllerImpl : public ApplicationController,
-                                  public mtl::MessageLoopHandler {
+                                  public TerminationWatcher::Listener {
  public:
   ApplicationControllerImpl(
       fidl::InterfaceRequest<ApplicationController> request,
       ApplicationEnvironmentImpl* environment,
       std::unique_ptr<archive::FileSystem> fs,
       mx::process process,
-      std::string path);
+      std::string path,
+      ftl::TimeDelta launch_latency);
   ~ApplicationControllerImpl() override;
 
   const std::string& path() const { return path_; }
+  const mx::process& process() const { return process_; }
+  // The koid of the application's process.
+  uint64_t koid() const { return koid_; }
+
+  // The last time the application was seen to be active, or the time it was
+  // started.
+  ftl::TimePoint last_active_time() const { return last_active_time_; }
+
+  // Records a measurement of the application's private memory. A change since
+  // the previous measurement counts as activity.
+  void SampleMemory(uint64_t bytes, ftl::TimePoint now);
+
+  // Records activity seen by other means than memory use.
+  void RecordActivity(ftl::TimePoint now) { last_active_time_ = now; }
+
+  ApplicationInfoPtr GetInfo() const;
+
+  // Serves the package directory on |pkg_request| once |fetcher| has fetched
+  // the whole package. Kills the application if the package cannot be
+  // fetched.
+  void ServePackageWhenFetched(std::unique_ptr<PackageFetcher> fetcher,
+                               mx::channel pkg_request);
 
   // |ApplicationController| implementation:
   void Kill() override;
   void Detach() override;
 
  private:
-  // |mtl::MessageLoopHandler| implementation:
-  void OnHandleReady(mx_handle_t handle, mx_signals_t pending) override;
+  // |TerminationWatcher::Listener| implementation:
+  void OnProcessTerminated() override;
 
   fidl::Binding<ApplicationController> binding_;
   ApplicationEnvironmentImpl* environment_;
   std::unique_ptr<archive::FileSystem> fs_;
+  std::unique_ptr<PackageFetcher> package_fetcher_;
   mx::process process_;
   std::string path_;
+  uint64_t koid_;
+  ftl::TimePoint start_time_;
+  ftl::TimeDelta launch_latency_;
+  ftl::TimePoint last_active_time_;
+  uint64_t last_memory_bytes_ = 0u;
 
-  mtl::MessageLoop::HandlerKey termination_handler_ = 0u;
+  TerminationWatcher::Key termination_key_ = 0u;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationControllerImpl);
 };
@@ -36,6 +36,11 @@ void ApplicationEnvironmentControllerImpl::Kill(const KillCallback& callback) {
   // The |self| destructor destroys |this| when we unwind this stack frame.
 }
 
+void ApplicationEnvironmentControllerImpl::GetResourceUsage(
+    const GetResourceUsageCallback& callback) {
+  callback(environment_->GetResourceUsage());
+}
+
 void ApplicationEnvironmentControllerImpl::Detach() {
   binding_.set_connection_error_handler(ftl::Closure());
 }
@@ -30,6 +30,8 @@ class ApplicationEnvironmentControllerImpl
 
   void Detach() override;
 
+  void GetResourceUsage(const GetResourceUsageCallback& callback) override;
+
  private:
   fidl::Binding<ApplicationEnvironmentController> binding_;
   std::unique_ptr<ApplicationEnvironmentImpl> environment_;
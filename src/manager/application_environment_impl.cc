@@ -14,16 +14,23 @@
 #include <mxio/util.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <utility>
 
 #include "application/lib/app/connect.h"
 #include "application/lib/far/format.h"
+#include "application/lib/timeline/recorder.h"
+#include "application/services/service_metrics.fidl.h"
 #include "application/src/manager/namespace_builder.h"
+#include "application/src/manager/task_stats.h"
 #include "application/src/manager/url_resolver.h"
 #include "lib/ftl/functional/auto_call.h"
 #include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/strings/string_printf.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
 #include "lib/mtl/handles/object_info.h"
+#include "lib/mtl/tasks/message_loop.h"
 
 namespace app {
 namespace {
@@ -31,12 +38,19 @@ namespace {
 constexpr mx_rights_t kChildJobRights =
     MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER | MX_RIGHT_READ | MX_RIGHT_WRITE;
 
-constexpr char kFuchsiaMagic[] = "#!fuchsia ";
-constexpr size_t kFuchsiaMagicLength = sizeof(kFuchsiaMagic) - 1;
-constexpr size_t kMaxShebangLength = 2048;
 constexpr char kNumberedLabelFormat[] = "env-%d";
 constexpr char kAppPath[] = "bin/app";
 constexpr char kSandboxPath[] = "meta/sandbox";
+constexpr size_t kDefaultMaxConcurrentLaunches = 8u;
+constexpr ftl::TimeDelta kMemoryCheckInterval =
+    ftl::TimeDelta::FromSeconds(1);
+constexpr ftl::TimeDelta kRunnerRestartDelay = ftl::TimeDelta::FromSeconds(1);
+constexpr char kFuchsiaMagic[] = "#!fuchsia ";
+constexpr size_t kFuchsiaMagicLength = sizeof(kFuchsiaMagic) - 1;
+constexpr size_t kMaxShebangLength = 2048;
+constexpr LaunchPriority kSchedulerPriorities[] = {
+    LaunchPriority::INTERACTIVE, LaunchPriority::NORMAL,
+    LaunchPriority::BACKGROUND};
 
 enum class LaunchType {
   kProcess,
@@ -44,6 +58,26 @@ enum class LaunchType {
   kRunner,
 };
 
+LaunchType Classify(const mx::vmo& data, std::string* runner) {
+  if (!data)
+    return LaunchType::kProcess;
+  std::string hint(kMaxShebangLength, '\0');
+  size_t count;
+  mx_status_t status = data.read(&hint[0], 0, hint.length(), &count);
+  if (status != MX_OK)
+    return LaunchType::kProcess;
+  if (memcmp(hint.data(), &archive::kMagic, sizeof(archive::kMagic)) == 0)
+    return LaunchType::kArchive;
+  if (hint.find(kFuchsiaMagic) == 0) {
+    size_t newline = hint.find('\n', kFuchsiaMagicLength);
+    if (newline == std::string::npos)
+      return LaunchType::kProcess;
+    *runner = hint.substr(kFuchsiaMagicLength, newline - kFuchsiaMagicLength);
+    return LaunchType::kRunner;
+  }
+  return LaunchType::kProcess;
+}
+
 std::vector<const char*> GetArgv(const ApplicationLaunchInfoPtr& launch_info) {
   std::vector<const char*> argv;
   argv.reserve(launch_info->arguments.size() + 1);
@@ -157,24 +191,95 @@ mx::process CreateSandboxedProcess(const mx::job& job,
                 std::move(launch_info->service_request), std::move(data));
 }
 
-LaunchType Classify(const mx::vmo& data, std::string* runner) {
-  if (!data)
-    return LaunchType::kProcess;
-  std::string hint(kMaxShebangLength, '\0');
-  size_t count;
-  mx_status_t status = data.read(&hint[0], 0, hint.length(), &count);
-  if (status != MX_OK)
-    return LaunchType::kProcess;
-  if (memcmp(hint.data(), &archive::kMagic, sizeof(archive::kMagic)) == 0)
-    return LaunchType::kArchive;
-  if (hint.find(kFuchsiaMagic) == 0) {
-    size_t newline = hint.find('\n', kFuchsiaMagicLength);
-    if (newline == std::string::npos)
-      return LaunchType::kProcess;
-    *runner = hint.substr(kFuchsiaMagicLength, newline - kFuchsiaMagicLength);
-    return LaunchType::kRunner;
+mx::vmo CloneVmo(const mx::vmo& vmo) {
+  uint64_t size = 0u;
+  if (vmo.get_size(&size) != MX_OK)
+    return mx::vmo();
+  mx_handle_t result = MX_HANDLE_INVALID;
+  mx_vmo_clone(vmo.get(), MX_VMO_CLONE_COPY_ON_WRITE, 0u, size, &result);
+  return mx::vmo(result);
+}
+
+LaunchPriority GetDefaultLaunchPriority(
+    ApplicationEnvironmentImpl* parent,
+    const ApplicationEnvironmentOptionsPtr& options) {
+  if (options && options->default_launch_priority != LaunchPriority::DEFAULT)
+    return options->default_launch_priority;
+  if (parent)
+    return parent->default_launch_priority();
+  return LaunchPriority::NORMAL;
+}
+
+size_t GetMaxConcurrentLaunches(
+    const ApplicationEnvironmentOptionsPtr& options) {
+  if (options && options->max_concurrent_launches)
+    return options->max_concurrent_launches;
+  return kDefaultMaxConcurrentLaunches;
+}
+
+uint64_t MinLimit(uint64_t a, uint64_t b) {
+  if (!a)
+    return b;
+  if (!b)
+    return a;
+  return std::min(a, b);
+}
+
+// Combines two budgets by keeping the stricter of each limit.
+EnvironmentBudgetPtr MergeBudgets(EnvironmentBudgetPtr a,
+                                  EnvironmentBudgetPtr b) {
+  if (!a)
+    return b;
+  if (!b)
+    return a;
+  a->max_processes =
+      static_cast<uint32_t>(MinLimit(a->max_processes, b->max_processes));
+  a->max_memory_bytes = MinLimit(a->max_memory_bytes, b->max_memory_bytes);
+  return a;
+}
+
+// Runs on a worker thread. On success, |file_system| and |pkg_request| hold
+// the package directory that must be served to the new process.
+mx::process CreateArchiveProcess(
+    LaunchPlanCache* launch_plan_cache,
+    const mx::job& job,
+    ApplicationPackagePtr package,
+    ApplicationLaunchInfoPtr launch_info,
+    mx::channel svc,
+    std::unique_ptr<archive::FileSystem>* file_system,
+    mx::channel* pkg_request) {
+  auto archive =
+      std::make_unique<archive::FileSystem>(std::move(package->data));
+
+  // The package directory is served from the main message loop once the
+  // process has been created. Until then, requests from the application
+  // simply queue up in |pkg_request|.
+  mx::channel pkg;
+  if (mx::channel::create(0, &pkg, pkg_request) != MX_OK)
+    return mx::process();
+
+  NamespaceBuilder builder;
+  builder.AddPackage(std::move(pkg));
+  builder.AddServices(std::move(svc));
+
+  std::string sandbox_data;
+  if (archive->GetFileAsString(kSandboxPath, &sandbox_data)) {
+    std::shared_ptr<const SandboxPlan> plan =
+        launch_plan_cache->GetSandboxPlan(launch_info->url, sandbox_data);
+    if (!plan) {
+      FTL_LOG(ERROR) << "Failed to parse sandbox metadata for "
+                     << launch_info->url;
+      return mx::process();
+    }
+    builder.AddClonesOf(plan->directories);
   }
-  return LaunchType::kProcess;
+
+  mx::process process = CreateSandboxedProcess(
+      job, archive->GetFileAsVMO(kAppPath), std::move(launch_info),
+      builder.Build());
+  if (process)
+    *file_system = std::move(archive);
+  return process;
 }
 
 }  // namespace
@@ -183,10 +288,26 @@ uint32_t ApplicationEnvironmentImpl::next_numbered_label_ = 1u;
 
 ApplicationEnvironmentImpl::ApplicationEnvironmentImpl(
     ApplicationEnvironmentImpl* parent,
+    LaunchWorkerPool* worker_pool,
+    TerminationWatcher* termination_watcher,
+    EnvironmentInspectorImpl* inspector,
+    LaunchPlanCache* launch_plan_cache,
     fidl::InterfaceHandle<ApplicationEnvironmentHost> host,
-    const fidl::String& label)
-    : parent_(parent) {
-  host_.Bind(std::move(host));
+    const fidl::String& label,
+    ApplicationEnvironmentOptionsPtr options)
+    : registry_(parent ? parent->registry_->Clone()
+                       : std::make_unique<ServiceRegistryImpl>()),
+      parent_(parent),
+      worker_pool_(worker_pool),
+      termination_watcher_(termination_watcher),
+      inspector_(inspector),
+      launch_plan_cache_(launch_plan_cache),
+      default_launch_priority_(GetDefaultLaunchPriority(parent, options)),
+      scheduler_(GetMaxConcurrentLaunches(options)),
+      share_runners_(options && options->share_runners),
+      weak_ptr_factory_(this) {
+  if (host.is_valid())
+    host_.Bind(std::move(host));
 
   // parent_ is null if this is the root application environment. if so, we
   // derive from the application manager's job.
@@ -194,6 +315,7 @@ ApplicationEnvironmentImpl::ApplicationEnvironmentImpl(
       parent_ != nullptr ? parent_->job_.get() : mx_job_default();
   FTL_CHECK(mx::job::create(parent_job, 0u, &job_) == MX_OK);
   FTL_CHECK(job_.duplicate(kChildJobRights, &job_for_child_) == MX_OK);
+  koid_ = mtl::GetKoid(job_.get());
 
   // Get the ApplicationLoader service up front.
   ServiceProviderPtr service_provider;
@@ -207,9 +329,24 @@ ApplicationEnvironmentImpl::ApplicationEnvironmentImpl(
 
   mtl::SetObjectName(job_.get(), label_);
 
+  if (parent_ && parent_->launch_history_) {
+    launch_history_ = parent_->launch_history_;
+    prefetch_cache_ =
+        std::make_unique<PrefetchCache>(parent_->prefetch_cache_->config());
+    prefetch_scheduler_ = std::make_unique<LaunchScheduler>(
+        prefetch_cache_->config().max_in_flight);
+  }
+
   app::ServiceProviderPtr services_backend;
-  host_->GetApplicationEnvironmentServices(services_backend.NewRequest());
+  if (host_.is_bound())
+    host_->GetApplicationEnvironmentServices(services_backend.NewRequest());
+  else
+    parent_->GetServices(services_backend.NewRequest());
   services_.set_backend(std::move(services_backend));
+  services_.set_cache_routes(options && options->cache_service_routes);
+  services_.set_registry(registry_.get());
+  if (parent_)
+    services_.set_metrics(parent_->services_.metrics());
 
   services_.AddService<ApplicationEnvironment>(
       [this](fidl::InterfaceRequest<ApplicationEnvironment> request) {
@@ -220,9 +357,57 @@ ApplicationEnvironmentImpl::ApplicationEnvironmentImpl(
       [this](fidl::InterfaceRequest<ApplicationLauncher> request) {
         launcher_bindings_.AddBinding(this, std::move(request));
       });
+
+  // Services added to the registry are provided to every application in the
+  // environment, and to the nested environments created afterwards. An
+  // application that wants a private set of services forks the registry.
+  services_.AddService<ServiceRegistry>(
+      [this](fidl::InterfaceRequest<ServiceRegistry> request) {
+        registry_->AddBinding(std::move(request));
+      });
+
+  // These shadow the services of the root host, which every environment
+  // would otherwise reach through its backend. The inspector only sees this
+  // environment and the ones nested inside it, while the service metrics
+  // count the connections of every environment and so are only provided to
+  // the applications of the root environment.
+  services_.AddService<EnvironmentInspector>(
+      [this](fidl::InterfaceRequest<EnvironmentInspector> request) {
+        inspector_->AddBinding(this, std::move(request));
+      });
+  if (parent_) {
+    services_.AddService<ServiceMetrics>(
+        [](fidl::InterfaceRequest<ServiceMetrics> request) {});
+  }
+
+  // Budgets from the configuration and from |options| both apply. The budgets
+  // of ancestors are enforced as well because each environment's usage
+  // includes its nested environments.
+  EnvironmentBudgetPtr budget;
+  if (options)
+    budget = std::move(options->budget);
+  ApplyBudget(MergeBudgets(std::move(budget), GetConfiguredBudget(label_)));
+
+  inspector_->OnEnvironmentCreated(*this);
+
+  StartConfiguredRunners();
 }
 
 ApplicationEnvironmentImpl::~ApplicationEnvironmentImpl() {
+  inspector_->OnEnvironmentDestroyed(*this);
+
+  // Destroy the nested environments while |runners_| is still alive because
+  // they might have started applications with our runners.
+  children_.clear();
+
+  ApplicationEnvironmentImpl* runner_owner = GetRunnerOwner();
+  if (runner_owner != this) {
+    for (auto& runner : runner_owner->runners_) {
+      if (runner.second)
+        runner.second->KillApplications(this);
+    }
+  }
+
   job_.kill();
 }
 
@@ -244,6 +429,7 @@ ApplicationEnvironmentImpl::ExtractApplication(
   if (it == applications_.end()) {
     return nullptr;
   }
+  inspector_->OnApplicationTerminated(*this, *controller);
   auto application = std::move(it->second);
   applications_.erase(it);
   return application;
@@ -259,10 +445,22 @@ void ApplicationEnvironmentImpl::CreateNestedEnvironment(
     fidl::InterfaceRequest<ApplicationEnvironment> environment,
     fidl::InterfaceRequest<ApplicationEnvironmentController> controller_request,
     const fidl::String& label) {
+  CreateNestedEnvironmentWithOptions(std::move(host), std::move(environment),
+                                     std::move(controller_request), label,
+                                     nullptr);
+}
+
+void ApplicationEnvironmentImpl::CreateNestedEnvironmentWithOptions(
+    fidl::InterfaceHandle<ApplicationEnvironmentHost> host,
+    fidl::InterfaceRequest<ApplicationEnvironment> environment,
+    fidl::InterfaceRequest<ApplicationEnvironmentController> controller_request,
+    const fidl::String& label,
+    ApplicationEnvironmentOptionsPtr options) {
   auto controller = std::make_unique<ApplicationEnvironmentControllerImpl>(
       std::move(controller_request),
-      std::make_unique<ApplicationEnvironmentImpl>(this, std::move(host),
-                                                   label));
+      std::make_unique<ApplicationEnvironmentImpl>(
+          this, worker_pool_, termination_watcher_, inspector_,
+          launch_plan_cache_, std::move(host), label, std::move(options)));
   ApplicationEnvironmentImpl* child = controller->environment();
   child->AddBinding(std::move(environment));
   children_.emplace(child, std::move(controller));
@@ -270,6 +468,23 @@ void ApplicationEnvironmentImpl::CreateNestedEnvironment(
   PublishServicesForFirstNestedEnvironment(child->services_);
 }
 
+void ApplicationEnvironmentImpl::CloneEnvironment(
+    fidl::InterfaceRequest<ApplicationEnvironment> environment,
+    fidl::InterfaceRequest<ApplicationEnvironmentController> controller,
+    const fidl::String& label) {
+  auto options = ApplicationEnvironmentOptions::New();
+  options->default_launch_priority = default_launch_priority_;
+  options->max_concurrent_launches =
+      static_cast<uint32_t>(scheduler_.max_in_flight());
+  options->budget = budget_.Clone();
+  options->share_runners = true;
+  options->cache_service_routes = services_.cache_routes();
+  CreateNestedEnvironmentWithOptions(
+      fidl::InterfaceHandle<ApplicationEnvironmentHost>(),
+      std::move(environment), std::move(controller), label,
+      std::move(options));
+}
+
 void ApplicationEnvironmentImpl::GetApplicationLauncher(
     fidl::InterfaceRequest<ApplicationLauncher> launcher) {
   launcher_bindings_.AddBinding(this, std::move(launcher));
@@ -295,62 +510,211 @@ void ApplicationEnvironmentImpl::CreateApplication(
     return;
   }
   launch_info->url = canon_url;
+  timeline::Instant("request", canon_url, label_);
+  if (launch_info->priority == LaunchPriority::DEFAULT)
+    launch_info->priority = default_launch_priority_;
+
+  LoadApplication(std::move(launch_info), std::move(controller),
+                  ftl::TimePoint::Now());
+  PrefetchAfter(canon_url);
+}
 
+void ApplicationEnvironmentImpl::LoadApplication(
+    ApplicationLaunchInfoPtr launch_info,
+    fidl::InterfaceRequest<ApplicationController> controller,
+    ftl::TimePoint request_time) {
+  if (prefetch_cache_) {
+    mx::vmo data = prefetch_cache_->Take(launch_info->url);
+    if (data) {
+      timeline::Instant("prefetch-hit", launch_info->url, label_);
+      auto package = ApplicationPackage::New();
+      package->data = std::move(data);
+      LaunchPackage(std::move(package), std::move(launch_info),
+                    std::move(controller), request_time, nullptr);
+      return;
+    }
+  }
+
+  // The load is not counted against |scheduler_|: the loader may itself
+  // launch applications in this environment to serve it, and those launches
+  // could otherwise wait forever for the slots held by the loads.
+  //
   // launch_info is moved before LoadApplication() gets at its first argument.
   fidl::String url = launch_info->url;
   loader_->LoadApplication(
       url, ftl::MakeCopyable([
         this, launch_info = std::move(launch_info),
-        controller = std::move(controller)
+        controller = std::move(controller), request_time
       ](ApplicationPackagePtr package) mutable {
-        if (package) {
-          std::string runner;
-          LaunchType type = Classify(package->data, &runner);
-          switch (type) {
-            case LaunchType::kProcess:
-              CreateApplicationWithProcess(std::move(package),
-                                           std::move(launch_info),
-                                           std::move(controller));
-              break;
-            case LaunchType::kArchive:
-              CreateApplicationFromArchive(std::move(package),
-                                           std::move(launch_info),
-                                           std::move(controller));
-              break;
-            case LaunchType::kRunner:
-              CreateApplicationWithRunner(std::move(package),
-                                          std::move(launch_info), runner,
-                                          std::move(controller));
-              break;
-          }
+        if (package && package->range_reader) {
+          FetchPackage(std::move(package), std::move(launch_info),
+                       std::move(controller), request_time);
+          return;
         }
+        LaunchPackage(std::move(package), std::move(launch_info),
+                      std::move(controller), request_time, nullptr);
+      }));
+}
+
+void ApplicationEnvironmentImpl::PrefetchAfter(const std::string& url) {
+  if (!launch_history_)
+    return;
+  launch_history_->RecordLaunch(label_, url);
+  // Applications that could not be launched are not worth prefetching.
+  if (FindExhaustedProcessBudget())
+    return;
+  const PrefetchConfig& config = prefetch_cache_->config();
+  for (const auto& next_url : launch_history_->PredictNext(
+           label_, url, config.max_packages, config.min_percent)) {
+    if (prefetch_cache_->Contains(next_url))
+      continue;
+    prefetch_cache_->MarkPending(next_url);
+    prefetch_scheduler_->Schedule(
+        LaunchPriority::BACKGROUND,
+        [this, next_url](std::unique_ptr<LaunchScheduler::Slot> slot) {
+          PrefetchPackage(next_url, std::move(slot));
+        });
+  }
+}
+
+void ApplicationEnvironmentImpl::PrefetchPackage(
+    const std::string& url,
+    std::unique_ptr<LaunchScheduler::Slot> slot) {
+  loader_->LoadApplication(
+      url, ftl::MakeCopyable([
+        weak_this = weak_ptr_factory_.GetWeakPtr(), url, slot = std::move(slot),
+        load_time = ftl::TimePoint::Now()
+      ](ApplicationPackagePtr package) mutable {
+        slot.reset();
+        if (weak_this)
+          weak_this->OnPackagePrefetched(url, std::move(package), load_time);
       }));
 }
 
+void ApplicationEnvironmentImpl::OnPackagePrefetched(
+    const std::string& url,
+    ApplicationPackagePtr package,
+    ftl::TimePoint load_time) {
+  // Packages read by byte range are already fetched on demand, so they are
+  // not worth holding on to.
+  if (!package || !package->data) {
+    prefetch_cache_->Put(url, mx::vmo(), load_time);
+    return;
+  }
+  timeline::Complete("prefetch", url, load_time, label_);
+
+  // Warm up the launch plan of archives on the worker pool so that the launch,
+  // if it comes, finds the index parsed and the sandbox plan cached.
+  std::string runner;
+  if (Classify(package->data, &runner) == LaunchType::kArchive) {
+    mx::vmo clone = CloneVmo(package->data);
+    if (clone) {
+      worker_pool_->PostTask(ftl::MakeCopyable([
+        launch_plan_cache = launch_plan_cache_, url, clone = std::move(clone)
+      ]() mutable {
+        archive::FileSystem archive(std::move(clone));
+        std::string sandbox_data;
+        if (archive.GetFileAsString(kSandboxPath, &sandbox_data))
+          launch_plan_cache->GetSandboxPlan(url, sandbox_data);
+      }));
+    }
+  }
+  prefetch_cache_->Put(url, std::move(package->data), load_time);
+}
+
+void ApplicationEnvironmentImpl::FetchPackage(
+    ApplicationPackagePtr package,
+    ApplicationLaunchInfoPtr launch_info,
+    fidl::InterfaceRequest<ApplicationController> controller,
+    ftl::TimePoint request_time) {
+  auto owned_fetcher = std::make_unique<PackageFetcher>(
+      launch_info->url,
+      PackageByteRangeReaderPtr::Create(std::move(package->range_reader)),
+      package->size);
+  PackageFetcher* fetcher = owned_fetcher.get();
+  package_fetchers_.emplace(fetcher, std::move(owned_fetcher));
+
+  fetcher->Start(ftl::MakeCopyable([
+    this, fetcher, launch_info = std::move(launch_info),
+    controller = std::move(controller), request_time
+  ](mx::vmo data) mutable {
+    if (!data) {
+      FTL_LOG(ERROR) << "Cannot run " << launch_info->url
+                     << " because its package could not be fetched";
+      package_fetchers_.erase(fetcher);
+      return;
+    }
+    timeline::Complete("fetch", launch_info->url, request_time, label_);
+    auto package = ApplicationPackage::New();
+    package->data = std::move(data);
+    LaunchPackage(std::move(package), std::move(launch_info),
+                  std::move(controller), request_time, fetcher);
+  }));
+}
+
+void ApplicationEnvironmentImpl::LaunchPackage(
+    ApplicationPackagePtr package,
+    ApplicationLaunchInfoPtr launch_info,
+    fidl::InterfaceRequest<ApplicationController> controller,
+    ftl::TimePoint request_time,
+    PackageFetcher* fetcher) {
+  if (!package) {
+    package_fetchers_.erase(fetcher);
+    return;
+  }
+  std::string runner;
+  LaunchType type = Classify(package->data, &runner);
+  // Only archives are handed out before they have been fetched entirely.
+  if (type != LaunchType::kArchive)
+    package_fetchers_.erase(fetcher);
+  if (type == LaunchType::kRunner) {
+    CreateApplicationWithRunner(std::move(package), std::move(launch_info),
+                                runner, std::move(controller));
+    return;
+  }
+
+  // Only the creation of the process is limited by |scheduler_|.
+  LaunchPriority priority = launch_info->priority;
+  scheduler_.Schedule(priority, ftl::MakeCopyable([
+    this, type, package = std::move(package),
+    launch_info = std::move(launch_info), controller = std::move(controller),
+    request_time, fetcher
+  ](std::unique_ptr<LaunchScheduler::Slot> slot) mutable {
+    if (type == LaunchType::kProcess) {
+      CreateApplicationWithProcess(std::move(package), std::move(launch_info),
+                                   std::move(controller), std::move(slot),
+                                   request_time);
+    } else {
+      CreateApplicationFromArchive(std::move(package), std::move(launch_info),
+                                   std::move(controller), std::move(slot),
+                                   request_time, fetcher);
+    }
+  }));
+}
+
+void ApplicationEnvironmentImpl::CreateApplications(
+    fidl::Array<ApplicationLaunchRequestPtr> requests) {
+  // CreateApplication() only sends the load request to the loader, so issuing
+  // the requests back to back pipelines all of their loader round trips. Each
+  // application is then launched on the worker pool as soon as its package is
+  // available and |scheduler_| lets its process be created.
+  for (auto& request : requests) {
+    CreateApplication(std::move(request->launch_info),
+                      std::move(request->controller));
+  }
+}
+
 void ApplicationEnvironmentImpl::CreateApplicationWithRunner(
     ApplicationPackagePtr package,
     ApplicationLaunchInfoPtr launch_info,
     std::string runner,
     fidl::InterfaceRequest<ApplicationController> controller) {
-  // We create the entry in |runners_| before calling ourselves
-  // recursively to detect cycles.
-  auto result = runners_.emplace(runner, nullptr);
-  if (result.second) {
-    ServiceProviderPtr runner_services;
-    ApplicationControllerPtr runner_controller;
-    auto runner_launch_info = ApplicationLaunchInfo::New();
-    runner_launch_info->url = runner;
-    runner_launch_info->services = runner_services.NewRequest();
-    CreateApplication(std::move(runner_launch_info),
-                      runner_controller.NewRequest());
-
-    runner_controller.set_connection_error_handler(
-        [this, runner] { runners_.erase(runner); });
-
-    result.first->second = std::make_unique<ApplicationRunnerHolder>(
-        std::move(runner_services), std::move(runner_controller));
-
-  } else if (!result.first->second) {
+  ApplicationEnvironmentImpl* runner_owner = GetRunnerOwner();
+  auto it = runner_owner->runners_.find(runner);
+  if (it == runner_owner->runners_.end()) {
+    runner_owner->StartRunner(runner, launch_info->priority);
+    it = runner_owner->runners_.find(runner);
+  } else if (!it->second) {
     // There was a cycle in the runner graph.
     FTL_LOG(ERROR) << "Cannot run " << launch_info->url << " with " << runner
                    << " because of a cycle in the runner graph.";
@@ -367,74 +731,460 @@ void ApplicationEnvironmentImpl::CreateApplicationWithRunner(
   startup_info->launch_info = std::move(launch_info);
   startup_info->flat_namespace = std::move(flat_namespace);
 
-  result.first->second->StartApplication(
-      std::move(package), std::move(startup_info), std::move(controller));
+  it->second->StartApplication(std::move(package), std::move(startup_info),
+                               std::move(controller), this);
+}
+
+ApplicationEnvironmentImpl* ApplicationEnvironmentImpl::GetRunnerOwner() {
+  ApplicationEnvironmentImpl* env = this;
+  while (env->share_runners_ && env->parent_)
+    env = env->parent_;
+  return env;
+}
+
+void ApplicationEnvironmentImpl::StartRunner(const std::string& runner,
+                                             LaunchPriority priority) {
+  // We create the entry in |runners_| before calling ourselves
+  // recursively to detect cycles.
+  auto result = runners_.emplace(runner, nullptr);
+  FTL_DCHECK(result.second);
+
+  ApplicationRunnerPool::Policy policy;
+  if (const RunnerConfig* config = FindRunnerConfig(runner)) {
+    policy.min_instances = config->min_instances;
+    policy.max_instances = config->max_instances;
+    policy.applications_per_instance = config->applications_per_instance;
+    policy.idle_timeout = config->idle_timeout;
+  }
+
+  result.first->second = std::make_unique<ApplicationRunnerPool>(
+      policy,
+      [this, runner, priority](ftl::TimeDelta idle_timeout,
+                               ftl::Closure exit_callback,
+                               ftl::Closure idle_callback) {
+        return StartRunnerInstance(runner, priority, idle_timeout,
+                                   std::move(exit_callback),
+                                   std::move(idle_callback));
+      },
+      [this, runner] { OnRunnerExited(runner); },
+      [this, runner] { runners_.erase(runner); });
+}
+
+std::unique_ptr<ApplicationRunnerHolder>
+ApplicationEnvironmentImpl::StartRunnerInstance(const std::string& runner,
+                                                LaunchPriority priority,
+                                                ftl::TimeDelta idle_timeout,
+                                                ftl::Closure exit_callback,
+                                                ftl::Closure idle_callback) {
+  ServiceProviderPtr runner_services;
+  ApplicationControllerPtr runner_controller;
+  auto runner_launch_info = ApplicationLaunchInfo::New();
+  runner_launch_info->url = runner;
+  runner_launch_info->priority = priority;
+  runner_launch_info->services = runner_services.NewRequest();
+  CreateApplication(std::move(runner_launch_info),
+                    runner_controller.NewRequest());
+
+  runner_controller.set_connection_error_handler(std::move(exit_callback));
+
+  return std::make_unique<ApplicationRunnerHolder>(
+      std::move(runner_services), std::move(runner_controller), idle_timeout,
+      std::move(idle_callback));
+}
+
+void ApplicationEnvironmentImpl::OnRunnerExited(const std::string& runner) {
+  runners_.erase(runner);
+
+  // Configured runners without an idle timeout are kept alive. The restart is
+  // delayed so that a runner that fails on startup does not spin.
+  const RunnerConfig* config = FindRunnerConfig(runner);
+  if (!config || config->idle_timeout > ftl::TimeDelta::Zero())
+    return;
+  FTL_LOG(WARNING) << "Runner " << runner << " exited; restarting it in "
+                   << label_;
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [ weak_this = weak_ptr_factory_.GetWeakPtr(), runner ] {
+        if (weak_this && weak_this->runners_.count(runner) == 0u)
+          weak_this->StartRunner(runner, weak_this->default_launch_priority_);
+      },
+      kRunnerRestartDelay);
+}
+
+const RunnerConfig* ApplicationEnvironmentImpl::FindRunnerConfig(
+    const std::string& runner) const {
+  const ApplicationEnvironmentImpl* root = this;
+  while (root->parent_)
+    root = root->parent_;
+  for (const auto& config : root->configured_runners_) {
+    if (config.url != runner)
+      continue;
+    if (config.environments.empty() ||
+        std::find(config.environments.begin(), config.environments.end(),
+                  label_) != config.environments.end())
+      return &config;
+  }
+  return nullptr;
+}
+
+void ApplicationEnvironmentImpl::StartConfiguredRunners() {
+  if (GetRunnerOwner() != this)
+    return;
+  const ApplicationEnvironmentImpl* root = this;
+  while (root->parent_)
+    root = root->parent_;
+  for (const auto& config : root->configured_runners_) {
+    if (runners_.count(config.url) == 0u &&
+        FindRunnerConfig(config.url) == &config)
+      StartRunner(config.url, default_launch_priority_);
+  }
+}
+
+void ApplicationEnvironmentImpl::SetPrefetchConfig(
+    const PrefetchConfig& config) {
+  FTL_DCHECK(!parent_);
+  if (!config.max_packages)
+    return;
+  launch_history_ = std::make_shared<LaunchHistory>();
+  prefetch_cache_ = std::make_unique<PrefetchCache>(config);
+  prefetch_scheduler_ =
+      std::make_unique<LaunchScheduler>(config.max_in_flight);
+}
+
+void ApplicationEnvironmentImpl::SetServiceMetrics(
+    ServiceMetricsImpl* metrics) {
+  FTL_DCHECK(!parent_);
+  services_.set_metrics(metrics);
+}
+
+void ApplicationEnvironmentImpl::SetConfiguredRunners(
+    std::vector<RunnerConfig> runners) {
+  FTL_DCHECK(!parent_);
+  configured_runners_ = std::move(runners);
+  StartConfiguredRunners();
 }
 
 void ApplicationEnvironmentImpl::CreateApplicationWithProcess(
     ApplicationPackagePtr package,
     ApplicationLaunchInfoPtr launch_info,
-    fidl::InterfaceRequest<ApplicationController> controller) {
+    fidl::InterfaceRequest<ApplicationController> controller,
+    std::unique_ptr<LaunchScheduler::Slot> slot,
+    ftl::TimePoint request_time) {
   mx::channel svc = services_.OpenAsDirectory();
   if (!svc)
     return;
 
-  NamespaceBuilder builder;
-  builder.AddRoot();
-  builder.AddServices(std::move(svc));
+  // The worker gets its own handle to the job so that it stays valid even if
+  // this environment is destroyed while the launch is in progress.
+  mx::job job;
+  if (job_for_child_.duplicate(MX_RIGHT_SAME_RIGHTS, &job) != MX_OK)
+    return;
 
-  const std::string url = launch_info->url;  // Keep a copy before moving it.
-  mx::process process = CreateProcess(job_for_child_, std::move(package),
-                                      std::move(launch_info), builder.Build());
+  if (!ReserveProcess(launch_info->url))
+    return;
 
-  if (process) {
-    auto application = std::make_unique<ApplicationControllerImpl>(
-        std::move(controller), this, nullptr, std::move(process), url);
-    ApplicationControllerImpl* key = application.get();
-    applications_.emplace(key, std::move(application));
-  }
+  worker_pool_->PostTask(ftl::MakeCopyable([
+    weak_this = weak_ptr_factory_.GetWeakPtr(),
+    task_runner = mtl::MessageLoop::GetCurrent()->task_runner(),
+    job = std::move(job), svc = std::move(svc), package = std::move(package),
+    launch_info = std::move(launch_info), controller = std::move(controller),
+    slot = std::move(slot), request_time
+  ]() mutable {
+    NamespaceBuilder builder;
+    builder.AddRoot();
+    builder.AddServices(std::move(svc));
+
+    const std::string url = launch_info->url;  // Keep a copy before moving it.
+    mx::process process =
+        CreateProcess(job, std::move(package), std::move(launch_info),
+                      builder.Build());
+    ftl::TimeDelta launch_latency = ftl::TimePoint::Now() - request_time;
+
+    // Always reply, even on failure, so that the process reservation is
+    // released.
+    task_runner->PostTask(ftl::MakeCopyable([
+      weak_this, process = std::move(process), url, launch_latency,
+      controller = std::move(controller), slot = std::move(slot)
+    ]() mutable {
+      if (!weak_this) {
+        if (process)
+          process.kill();
+        return;
+      }
+      weak_this->OnProcessCreated(nullptr, mx::channel(), std::move(process),
+                                  url, launch_latency, std::move(controller),
+                                  nullptr);
+    }));
+  }));
 }
 
 void ApplicationEnvironmentImpl::CreateApplicationFromArchive(
     ApplicationPackagePtr package,
     ApplicationLaunchInfoPtr launch_info,
-    fidl::InterfaceRequest<ApplicationController> controller) {
-  auto file_system =
-      std::make_unique<archive::FileSystem>(std::move(package->data));
-  mx::channel pkg = file_system->OpenAsDirectory();
-  if (!pkg)
-    return;
+    fidl::InterfaceRequest<ApplicationController> controller,
+    std::unique_ptr<LaunchScheduler::Slot> slot,
+    ftl::TimePoint request_time,
+    PackageFetcher* fetcher) {
   mx::channel svc = services_.OpenAsDirectory();
-  if (!svc)
+  mx::job job;
+  if (!svc || job_for_child_.duplicate(MX_RIGHT_SAME_RIGHTS, &job) != MX_OK ||
+      !ReserveProcess(launch_info->url)) {
+    package_fetchers_.erase(fetcher);
     return;
+  }
 
-  NamespaceBuilder builder;
-  builder.AddPackage(std::move(pkg));
-  builder.AddServices(std::move(svc));
+  worker_pool_->PostTask(ftl::MakeCopyable([
+    weak_this = weak_ptr_factory_.GetWeakPtr(),
+    task_runner = mtl::MessageLoop::GetCurrent()->task_runner(),
+    launch_plan_cache = launch_plan_cache_,
+    job = std::move(job), svc = std::move(svc), package = std::move(package),
+    launch_info = std::move(launch_info), controller = std::move(controller),
+    slot = std::move(slot), request_time, fetcher
+  ]() mutable {
+    const std::string url = launch_info->url;  // Keep a copy before moving it.
+    std::unique_ptr<archive::FileSystem> file_system;
+    mx::channel pkg_request;
+    mx::process process = CreateArchiveProcess(
+        launch_plan_cache, job, std::move(package), std::move(launch_info),
+        std::move(svc), &file_system, &pkg_request);
+    ftl::TimeDelta launch_latency = ftl::TimePoint::Now() - request_time;
 
-  std::string sandbox_data;
-  if (file_system->GetFileAsString(kSandboxPath, &sandbox_data)) {
-    SandboxMetadata sandbox;
-    if (!sandbox.Parse(sandbox_data)) {
-      FTL_LOG(ERROR) << "Failed to parse sandbox metadata for "
-                     << launch_info->url;
-      return;
+    task_runner->PostTask(ftl::MakeCopyable([
+      weak_this, file_system = std::move(file_system),
+      pkg_request = std::move(pkg_request), process = std::move(process), url,
+      launch_latency, controller = std::move(controller),
+      slot = std::move(slot), fetcher
+    ]() mutable {
+      if (!weak_this) {
+        if (process)
+          process.kill();
+        return;
+      }
+      weak_this->OnProcessCreated(std::move(file_system),
+                                  std::move(pkg_request), std::move(process),
+                                  url, launch_latency, std::move(controller),
+                                  fetcher);
+    }));
+  }));
+}
+
+void ApplicationEnvironmentImpl::OnProcessCreated(
+    std::unique_ptr<archive::FileSystem> file_system,
+    mx::channel pkg_request,
+    mx::process process,
+    const std::string& url,
+    ftl::TimeDelta launch_latency,
+    fidl::InterfaceRequest<ApplicationController> controller,
+    PackageFetcher* fetcher) {
+  FTL_DCHECK(pending_process_count_ > 0u);
+  --pending_process_count_;
+  std::unique_ptr<PackageFetcher> package_fetcher;
+  auto fetcher_it = package_fetchers_.find(fetcher);
+  if (fetcher_it != package_fetchers_.end()) {
+    package_fetcher = std::move(fetcher_it->second);
+    package_fetchers_.erase(fetcher_it);
+  }
+  if (!process)
+    return;
+
+  // Requests for the package directory of an archive that is still being
+  // fetched wait in |pkg_request| until the whole archive has arrived.
+  if (file_system && !package_fetcher &&
+      !file_system->Serve(std::move(pkg_request))) {
+    process.kill();
+    return;
+  }
+
+  auto application = std::make_unique<ApplicationControllerImpl>(
+      std::move(controller), this, std::move(file_system), std::move(process),
+      url, launch_latency);
+  if (package_fetcher) {
+    application->ServePackageWhenFetched(std::move(package_fetcher),
+                                         std::move(pkg_request));
+  }
+  ApplicationControllerImpl* key = application.get();
+  applications_.emplace(key, std::move(application));
+  inspector_->OnApplicationStarted(*this, *key);
+  timeline::Complete("launch", url, ftl::TimePoint::Now() - launch_latency,
+                     label_);
+}
+
+bool ApplicationEnvironmentImpl::ReserveProcess(const std::string& url) {
+  if (const ApplicationEnvironmentImpl* env = FindExhaustedProcessBudget()) {
+    FTL_LOG(ERROR) << "Cannot run " << url << " because environment "
+                   << env->label_ << " has reached its budget of "
+                   << env->budget_->max_processes << " processes";
+    return false;
+  }
+  ++pending_process_count_;
+  return true;
+}
+
+const ApplicationEnvironmentImpl*
+ApplicationEnvironmentImpl::FindExhaustedProcessBudget() const {
+  for (const ApplicationEnvironmentImpl* env = this; env; env = env->parent_) {
+    if (env->budget_ && env->budget_->max_processes &&
+        env->CountProcesses() >= env->budget_->max_processes)
+      return env;
+  }
+  return nullptr;
+}
+
+size_t ApplicationEnvironmentImpl::CountProcesses() const {
+  size_t count = applications_.size() + pending_process_count_;
+  for (const auto& child : children_)
+    count += child.first->CountProcesses();
+  return count;
+}
+
+uint64_t ApplicationEnvironmentImpl::MeasureMemory(
+    ApplicationControllerImpl** largest,
+    uint64_t* largest_bytes) const {
+  uint64_t total = 0u;
+  for (const auto& application : applications_) {
+    uint64_t bytes = GetPrivateMemoryBytes(application.first->process());
+    total += bytes;
+    if (largest && bytes > *largest_bytes) {
+      *largest = application.first;
+      *largest_bytes = bytes;
     }
-    builder.AddSandbox(sandbox);
   }
+  for (const auto& child : children_)
+    total += child.first->MeasureMemory(largest, largest_bytes);
+  return total;
+}
 
-  const std::string url = launch_info->url;  // Keep a copy before moving it.
-  mx::process process = CreateSandboxedProcess(
-      job_for_child_, file_system->GetFileAsVMO(kAppPath),
-      std::move(launch_info), builder.Build());
+void ApplicationEnvironmentImpl::ApplyBudget(EnvironmentBudgetPtr budget) {
+  budget_ = std::move(budget);
+  if (budget_ && budget_->max_memory_bytes && !memory_check_scheduled_)
+    ScheduleMemoryCheck();
+}
+
+void ApplicationEnvironmentImpl::ScheduleMemoryCheck() {
+  memory_check_scheduled_ = true;
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this = weak_ptr_factory_.GetWeakPtr()] {
+        if (weak_this)
+          weak_this->CheckMemoryBudget();
+      },
+      kMemoryCheckInterval);
+}
+
+void ApplicationEnvironmentImpl::CheckMemoryBudget() {
+  memory_check_scheduled_ = false;
+  if (!budget_ || !budget_->max_memory_bytes)
+    return;
+
+  ApplicationControllerImpl* largest = nullptr;
+  uint64_t largest_bytes = 0u;
+  uint64_t total = MeasureMemory(&largest, &largest_bytes);
+  if (total > budget_->max_memory_bytes && largest) {
+    FTL_LOG(ERROR) << "Environment " << label_ << " uses " << total
+                   << " bytes, which exceeds its budget of "
+                   << budget_->max_memory_bytes << " bytes; killing "
+                   << largest->path() << " (" << largest_bytes << " bytes)";
+    // The application is removed once the termination is observed.
+    largest->Kill();
+  }
+  ScheduleMemoryCheck();
+}
+
+EnvironmentBudgetPtr ApplicationEnvironmentImpl::GetConfiguredBudget(
+    const std::string& label) const {
+  const ApplicationEnvironmentImpl* root = this;
+  while (root->parent_)
+    root = root->parent_;
+  auto it = root->configured_budgets_.find(label);
+  if (it == root->configured_budgets_.end())
+    return nullptr;
+  return it->second.Clone();
+}
+
+void ApplicationEnvironmentImpl::SetConfiguredBudgets(
+    std::unordered_map<std::string, EnvironmentBudgetPtr> budgets) {
+  FTL_DCHECK(!parent_);
+  configured_budgets_ = std::move(budgets);
+  ApplyBudget(MergeBudgets(std::move(budget_), GetConfiguredBudget(label_)));
+}
 
-  if (process) {
-    auto application = std::make_unique<ApplicationControllerImpl>(
-        std::move(controller), this, std::move(file_system), std::move(process),
-        url);
-    ApplicationControllerImpl* key = application.get();
-    applications_.emplace(key, std::move(application));
+EnvironmentInfoPtr ApplicationEnvironmentImpl::DescribeWithoutUsage() const {
+  auto info = EnvironmentInfo::New();
+  info->koid = koid_;
+  info->parent_koid = parent_ ? parent_->koid_ : 0u;
+  info->label = label_;
+  info->applications = fidl::Array<ApplicationInfoPtr>::New(0);
+  info->runners = fidl::Array<RunnerInfoPtr>::New(0);
+  for (const auto& runner : runners_) {
+    if (!runner.second)
+      continue;
+    auto runner_info = RunnerInfo::New();
+    runner_info->url = runner.first;
+    runner_info->instances = runner.second->GetInstanceInfo();
+    info->runners.push_back(std::move(runner_info));
+  }
+  info->launches_in_flight = scheduler_.in_flight();
+  info->launch_queues = fidl::Array<LaunchQueueInfoPtr>::New(0);
+  for (LaunchPriority priority : kSchedulerPriorities) {
+    const LaunchScheduler::Stats& stats = scheduler_.stats(priority);
+    auto queue_info = LaunchQueueInfo::New();
+    queue_info->priority = priority;
+    queue_info->launched = stats.launched;
+    queue_info->queue_depth = stats.queue_depth;
+    queue_info->max_queue_depth = stats.max_queue_depth;
+    queue_info->total_wait = stats.total_wait.ToNanoseconds();
+    queue_info->max_wait = stats.max_wait.ToNanoseconds();
+    info->launch_queues.push_back(std::move(queue_info));
   }
+  return info;
+}
+
+EnvironmentInfoPtr ApplicationEnvironmentImpl::GetInfo() const {
+  auto info = DescribeWithoutUsage();
+  info->usage = GetResourceUsage();
+  return info;
+}
+
+void ApplicationEnvironmentImpl::AppendSnapshot(
+    fidl::Array<EnvironmentInfoPtr>* environments) const {
+  // The usage is accumulated bottom-up so that each process is only measured
+  // once per snapshot.
+  auto info = DescribeWithoutUsage();
+  auto usage = EnvironmentResourceUsage::New();
+  usage->process_count = applications_.size() + pending_process_count_;
+  for (const auto& application : applications_) {
+    auto application_info = application.first->GetInfo();
+    usage->memory_bytes += application_info->memory_bytes;
+    info->applications.push_back(std::move(application_info));
+  }
+  usage->budget = budget_ ? budget_.Clone() : EnvironmentBudget::New();
+
+  size_t index = environments->size();
+  environments->push_back(std::move(info));
+  for (const auto& child : children_) {
+    size_t child_index = environments->size();
+    child.first->AppendSnapshot(environments);
+    const auto& child_usage = (*environments)[child_index]->usage;
+    usage->process_count += child_usage->process_count;
+    usage->memory_bytes += child_usage->memory_bytes;
+  }
+  (*environments)[index]->usage = std::move(usage);
+}
+
+void ApplicationEnvironmentImpl::ForEachApplication(
+    const std::function<void(const ApplicationEnvironmentImpl&,
+                             ApplicationControllerImpl*)>& callback) const {
+  for (const auto& application : applications_)
+    callback(*this, application.first);
+  for (const auto& child : children_)
+    child.first->ForEachApplication(callback);
+}
+
+EnvironmentResourceUsagePtr ApplicationEnvironmentImpl::GetResourceUsage()
+    const {
+  auto usage = EnvironmentResourceUsage::New();
+  usage->process_count = CountProcesses();
+  usage->memory_bytes = MeasureMemory(nullptr, nullptr);
+  usage->budget = budget_ ? budget_.Clone() : EnvironmentBudget::New();
+  return usage;
 }
 
 }  // namespace app
@@ -5,34 +5,117 @@
 #ifndef APPLICATION_SRC_MANAGER_APPLICATION_ENVIRONMENT_IMPL_H_
 #define APPLICATION_SRC_MANAGER_APPLICATION_ENVIRONMENT_IMPL_H_
 
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "application/lib/svc/service_provider_bridge.h"
+#include "application/lib/svc/service_registry_impl.h"
 #include "application/services/application_environment.fidl.h"
 #include "application/services/application_loader.fidl.h"
+#include "application/services/environment_budget.fidl.h"
 #include "application/src/manager/application_controller_impl.h"
 #include "application/src/manager/application_environment_controller_impl.h"
 #include "application/src/manager/application_runner_holder.h"
+#include "application/src/manager/application_runner_pool.h"
+#include "application/src/manager/config.h"
+#include "application/src/manager/environment_inspector_impl.h"
+#include "application/src/manager/launch_history.h"
+#include "application/src/manager/launch_plan_cache.h"
+#include "application/src/manager/launch_scheduler.h"
+#include "application/src/manager/launch_worker_pool.h"
+#include "application/src/manager/package_fetcher.h"
+#include "application/src/manager/prefetch_cache.h"
+#include "application/src/manager/termination_watcher.h"
 #include "lib/fidl/cpp/bindings/binding_set.h"
+#include "lib/ftl/functional/closure.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
 #include "lib/ftl/strings/string_view.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
 
 namespace app {
 
 class ApplicationEnvironmentImpl : public ApplicationEnvironment,
                                    public ApplicationLauncher {
  public:
+  // If |host| is null, the environment gets its environment services from
+  // |parent|.
   ApplicationEnvironmentImpl(
       ApplicationEnvironmentImpl* parent,
+      LaunchWorkerPool* worker_pool,
+      TerminationWatcher* termination_watcher,
+      EnvironmentInspectorImpl* inspector,
+      LaunchPlanCache* launch_plan_cache,
       fidl::InterfaceHandle<ApplicationEnvironmentHost> host,
-      const fidl::String& label);
+      const fidl::String& label,
+      ApplicationEnvironmentOptionsPtr options);
   ~ApplicationEnvironmentImpl() override;
 
   ApplicationEnvironmentImpl* parent() const { return parent_; }
+  // The koid of the environment's job.
+  uint64_t koid() const { return koid_; }
   const std::string& label() const { return label_; }
+  LaunchPriority default_launch_priority() const {
+    return default_launch_priority_;
+  }
+  const LaunchScheduler& scheduler() const { return scheduler_; }
+  TerminationWatcher* termination_watcher() const {
+    return termination_watcher_;
+  }
+  const EnvironmentBudgetPtr& budget() const { return budget_; }
+  // The number of connections the applications of this environment have made
+  // to its services.
+  uint64_t service_connect_count() const {
+    return services_.directory_connect_count();
+  }
+
+  // Sets the budgets that apply to environments with the given labels,
+  // including this one. Must be called on the root environment before any
+  // nested environments are created.
+  void SetConfiguredBudgets(
+      std::unordered_map<std::string, EnvironmentBudgetPtr> budgets);
+
+  // Sets the runners to start ahead of the applications that need them, and
+  // starts the ones that apply to this environment. Must be called on the root
+  // environment before any nested environments are created.
+  void SetConfiguredRunners(std::vector<RunnerConfig> runners);
+
+  // Enables prefetching of the packages likely to be launched next in this
+  // environment and the environments nested inside it. Must be called on the
+  // root environment before any nested environments are created.
+  void SetPrefetchConfig(const PrefetchConfig& config);
+
+  // Records the service connections of this environment and the environments
+  // nested inside it in |metrics|, which must outlive them. Must be called on
+  // the root environment before any nested environments are created.
+  void SetServiceMetrics(ServiceMetricsImpl* metrics);
+
+  // Returns the resources used by this environment and the environments
+  // nested inside it.
+  EnvironmentResourceUsagePtr GetResourceUsage() const;
+
+  // Whether this environment runs |url| as a runner.
+  bool HasRunner(const std::string& url) const {
+    return runners_.count(url) != 0u;
+  }
+
+  // Calls |callback| with every application running in this environment and
+  // its nested environments, along with the environment it runs in.
+  void ForEachApplication(
+      const std::function<void(const ApplicationEnvironmentImpl&,
+                               ApplicationControllerImpl*)>& callback) const;
+
+  // Describes this environment without listing its applications.
+  EnvironmentInfoPtr GetInfo() const;
+
+  // Appends the description of this environment and all the environments
+  // nested inside it to |environments|, parents first.
+  void AppendSnapshot(fidl::Array<EnvironmentInfoPtr>* environments) const;
 
   // Removes the child environment from this environment and returns the owning
   // reference to the child's controller. The caller of this function typically
@@ -63,41 +146,158 @@ class ApplicationEnvironmentImpl : public ApplicationEnvironment,
 
   void GetServices(fidl::InterfaceRequest<ServiceProvider> services) override;
 
+  void CloneEnvironment(
+      fidl::InterfaceRequest<ApplicationEnvironment> environment,
+      fidl::InterfaceRequest<ApplicationEnvironmentController> controller,
+      const fidl::String& label) override;
+
+  void CreateNestedEnvironmentWithOptions(
+      fidl::InterfaceHandle<ApplicationEnvironmentHost> host,
+      fidl::InterfaceRequest<ApplicationEnvironment> environment,
+      fidl::InterfaceRequest<ApplicationEnvironmentController> controller,
+      const fidl::String& label,
+      ApplicationEnvironmentOptionsPtr options) override;
+
   // ApplicationLauncher implementation:
 
   void CreateApplication(
       ApplicationLaunchInfoPtr launch_info,
       fidl::InterfaceRequest<ApplicationController> controller) override;
 
+  void CreateApplications(
+      fidl::Array<ApplicationLaunchRequestPtr> requests) override;
+
  private:
   static uint32_t next_numbered_label_;
 
+  void LoadApplication(ApplicationLaunchInfoPtr launch_info,
+                       fidl::InterfaceRequest<ApplicationController> controller,
+                       ftl::TimePoint request_time);
+  // Records the launch of |url| and prefetches the packages of the
+  // applications that usually follow it.
+  void PrefetchAfter(const std::string& url);
+  // Loads |url| into the prefetch cache, holding |slot| of
+  // |prefetch_scheduler_| until it is loaded.
+  void PrefetchPackage(const std::string& url,
+                       std::unique_ptr<LaunchScheduler::Slot> slot);
+  void OnPackagePrefetched(const std::string& url,
+                           ApplicationPackagePtr package,
+                           ftl::TimePoint load_time);
+  // Fetches a package read by byte range, then launches it.
+  void FetchPackage(ApplicationPackagePtr package,
+                    ApplicationLaunchInfoPtr launch_info,
+                    fidl::InterfaceRequest<ApplicationController> controller,
+                    ftl::TimePoint request_time);
+  // Launches |package|, waiting for a slot of |scheduler_| if it needs a new
+  // process. |fetcher| is the entry of |package_fetchers_| still fetching
+  // |package|, if any.
+  void LaunchPackage(ApplicationPackagePtr package,
+                     ApplicationLaunchInfoPtr launch_info,
+                     fidl::InterfaceRequest<ApplicationController> controller,
+                     ftl::TimePoint request_time,
+                     PackageFetcher* fetcher);
   void CreateApplicationWithRunner(
       ApplicationPackagePtr package,
       ApplicationLaunchInfoPtr launch_info,
       std::string runner,
       fidl::InterfaceRequest<ApplicationController> controller);
+  // Returns the environment whose runners this environment uses.
+  ApplicationEnvironmentImpl* GetRunnerOwner();
+  void StartRunner(const std::string& runner, LaunchPriority priority);
+  std::unique_ptr<ApplicationRunnerHolder> StartRunnerInstance(
+      const std::string& runner,
+      LaunchPriority priority,
+      ftl::TimeDelta idle_timeout,
+      ftl::Closure exit_callback,
+      ftl::Closure idle_callback);
+  void OnRunnerExited(const std::string& runner);
+  // Returns the configuration of |runner| if it applies to this environment.
+  const RunnerConfig* FindRunnerConfig(const std::string& runner) const;
+  void StartConfiguredRunners();
   void CreateApplicationWithProcess(
       ApplicationPackagePtr package,
       ApplicationLaunchInfoPtr launch_info,
-      fidl::InterfaceRequest<ApplicationController> controller);
+      fidl::InterfaceRequest<ApplicationController> controller,
+      std::unique_ptr<LaunchScheduler::Slot> slot,
+      ftl::TimePoint request_time);
   void CreateApplicationFromArchive(
       ApplicationPackagePtr package,
       ApplicationLaunchInfoPtr launch_info,
-      fidl::InterfaceRequest<ApplicationController> controller);
+      fidl::InterfaceRequest<ApplicationController> controller,
+      std::unique_ptr<LaunchScheduler::Slot> slot,
+      ftl::TimePoint request_time,
+      PackageFetcher* fetcher);
+
+  // Called once the |worker_pool_| has tried to create a process reserved by
+  // ReserveProcess(). Takes ownership of the application if |process| is
+  // valid, and hands it |fetcher| if its package is still being fetched.
+  void OnProcessCreated(
+      std::unique_ptr<archive::FileSystem> file_system,
+      mx::channel pkg_request,
+      mx::process process,
+      const std::string& url,
+      ftl::TimeDelta launch_latency,
+      fidl::InterfaceRequest<ApplicationController> controller,
+      PackageFetcher* fetcher);
+
+  // Accounts for a process about to be created, unless doing so would exceed
+  // the process budget of this environment or one of its ancestors.
+  bool ReserveProcess(const std::string& url);
+
+  // Returns this environment or the ancestor whose process budget is used up,
+  // or null if another process fits.
+  const ApplicationEnvironmentImpl* FindExhaustedProcessBudget() const;
+
+  // Returns the number of processes, including reserved ones, in this
+  // environment and its nested environments.
+  size_t CountProcesses() const;
+
+  // Returns the private memory used by applications in this environment and
+  // its nested environments. If |largest| is not null, it is updated with the
+  // application using the most memory, if that uses more than
+  // |largest_bytes|.
+  uint64_t MeasureMemory(ApplicationControllerImpl** largest,
+                         uint64_t* largest_bytes) const;
+
+  EnvironmentInfoPtr DescribeWithoutUsage() const;
+
+  EnvironmentBudgetPtr GetConfiguredBudget(const std::string& label) const;
+  void ApplyBudget(EnvironmentBudgetPtr budget);
+  void ScheduleMemoryCheck();
+  void CheckMemoryBudget();
 
   fidl::BindingSet<ApplicationEnvironment> environment_bindings_;
   fidl::BindingSet<ApplicationLauncher> launcher_bindings_;
 
+  // Services added here are connected directly by |services_| and are
+  // inherited by nested environments created afterwards.
+  std::unique_ptr<ServiceRegistryImpl> registry_;
   ServiceProviderBridge services_;
 
   ApplicationEnvironmentImpl* parent_;
+  LaunchWorkerPool* worker_pool_;
+  TerminationWatcher* termination_watcher_;
+  EnvironmentInspectorImpl* inspector_;
+  LaunchPlanCache* launch_plan_cache_;
   ApplicationEnvironmentHostPtr host_;
   ApplicationLoaderPtr loader_;
   std::string label_;
 
+  LaunchPriority default_launch_priority_;
+  LaunchScheduler scheduler_;
+  bool share_runners_;
+
+  EnvironmentBudgetPtr budget_;
+  size_t pending_process_count_ = 0u;
+  bool memory_check_scheduled_ = false;
+
+  // Only populated on the root environment.
+  std::unordered_map<std::string, EnvironmentBudgetPtr> configured_budgets_;
+  std::vector<RunnerConfig> configured_runners_;
+
   mx::job job_;
   mx::job job_for_child_;
+  uint64_t koid_ = 0u;
 
   std::unordered_map<ApplicationEnvironmentImpl*,
                      std::unique_ptr<ApplicationEnvironmentControllerImpl>>
@@ -107,9 +307,24 @@ class ApplicationEnvironmentImpl : public ApplicationEnvironment,
                      std::unique_ptr<ApplicationControllerImpl>>
       applications_;
 
-  std::unordered_map<std::string, std::unique_ptr<ApplicationRunnerHolder>>
+  std::unordered_map<std::string, std::unique_ptr<ApplicationRunnerPool>>
       runners_;
 
+  // Packages being fetched for applications that have not started yet.
+  std::unordered_map<PackageFetcher*, std::unique_ptr<PackageFetcher>>
+      package_fetchers_;
+
+  // Null unless prefetching is enabled. The history is shared by all the
+  // environments, while each environment prefetches into its own cache.
+  std::shared_ptr<LaunchHistory> launch_history_;
+  std::unique_ptr<PrefetchCache> prefetch_cache_;
+  // Bounds the prefetches waiting on |loader_| separately from |scheduler_|,
+  // so that a loader that launches applications in this environment never
+  // waits for a prefetch.
+  std::unique_ptr<LaunchScheduler> prefetch_scheduler_;
+
+  ftl::WeakPtrFactory<ApplicationEnvironmentImpl> weak_ptr_factory_;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationEnvironmentImpl);
 };
 
@@ -0,0 +1,293 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/application_environment_impl.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "application/lib/app/connect.h"
+#include "application/lib/svc/service_provider_bridge.h"
+#include "application/services/application_environment_host.fidl.h"
+#include "application/services/application_loader.fidl.h"
+#include "application/services/environment_inspector.fidl.h"
+#include "application/services/service_metrics.fidl.h"
+#include "application/services/service_provider.fidl.h"
+#include "application/services/service_registry.fidl.h"
+#include "gtest/gtest.h"
+#include "lib/fidl/cpp/bindings/binding.h"
+#include "lib/fidl/cpp/bindings/binding_set.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+constexpr char kDelegateUrl[] = "file:///system/apps/delegate";
+constexpr char kService[] = "test.Service";
+
+// Provides |kService| from a directory, as an application registering it
+// would, and counts the connections to it.
+class TestServiceProvider {
+ public:
+  TestServiceProvider() {
+    bridge_.AddServiceForName([this](mx::channel channel) { ++connects; },
+                              kService);
+  }
+
+  mx::channel OpenAsDirectory() { return bridge_.OpenAsDirectory(); }
+
+  int connects = 0;
+
+ private:
+  ServiceProviderBridge bridge_;
+};
+
+// Hosts an environment and serves it a loader that records the urls it is
+// asked for and answers only when told to.
+class TestEnvironmentHost : public ApplicationEnvironmentHost,
+                            public ServiceProvider,
+                            public ApplicationLoader {
+ public:
+  TestEnvironmentHost() : host_binding_(this) {}
+
+  fidl::InterfaceHandle<ApplicationEnvironmentHost> Bind() {
+    fidl::InterfaceHandle<ApplicationEnvironmentHost> host;
+    host_binding_.Bind(&host);
+    return host;
+  }
+
+  // ApplicationEnvironmentHost implementation:
+
+  void GetApplicationEnvironmentServices(
+      fidl::InterfaceRequest<ServiceProvider> environment_services) override {
+    service_provider_bindings_.AddBinding(this,
+                                          std::move(environment_services));
+  }
+
+  // ServiceProvider implementation:
+
+  void ConnectToService(const fidl::String& interface_name,
+                        mx::channel channel) override {
+    requested_services.push_back(interface_name.get());
+    if (interface_name == ApplicationLoader::Name_) {
+      loader_bindings_.AddBinding(
+          this, fidl::InterfaceRequest<ApplicationLoader>(std::move(channel)));
+    }
+  }
+
+  // ApplicationLoader implementation:
+
+  void LoadApplication(const fidl::String& url,
+                       const LoadApplicationCallback& callback) override {
+    requested_urls.push_back(url.get());
+    pending_loads_.push_back(callback);
+    if (on_load)
+      on_load(url.get());
+  }
+
+  // Answers every pending load with a null package.
+  void FailPendingLoads() {
+    std::vector<LoadApplicationCallback> pending_loads;
+    pending_loads.swap(pending_loads_);
+    for (const auto& callback : pending_loads)
+      callback(nullptr);
+  }
+
+  std::vector<std::string> requested_services;
+  std::vector<std::string> requested_urls;
+  std::function<void(const std::string& url)> on_load;
+
+ private:
+  fidl::Binding<ApplicationEnvironmentHost> host_binding_;
+  fidl::BindingSet<ServiceProvider> service_provider_bindings_;
+  fidl::BindingSet<ApplicationLoader> loader_bindings_;
+  std::vector<LoadApplicationCallback> pending_loads_;
+};
+
+class ApplicationEnvironmentImplTest : public ::testing::Test {
+ protected:
+  ApplicationEnvironmentImplTest()
+      : worker_pool_(1u), launch_plan_cache_(4u) {}
+
+  std::unique_ptr<ApplicationEnvironmentImpl> CreateEnvironment(
+      ApplicationEnvironmentOptionsPtr options) {
+    auto environment = std::make_unique<ApplicationEnvironmentImpl>(
+        nullptr, &worker_pool_, &termination_watcher_, &inspector_,
+        &launch_plan_cache_, host_.Bind(), "test", std::move(options));
+    return environment;
+  }
+
+  // Adds |provider| to the registry of |environment| through the registry the
+  // environment provides to its applications.
+  void RegisterService(ApplicationEnvironment* environment,
+                       TestServiceProvider* provider) {
+    ServiceProviderPtr services;
+    environment->GetServices(services.NewRequest());
+    auto registry = ConnectToService<ServiceRegistry>(services.get());
+    fidl::Array<fidl::String> names;
+    names.push_back(kService);
+    registry->Add(std::move(names), provider->OpenAsDirectory());
+    message_loop_.RunUntilIdle();
+  }
+
+  // Removes every service from the registry of |environment|.
+  void ClearRegistry(ApplicationEnvironment* environment) {
+    ServiceProviderPtr services;
+    environment->GetServices(services.NewRequest());
+    auto registry = ConnectToService<ServiceRegistry>(services.get());
+    registry->Filter(fidl::Array<fidl::String>::New(0));
+    message_loop_.RunUntilIdle();
+  }
+
+  // Connects to |kService| as an application in |environment| would.
+  void ConnectToTestService(ApplicationEnvironment* environment) {
+    ServiceProviderPtr services;
+    environment->GetServices(services.NewRequest());
+    mx::channel h1, h2;
+    ASSERT_EQ(MX_OK, mx::channel::create(0, &h1, &h2));
+    services->ConnectToService(kService, std::move(h1));
+    message_loop_.RunUntilIdle();
+  }
+
+  // Returns the labels of the environments that an application in
+  // |environment| sees through its inspector.
+  std::vector<std::string> GetInspectedLabels(
+      ApplicationEnvironment* environment) {
+    ServiceProviderPtr services;
+    environment->GetServices(services.NewRequest());
+    auto inspector = ConnectToService<EnvironmentInspector>(services.get());
+    std::vector<std::string> labels;
+    inspector->GetSnapshot(
+        [&labels](uint64_t version,
+                  fidl::Array<EnvironmentInfoPtr> environments) {
+          for (const auto& info : environments)
+            labels.push_back(info->label.get());
+        });
+    message_loop_.RunUntilIdle();
+    return labels;
+  }
+
+  static ApplicationLaunchInfoPtr MakeLaunchInfo(const std::string& url) {
+    auto launch_info = ApplicationLaunchInfo::New();
+    launch_info->url = url;
+    return launch_info;
+  }
+
+  mtl::MessageLoop message_loop_;
+  LaunchWorkerPool worker_pool_;
+  TerminationWatcher termination_watcher_;
+  EnvironmentInspectorImpl inspector_;
+  LaunchPlanCache launch_plan_cache_;
+  TestEnvironmentHost host_;
+};
+
+// A loader that launches applications in the environment it serves, as the
+// delegating loader in bootstrap does, must not wait for the launch slots of
+// the packages it is loading.
+TEST_F(ApplicationEnvironmentImplTest, LoadsDoNotHoldLaunchSlots) {
+  auto options = ApplicationEnvironmentOptions::New();
+  options->max_concurrent_launches = 1u;
+  std::unique_ptr<ApplicationEnvironmentImpl> environment =
+      CreateEnvironment(std::move(options));
+  host_.on_load = [&environment](const std::string& url) {
+    if (url != kDelegateUrl)
+      environment->CreateApplication(MakeLaunchInfo(kDelegateUrl), nullptr);
+  };
+
+  environment->CreateApplication(MakeLaunchInfo("file:///system/apps/a"),
+                                 nullptr);
+  environment->CreateApplication(MakeLaunchInfo("file:///system/apps/b"),
+                                 nullptr);
+  message_loop_.RunUntilIdle();
+
+  EXPECT_EQ(2, std::count(host_.requested_urls.begin(),
+                          host_.requested_urls.end(), kDelegateUrl));
+  EXPECT_EQ(0u, environment->scheduler().in_flight());
+
+  host_.FailPendingLoads();
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(0u, environment->scheduler().queue_depth());
+}
+
+// Services registered in an environment are provided to its applications
+// ahead of the services of its host.
+TEST_F(ApplicationEnvironmentImplTest, ProvidesRegisteredServices) {
+  std::unique_ptr<ApplicationEnvironmentImpl> environment =
+      CreateEnvironment(nullptr);
+  TestServiceProvider provider;
+
+  ConnectToTestService(environment.get());
+  EXPECT_EQ(0, provider.connects);
+
+  RegisterService(environment.get(), &provider);
+  ConnectToTestService(environment.get());
+  EXPECT_EQ(1, provider.connects);
+}
+
+// A clone starts with the services registered in the original, while the
+// services registered later in either stay out of the other.
+TEST_F(ApplicationEnvironmentImplTest, ClonesRegisteredServices) {
+  std::unique_ptr<ApplicationEnvironmentImpl> environment =
+      CreateEnvironment(nullptr);
+  TestServiceProvider provider;
+
+  ApplicationEnvironmentPtr empty_clone;
+  environment->CloneEnvironment(empty_clone.NewRequest(), nullptr, "empty");
+  RegisterService(empty_clone.get(), &provider);
+  ConnectToTestService(environment.get());
+  EXPECT_EQ(0, provider.connects);
+  ConnectToTestService(empty_clone.get());
+  EXPECT_EQ(1, provider.connects);
+
+  RegisterService(environment.get(), &provider);
+  ApplicationEnvironmentPtr clone;
+  environment->CloneEnvironment(clone.NewRequest(), nullptr, "clone");
+  // Removing the service from the original leaves the clone its own copy.
+  ClearRegistry(environment.get());
+  ConnectToTestService(environment.get());
+  EXPECT_EQ(1, provider.connects);
+  ConnectToTestService(clone.get());
+  EXPECT_EQ(2, provider.connects);
+}
+
+// Applications only see their own environment and the environments nested
+// inside it, and only the root environment reaches the service metrics.
+TEST_F(ApplicationEnvironmentImplTest, InspectsOnlyNestedEnvironments) {
+  std::unique_ptr<ApplicationEnvironmentImpl> environment =
+      CreateEnvironment(nullptr);
+  ApplicationEnvironmentPtr first;
+  environment->CloneEnvironment(first.NewRequest(), nullptr, "first");
+  ApplicationEnvironmentPtr second;
+  environment->CloneEnvironment(second.NewRequest(), nullptr, "second");
+  message_loop_.RunUntilIdle();
+
+  std::vector<std::string> labels = GetInspectedLabels(environment.get());
+  std::sort(labels.begin(), labels.end());
+  EXPECT_EQ((std::vector<std::string>{"first", "second", "test"}), labels);
+  EXPECT_EQ(std::vector<std::string>{"first"}, GetInspectedLabels(first.get()));
+  EXPECT_EQ(0, std::count(host_.requested_services.begin(),
+                          host_.requested_services.end(),
+                          EnvironmentInspector::Name_));
+
+  ServiceProviderPtr services;
+  second->GetServices(services.NewRequest());
+  ConnectToService<ServiceMetrics>(services.get());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(0, std::count(host_.requested_services.begin(),
+                          host_.requested_services.end(),
+                          ServiceMetrics::Name_));
+  environment->GetServices(services.NewRequest());
+  ConnectToService<ServiceMetrics>(services.get());
+  message_loop_.RunUntilIdle();
+  EXPECT_EQ(1, std::count(host_.requested_services.begin(),
+                          host_.requested_services.end(),
+                          ServiceMetrics::Name_));
+}
+
+}  // namespace
+}  // namespace app
@@ -10,16 +10,67 @@
 
 #include <utility>
 
+#include "lib/mtl/tasks/message_loop.h"
 #include "lib/mtl/vmo/file.h"
 
 namespace app {
 
+// Sits between the client's ApplicationController and the one given to the
+// runner so that the holder knows how many applications are running.
+class ApplicationRunnerHolder::ApplicationProxy : public ApplicationController {
+ public:
+  ApplicationProxy(ApplicationRunnerHolder* holder,
+                   ApplicationEnvironmentImpl* environment,
+                   fidl::InterfaceRequest<ApplicationController> request,
+                   ApplicationControllerPtr controller)
+      : holder_(holder),
+        environment_(environment),
+        binding_(this),
+        controller_(std::move(controller)) {
+    // The runner closes |controller_| when the application exits.
+    controller_.set_connection_error_handler(
+        [this] { holder_->RemoveApplication(this); });
+    if (request.is_pending()) {
+      binding_.Bind(std::move(request));
+      binding_.set_connection_error_handler(
+          [this] { holder_->RemoveApplication(this); });
+    } else {
+      controller_->Detach();
+    }
+  }
+
+  ApplicationEnvironmentImpl* environment() const { return environment_; }
+
+  // |ApplicationController| implementation:
+  void Kill() override { controller_->Kill(); }
+
+  void Detach() override {
+    controller_->Detach();
+    binding_.set_connection_error_handler(ftl::Closure());
+  }
+
+ private:
+  ApplicationRunnerHolder* const holder_;
+  ApplicationEnvironmentImpl* const environment_;
+  fidl::Binding<ApplicationController> binding_;
+  ApplicationControllerPtr controller_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationProxy);
+};
+
 ApplicationRunnerHolder::ApplicationRunnerHolder(
     ServiceProviderPtr services,
-    ApplicationControllerPtr controller)
-    : services_(std::move(services)), controller_(std::move(controller)) {
+    ApplicationControllerPtr controller,
+    ftl::TimeDelta idle_timeout,
+    ftl::Closure idle_callback)
+    : services_(std::move(services)),
+      controller_(std::move(controller)),
+      idle_timeout_(idle_timeout),
+      idle_callback_(std::move(idle_callback)),
+      weak_ptr_factory_(this) {
   services_->ConnectToService(ApplicationRunner::Name_,
                               runner_.NewRequest().PassChannel());
+  ScheduleIdleCheck();
 }
 
 ApplicationRunnerHolder::~ApplicationRunnerHolder() = default;
@@ -27,9 +78,55 @@ ApplicationRunnerHolder::~ApplicationRunnerHolder() = default;
 void ApplicationRunnerHolder::StartApplication(
     ApplicationPackagePtr package,
     ApplicationStartupInfoPtr startup_info,
-    fidl::InterfaceRequest<ApplicationController> controller) {
+    fidl::InterfaceRequest<ApplicationController> controller,
+    ApplicationEnvironmentImpl* environment) {
+  ApplicationControllerPtr application_controller;
   runner_->StartApplication(std::move(package), std::move(startup_info),
-                            std::move(controller));
+                            application_controller.NewRequest());
+  auto application = std::make_unique<ApplicationProxy>(
+      this, environment, std::move(controller),
+      std::move(application_controller));
+  ApplicationProxy* key = application.get();
+  applications_.emplace(key, std::move(application));
+  ++started_count_;
+  ++idle_generation_;
+}
+
+void ApplicationRunnerHolder::KillApplications(
+    ApplicationEnvironmentImpl* environment) {
+  // Closing the runner's controller kills the application.
+  for (auto it = applications_.begin(); it != applications_.end();) {
+    if (it->first->environment() == environment)
+      it = applications_.erase(it);
+    else
+      ++it;
+  }
+  if (applications_.empty())
+    ScheduleIdleCheck();
+}
+
+void ApplicationRunnerHolder::RemoveApplication(ApplicationProxy* application) {
+  applications_.erase(application);
+  if (applications_.empty())
+    ScheduleIdleCheck();
+}
+
+void ApplicationRunnerHolder::ScheduleIdleCheck() {
+  if (idle_timeout_ <= ftl::TimeDelta::Zero() || !idle_callback_)
+    return;
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [ weak_this = weak_ptr_factory_.GetWeakPtr(),
+        generation = ++idle_generation_ ] {
+        // Starting an application bumps the generation, which cancels the
+        // check.
+        if (weak_this && weak_this->idle_generation_ == generation &&
+            weak_this->applications_.empty()) {
+          // The callback typically destroys this holder.
+          ftl::Closure callback = weak_this->idle_callback_;
+          callback();
+        }
+      },
+      idle_timeout_);
 }
 
 }  // namespace app
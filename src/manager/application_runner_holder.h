@@ -7,29 +7,69 @@
 
 #include <mx/vmo.h>
 
+#include <memory>
+#include <unordered_map>
+
 #include "application/services/application_controller.fidl.h"
 #include "application/services/application_runner.fidl.h"
+#include "lib/fidl/cpp/bindings/binding.h"
 #include "lib/ftl/files/unique_fd.h"
+#include "lib/ftl/functional/closure.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_delta.h"
 
 namespace app {
+class ApplicationEnvironmentImpl;
 
 class ApplicationRunnerHolder {
  public:
+  // If |idle_timeout| is positive, |idle_callback| is called once the runner
+  // has had no applications for that long. Otherwise the runner is kept alive
+  // indefinitely.
   ApplicationRunnerHolder(ServiceProviderPtr services,
-                          ApplicationControllerPtr controller);
+                          ApplicationControllerPtr controller,
+                          ftl::TimeDelta idle_timeout,
+                          ftl::Closure idle_callback);
   ~ApplicationRunnerHolder();
 
+  // The number of applications started through this runner that are still
+  // running.
+  size_t application_count() const { return applications_.size(); }
+  // The number of applications started through this runner.
+  uint64_t started_count() const { return started_count_; }
+
+  // Starts an application on behalf of |environment|, which need not be the
+  // environment that owns this runner.
   void StartApplication(
       ApplicationPackagePtr package,
       ApplicationStartupInfoPtr startup_info,
-      fidl::InterfaceRequest<ApplicationController> controller);
+      fidl::InterfaceRequest<ApplicationController> controller,
+      ApplicationEnvironmentImpl* environment);
+
+  // Kills the applications started on behalf of |environment|.
+  void KillApplications(ApplicationEnvironmentImpl* environment);
 
  private:
+  class ApplicationProxy;
+
+  void RemoveApplication(ApplicationProxy* application);
+  void ScheduleIdleCheck();
+
   ServiceProviderPtr services_;
   ApplicationControllerPtr controller_;
   ApplicationRunnerPtr runner_;
 
+  ftl::TimeDelta idle_timeout_;
+  ftl::Closure idle_callback_;
+  uint64_t idle_generation_ = 0u;
+  uint64_t started_count_ = 0u;
+
+  std::unordered_map<ApplicationProxy*, std::unique_ptr<ApplicationProxy>>
+      applications_;
+
+  ftl::WeakPtrFactory<ApplicationRunnerHolder> weak_ptr_factory_;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationRunnerHolder);
 };
 
@@ -0,0 +1,113 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/application_runner_pool.h"
+
+#include <utility>
+
+namespace app {
+namespace {
+
+constexpr ftl::TimeDelta kDefaultScaleDownDelay =
+    ftl::TimeDelta::FromSeconds(30);
+
+}  // namespace
+
+ApplicationRunnerPool::ApplicationRunnerPool(Policy policy,
+                                             InstanceFactory factory,
+                                             ftl::Closure exit_callback,
+                                             ftl::Closure idle_callback)
+    : policy_(policy),
+      factory_(std::move(factory)),
+      exit_callback_(std::move(exit_callback)),
+      idle_callback_(std::move(idle_callback)) {
+  FTL_DCHECK(policy_.min_instances >= 1u);
+  FTL_DCHECK(policy_.max_instances >= policy_.min_instances);
+  for (size_t i = 0; i < policy_.min_instances; ++i)
+    AddInstance();
+}
+
+ApplicationRunnerPool::~ApplicationRunnerPool() = default;
+
+void ApplicationRunnerPool::StartApplication(
+    ApplicationPackagePtr package,
+    ApplicationStartupInfoPtr startup_info,
+    fidl::InterfaceRequest<ApplicationController> controller,
+    ApplicationEnvironmentImpl* environment) {
+  SelectInstance()->StartApplication(std::move(package),
+                                     std::move(startup_info),
+                                     std::move(controller), environment);
+}
+
+void ApplicationRunnerPool::KillApplications(
+    ApplicationEnvironmentImpl* environment) {
+  for (auto& instance : instances_)
+    instance.second->KillApplications(environment);
+}
+
+fidl::Array<RunnerInstanceInfoPtr> ApplicationRunnerPool::GetInstanceInfo()
+    const {
+  auto result = fidl::Array<RunnerInstanceInfoPtr>::New(0);
+  for (const auto& instance : instances_) {
+    auto info = RunnerInstanceInfo::New();
+    info->application_count = instance.second->application_count();
+    info->started_count = instance.second->started_count();
+    result.push_back(std::move(info));
+  }
+  return result;
+}
+
+ApplicationRunnerHolder* ApplicationRunnerPool::AddInstance() {
+  InstanceId id = next_instance_id_++;
+  ftl::TimeDelta idle_timeout = policy_.idle_timeout;
+  if (idle_timeout <= ftl::TimeDelta::Zero() &&
+      policy_.max_instances > policy_.min_instances)
+    idle_timeout = kDefaultScaleDownDelay;
+  auto instance =
+      factory_(idle_timeout, [this, id] { OnInstanceExited(id); },
+               [this, id] { OnInstanceIdle(id); });
+  ApplicationRunnerHolder* result = instance.get();
+  instances_.emplace(id, std::move(instance));
+  return result;
+}
+
+ApplicationRunnerHolder* ApplicationRunnerPool::SelectInstance() {
+  FTL_DCHECK(!instances_.empty());
+  ApplicationRunnerHolder* least_loaded = nullptr;
+  for (const auto& instance : instances_) {
+    if (!least_loaded || instance.second->application_count() <
+                             least_loaded->application_count())
+      least_loaded = instance.second.get();
+  }
+  if (policy_.applications_per_instance &&
+      least_loaded->application_count() >= policy_.applications_per_instance &&
+      instances_.size() < policy_.max_instances)
+    return AddInstance();
+  return least_loaded;
+}
+
+void ApplicationRunnerPool::OnInstanceExited(InstanceId id) {
+  instances_.erase(id);
+  if (instances_.empty()) {
+    // The callback typically destroys this pool.
+    ftl::Closure callback = exit_callback_;
+    callback();
+  }
+}
+
+void ApplicationRunnerPool::OnInstanceIdle(InstanceId id) {
+  if (instances_.size() > policy_.min_instances) {
+    instances_.erase(id);
+    return;
+  }
+  if (policy_.idle_timeout <= ftl::TimeDelta::Zero())
+    return;
+  instances_.erase(id);
+  if (instances_.empty()) {
+    ftl::Closure callback = idle_callback_;
+    callback();
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,91 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_APPLICATION_RUNNER_POOL_H_
+#define APPLICATION_SRC_MANAGER_APPLICATION_RUNNER_POOL_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "application/services/environment_inspector.fidl.h"
+#include "application/src/manager/application_runner_holder.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
+
+namespace app {
+
+// A set of instances of the same runner. Each application goes to the
+// instance running the fewest applications, and instances are added under
+// load and removed when idle.
+class ApplicationRunnerPool {
+ public:
+  struct Policy {
+    // The number of instances kept running while the pool exists.
+    size_t min_instances = 1u;
+    size_t max_instances = 1u;
+    // A new instance is started when every instance runs at least this many
+    // applications. Zero means instances are only added up to
+    // |min_instances|.
+    size_t applications_per_instance = 0u;
+    // If positive, the pool stops its last instances once they have been idle
+    // for this long. Instances above |min_instances| are stopped after
+    // |idle_timeout| or, if it is zero, after a short default delay.
+    ftl::TimeDelta idle_timeout;
+  };
+
+  // Starts a runner instance. The pool passes the callbacks to run when the
+  // instance's process exits and when the instance becomes idle.
+  using InstanceFactory =
+      std::function<std::unique_ptr<ApplicationRunnerHolder>(
+          ftl::TimeDelta idle_timeout,
+          ftl::Closure exit_callback,
+          ftl::Closure idle_callback)>;
+
+  // |exit_callback| is called when the last instance exits and
+  // |idle_callback| when the last instance is stopped for being idle. Either
+  // callback may destroy the pool.
+  ApplicationRunnerPool(Policy policy,
+                        InstanceFactory factory,
+                        ftl::Closure exit_callback,
+                        ftl::Closure idle_callback);
+  ~ApplicationRunnerPool();
+
+  size_t instance_count() const { return instances_.size(); }
+
+  void StartApplication(
+      ApplicationPackagePtr package,
+      ApplicationStartupInfoPtr startup_info,
+      fidl::InterfaceRequest<ApplicationController> controller,
+      ApplicationEnvironmentImpl* environment);
+
+  // Kills the applications started on behalf of |environment|.
+  void KillApplications(ApplicationEnvironmentImpl* environment);
+
+  // Describes the load on each instance.
+  fidl::Array<RunnerInstanceInfoPtr> GetInstanceInfo() const;
+
+ private:
+  using InstanceId = uint64_t;
+
+  ApplicationRunnerHolder* AddInstance();
+  ApplicationRunnerHolder* SelectInstance();
+  void OnInstanceExited(InstanceId id);
+  void OnInstanceIdle(InstanceId id);
+
+  const Policy policy_;
+  InstanceFactory factory_;
+  ftl::Closure exit_callback_;
+  ftl::Closure idle_callback_;
+
+  InstanceId next_instance_id_ = 1u;
+  std::map<InstanceId, std::unique_ptr<ApplicationRunnerHolder>> instances_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ApplicationRunnerPool);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_APPLICATION_RUNNER_POOL_H_
@@ -7,7 +7,9 @@
 #include <stdio.h>
 #include <utility>
 
+#include "application/lib/timeline/recorder.h"
 #include "lib/ftl/files/file.h"
+#include "lib/ftl/time/time_point.h"
 #include "third_party/rapidjson/rapidjson/document.h"
 
 namespace app {
@@ -16,29 +18,194 @@ namespace {
 constexpr char kInitialApps[] = "initial-apps";
 constexpr char kPath[] = "path";
 constexpr char kInclude[] = "include";
+constexpr char kEnvironmentBudgets[] = "environment-budgets";
+constexpr char kMaxProcesses[] = "max-processes";
+constexpr char kMaxMemoryBytes[] = "max-memory-bytes";
+constexpr char kRunners[] = "runners";
+constexpr char kUrl[] = "url";
+constexpr char kEnvironments[] = "environments";
+constexpr char kIdleTimeoutSeconds[] = "idle-timeout-seconds";
+constexpr char kMinInstances[] = "min-instances";
+constexpr char kMaxInstances[] = "max-instances";
+constexpr char kApplicationsPerInstance[] = "applications-per-instance";
+constexpr char kMemoryPressure[] = "memory-pressure";
+constexpr char kWarningBytes[] = "warning-bytes";
+constexpr char kCriticalBytes[] = "critical-bytes";
+constexpr char kIdleSeconds[] = "idle-seconds";
+constexpr char kCheckIntervalSeconds[] = "check-interval-seconds";
+constexpr char kNeverKill[] = "never-kill";
+constexpr char kPrefetch[] = "prefetch";
+constexpr char kMaxPackages[] = "max-packages";
+constexpr char kMaxBytes[] = "max-bytes";
+constexpr char kTtlSeconds[] = "ttl-seconds";
+constexpr char kMinPercent[] = "min-percent";
+constexpr char kMaxInFlight[] = "max-in-flight";
+
+template <typename Value>
+bool ParseCount(const Value& value, const char* name, size_t* count) {
+  auto it = value.FindMember(name);
+  if (it == value.MemberEnd())
+    return true;
+  if (!it->value.IsUint())
+    return false;
+  *count = it->value.GetUint();
+  return true;
+}
+
+template <typename Value>
+bool ParseBudget(const Value& value, EnvironmentBudgetPtr* budget) {
+  if (!value.IsObject())
+    return false;
+  auto result = EnvironmentBudget::New();
+  auto max_processes_it = value.FindMember(kMaxProcesses);
+  if (max_processes_it != value.MemberEnd()) {
+    if (!max_processes_it->value.IsUint())
+      return false;
+    result->max_processes = max_processes_it->value.GetUint();
+  }
+  auto max_memory_bytes_it = value.FindMember(kMaxMemoryBytes);
+  if (max_memory_bytes_it != value.MemberEnd()) {
+    if (!max_memory_bytes_it->value.IsUint64())
+      return false;
+    result->max_memory_bytes = max_memory_bytes_it->value.GetUint64();
+  }
+  *budget = std::move(result);
+  return true;
+}
+
+template <typename Value>
+bool ParseRunner(const Value& value, RunnerConfig* runner) {
+  if (!value.IsObject())
+    return false;
+  auto url_it = value.FindMember(kUrl);
+  if (url_it == value.MemberEnd() || !url_it->value.IsString())
+    return false;
+  runner->url = url_it->value.GetString();
+  auto environments_it = value.FindMember(kEnvironments);
+  if (environments_it != value.MemberEnd()) {
+    if (!environments_it->value.IsArray())
+      return false;
+    for (const auto& label : environments_it->value.GetArray()) {
+      if (!label.IsString())
+        return false;
+      runner->environments.push_back(label.GetString());
+    }
+  }
+  auto idle_timeout_it = value.FindMember(kIdleTimeoutSeconds);
+  if (idle_timeout_it != value.MemberEnd()) {
+    if (!idle_timeout_it->value.IsUint())
+      return false;
+    runner->idle_timeout =
+        ftl::TimeDelta::FromSeconds(idle_timeout_it->value.GetUint());
+  }
+  if (!ParseCount(value, kMinInstances, &runner->min_instances) ||
+      !ParseCount(value, kApplicationsPerInstance,
+                  &runner->applications_per_instance))
+    return false;
+  runner->max_instances = runner->min_instances;
+  if (!ParseCount(value, kMaxInstances, &runner->max_instances))
+    return false;
+  return runner->min_instances >= 1u &&
+         runner->max_instances >= runner->min_instances;
+}
+
+template <typename Value>
+bool ParseBytes(const Value& value, const char* name, uint64_t* bytes) {
+  auto it = value.FindMember(name);
+  if (it == value.MemberEnd())
+    return true;
+  if (!it->value.IsUint64())
+    return false;
+  *bytes = it->value.GetUint64();
+  return true;
+}
+
+template <typename Value>
+bool ParseSeconds(const Value& value, const char* name, ftl::TimeDelta* delta) {
+  auto it = value.FindMember(name);
+  if (it == value.MemberEnd())
+    return true;
+  if (!it->value.IsUint())
+    return false;
+  *delta = ftl::TimeDelta::FromSeconds(it->value.GetUint());
+  return true;
+}
+
+template <typename Value>
+bool ParseMemoryPressure(const Value& value, MemoryPressureConfig* config) {
+  if (!value.IsObject())
+    return false;
+  if (!ParseBytes(value, kWarningBytes, &config->warning_bytes) ||
+      !ParseBytes(value, kCriticalBytes, &config->critical_bytes) ||
+      !ParseSeconds(value, kIdleSeconds, &config->idle_time) ||
+      !ParseSeconds(value, kCheckIntervalSeconds, &config->check_interval))
+    return false;
+  auto never_kill_it = value.FindMember(kNeverKill);
+  if (never_kill_it != value.MemberEnd()) {
+    if (!never_kill_it->value.IsArray())
+      return false;
+    for (const auto& url : never_kill_it->value.GetArray()) {
+      if (!url.IsString())
+        return false;
+      config->never_kill.push_back(url.GetString());
+    }
+  }
+  if (config->critical_bytes && config->critical_bytes < config->warning_bytes)
+    return false;
+  return config->check_interval > ftl::TimeDelta::Zero();
+}
+
+template <typename Value>
+bool ParsePrefetch(const Value& value, PrefetchConfig* config) {
+  if (!value.IsObject())
+    return false;
+  size_t min_percent = config->min_percent;
+  if (!ParseCount(value, kMaxPackages, &config->max_packages) ||
+      !ParseBytes(value, kMaxBytes, &config->max_bytes) ||
+      !ParseSeconds(value, kTtlSeconds, &config->ttl) ||
+      !ParseCount(value, kMinPercent, &min_percent) || min_percent > 100u ||
+      !ParseCount(value, kMaxInFlight, &config->max_in_flight))
+    return false;
+  config->min_percent = min_percent;
+  return config->max_in_flight > 0u;
+}
 
 }  // namespace
 
 bool Config::ReadIfExistsFrom(const std::string& config_file) {
+  ftl::TimePoint start = ftl::TimePoint::Now();
   std::string data;
   if (!files::ReadFileToString(config_file, &data)) {
     fprintf(stderr, "appmgr: Ignoring missing config file: %s\n",
             config_file.c_str());
     return true;
   }
-  if (!Parse(data)) {
+  json_snapshot::Value root;
+  bool parsed = snapshot_.Find(config_file, data, &root) ? ParseDocument(root)
+                                                         : Parse(data);
+  if (!parsed) {
     fprintf(stderr, "appmgr: Failed to parse config file: %s\n",
             config_file.c_str());
     return false;
   }
+  timeline::Complete("config", config_file, start);
   return true;
 }
 
-bool Config::Parse(const std::string& string) {
-  initial_apps_.clear();
+bool Config::LoadSnapshot(const std::string& path) {
+  return snapshot_.Load(path);
+}
 
+bool Config::Parse(const std::string& string) {
   rapidjson::Document document;
   document.Parse(string);
+  return ParseDocument(document);
+}
+
+template <typename Value>
+bool Config::ParseDocument(const Value& document) {
+  initial_apps_.clear();
+
   if (!document.IsObject())
     return false;
 
@@ -80,6 +247,44 @@ bool Config::Parse(const std::string& string) {
     }
   }
 
+  auto budgets_it = document.FindMember(kEnvironmentBudgets);
+  if (budgets_it != document.MemberEnd()) {
+    const auto& value = budgets_it->value;
+    if (!value.IsObject())
+      return false;
+    for (const auto& member : value.GetObject()) {
+      EnvironmentBudgetPtr budget;
+      if (!ParseBudget(member.value, &budget))
+        return false;
+      environment_budgets_[member.name.GetString()] = std::move(budget);
+    }
+  }
+
+  auto runners_it = document.FindMember(kRunners);
+  if (runners_it != document.MemberEnd()) {
+    const auto& value = runners_it->value;
+    if (!value.IsArray())
+      return false;
+    for (const auto& entry : value.GetArray()) {
+      RunnerConfig runner;
+      if (!ParseRunner(entry, &runner))
+        return false;
+      runners_.push_back(std::move(runner));
+    }
+  }
+
+  auto memory_pressure_it = document.FindMember(kMemoryPressure);
+  if (memory_pressure_it != document.MemberEnd()) {
+    if (!ParseMemoryPressure(memory_pressure_it->value, &memory_pressure_))
+      return false;
+  }
+
+  auto prefetch_it = document.FindMember(kPrefetch);
+  if (prefetch_it != document.MemberEnd()) {
+    if (!ParsePrefetch(prefetch_it->value, &prefetch_))
+      return false;
+  }
+
   auto include_it = document.FindMember(kInclude);
   if (include_it != document.MemberEnd()) {
     const auto& value = include_it->value;
@@ -104,4 +309,13 @@ std::vector<ApplicationLaunchInfoPtr> Config::TakeInitialApps() {
   return std::move(initial_apps_);
 }
 
+std::unordered_map<std::string, EnvironmentBudgetPtr>
+Config::TakeEnvironmentBudgets() {
+  return std::move(environment_budgets_);
+}
+
+std::vector<RunnerConfig> Config::TakeRunners() {
+  return std::move(runners_);
+}
+
 }  // namespace app
@@ -6,10 +6,14 @@
 #define APPLICATION_SRC_MANAGER_CONFIG_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "application/lib/json_snapshot/snapshot.h"
 #include "application/services/application_launcher.fidl.h"
+#include "application/services/environment_budget.fidl.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
 
 namespace app {
 
@@ -24,14 +28,120 @@ namespace app {
 //   ],
 //   "include": [
 //     "/system/data/appmgr/startup.config"
-//   ]
+//   ],
+//   "environment-budgets": {
+//     "root": { "max-memory-bytes": 1073741824 },
+//     "tenant": { "max-processes": 32, "max-memory-bytes": 268435456 }
+//   },
+//   "runners": [
+//     {
+//       "url": "file:///system/apps/dart_runner",
+//       "environments": [ "root", "tenant" ],
+//       "idle-timeout-seconds": 300,
+//       "min-instances": 1,
+//       "max-instances": 4,
+//       "applications-per-instance": 8
+//     }
+//   ],
+//   "memory-pressure": {
+//     "warning-bytes": 402653184,
+//     "critical-bytes": 469762048,
+//     "idle-seconds": 60,
+//     "check-interval-seconds": 2,
+//     "never-kill": [ "file:///system/apps/device_runner" ]
+//   },
+//   "prefetch": {
+//     "max-packages": 4,
+//     "max-bytes": 67108864,
+//     "ttl-seconds": 30,
+//     "min-percent": 50,
+//     "max-in-flight": 1
+//   }
 // }
+//
+// Runners listed under "runners" are started as soon as an environment whose
+// label appears in "environments" is created, or in every environment if
+// "environments" is omitted. The "url" must match the runner named on the
+// "#!fuchsia" line of the applications it runs. A runner that has run no
+// applications for "idle-timeout-seconds" is stopped; without a timeout, it is
+// restarted whenever it exits.
+//
+// A runner with "max-instances" above one is run as a pool. Applications go to
+// the instance running the fewest applications, and a new instance is started
+// when every instance runs at least "applications-per-instance" applications.
+// Instances above "min-instances" are stopped once idle.
+//
+// When the applications run by appmgr use more than "warning-bytes" of
+// private memory, appmgr kills applications that have been idle for
+// "idle-seconds" until the total drops below "warning-bytes", starting with
+// those in background environments. Above "critical-bytes", it kills
+// applications that are not idle as well. Applications listed in "never-kill",
+// the initial apps and runners are never killed; list the applications that
+// host environments, since killing one takes down the environments it hosts.
+//
+// An application is idle while its memory use does not change and no
+// application in its environment connects to the environment's services.
+// Calls over channels that applications already hold are not seen, so an
+// application that serves existing connections without allocating looks
+// idle; list such applications in "never-kill" as well.
+//
+// With "prefetch", appmgr records which applications are launched after
+// which in each environment. When an application is launched, the packages
+// of the applications that followed at least "min-percent" percent of its
+// previous launches are loaded ahead of time, up to "max-packages" packages
+// and "max-bytes" bytes per environment. Each environment loads at most
+// "max-in-flight" packages ahead of time at once, apart from its launches.
+// Prefetched packages unused after "ttl-seconds" are dropped.
+
+// A runner that is started ahead of the applications that need it.
+struct RunnerConfig {
+  std::string url;
+  // The labels of the environments in which to start the runner. Empty means
+  // every environment.
+  std::vector<std::string> environments;
+  // Zero means the runner is kept alive indefinitely.
+  ftl::TimeDelta idle_timeout;
+  size_t min_instances = 1u;
+  size_t max_instances = 1u;
+  // Zero means instances are only added up to |min_instances|.
+  size_t applications_per_instance = 0u;
+};
+
+// Thresholds for reclaiming memory from idle applications.
+struct MemoryPressureConfig {
+  // Zero disables reclamation.
+  uint64_t warning_bytes = 0u;
+  // Zero means only idle applications are killed.
+  uint64_t critical_bytes = 0u;
+  ftl::TimeDelta idle_time = ftl::TimeDelta::FromSeconds(60);
+  ftl::TimeDelta check_interval = ftl::TimeDelta::FromSeconds(2);
+  // The URLs of applications that are never killed, whatever their memory use.
+  std::vector<std::string> never_kill;
+};
+
+// Loading of the packages likely to be launched next.
+struct PrefetchConfig {
+  // Zero disables prefetching.
+  size_t max_packages = 0u;
+  // Zero means no limit.
+  uint64_t max_bytes = 0u;
+  ftl::TimeDelta ttl = ftl::TimeDelta::FromSeconds(30);
+  uint32_t min_percent = 50u;
+  // The number of packages each environment loads at once. Prefetches do not
+  // count against the environment's launch limit.
+  size_t max_in_flight = 1u;
+};
 
 class Config {
  public:
   Config() = default;
   ~Config() = default;
 
+  // Loads a snapshot made by config_compiler. Config files that the snapshot
+  // holds with their current contents are then read from the snapshot instead
+  // of being parsed.
+  bool LoadSnapshot(const std::string& path);
+
   bool ReadIfExistsFrom(const std::string& config_file);
 
   // Gets path for finding apps on root file system.
@@ -40,12 +150,34 @@ class Config {
   // Gets initial apps to launch.
   std::vector<ApplicationLaunchInfoPtr> TakeInitialApps();
 
+  // Gets the budgets for environments, keyed by environment label.
+  std::unordered_map<std::string, EnvironmentBudgetPtr>
+  TakeEnvironmentBudgets();
+
+  // Gets the runners to start ahead of time.
+  std::vector<RunnerConfig> TakeRunners();
+
+  // Gets the memory pressure thresholds.
+  const MemoryPressureConfig& memory_pressure() const {
+    return memory_pressure_;
+  }
+
+  // Gets the prefetching settings.
+  const PrefetchConfig& prefetch() const { return prefetch_; }
+
  private:
   bool Parse(const std::string& string);
+  template <typename Value>
+  bool ParseDocument(const Value& document);
   bool ReadFromIfExists(const std::string& config_file);
 
   std::vector<std::string> path_;
   std::vector<ApplicationLaunchInfoPtr> initial_apps_;
+  std::unordered_map<std::string, EnvironmentBudgetPtr> environment_budgets_;
+  std::vector<RunnerConfig> runners_;
+  MemoryPressureConfig memory_pressure_;
+  PrefetchConfig prefetch_;
+  json_snapshot::Snapshot snapshot_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(Config);
 };
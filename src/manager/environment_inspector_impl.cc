@@ -0,0 +1,131 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/environment_inspector_impl.h"
+
+#include <utility>
+
+#include "application/src/manager/application_controller_impl.h"
+#include "application/src/manager/application_environment_impl.h"
+#include "lib/fidl/cpp/bindings/binding_set.h"
+#include "lib/fidl/cpp/bindings/interface_ptr_set.h"
+
+namespace app {
+
+// Inspects one environment and the environments nested inside it.
+class EnvironmentInspectorImpl::Scope : public EnvironmentInspector {
+ public:
+  Scope(const EnvironmentInspectorImpl* owner,
+        const ApplicationEnvironmentImpl* environment)
+      : owner_(owner), environment_(environment) {}
+
+  void AddBinding(fidl::InterfaceRequest<EnvironmentInspector> request) {
+    bindings_.AddBinding(this, std::move(request));
+  }
+
+  fidl::InterfacePtrSet<EnvironmentWatcher>& watchers() { return watchers_; }
+
+  // EnvironmentInspector implementation:
+
+  void GetSnapshot(const GetSnapshotCallback& callback) override {
+    auto environments = fidl::Array<EnvironmentInfoPtr>::New(0);
+    environment_->AppendSnapshot(&environments);
+    callback(owner_->version_, std::move(environments));
+  }
+
+  void Watch(fidl::InterfaceHandle<EnvironmentWatcher> watcher) override {
+    watchers_.AddInterfacePtr(
+        EnvironmentWatcherPtr::Create(std::move(watcher)));
+  }
+
+ private:
+  const EnvironmentInspectorImpl* const owner_;
+  const ApplicationEnvironmentImpl* const environment_;
+  fidl::BindingSet<EnvironmentInspector> bindings_;
+  fidl::InterfacePtrSet<EnvironmentWatcher> watchers_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(Scope);
+};
+
+EnvironmentInspectorImpl::EnvironmentInspectorImpl() = default;
+
+EnvironmentInspectorImpl::~EnvironmentInspectorImpl() = default;
+
+void EnvironmentInspectorImpl::AddBinding(
+    const ApplicationEnvironmentImpl* environment,
+    fidl::InterfaceRequest<EnvironmentInspector> request) {
+  auto& scope = scopes_[environment];
+  if (!scope)
+    scope = std::make_unique<Scope>(this, environment);
+  scope->AddBinding(std::move(request));
+}
+
+void EnvironmentInspectorImpl::OnEnvironmentCreated(
+    const ApplicationEnvironmentImpl& environment) {
+  ++version_;
+  ForEachScope(environment, [this, &environment](Scope* scope) {
+    if (scope->watchers().size() == 0u)
+      return;
+    scope->watchers().ForAllPtrs(
+        [this, &environment](EnvironmentWatcher* watcher) {
+          watcher->OnEnvironmentCreated(version_, environment.GetInfo());
+        });
+  });
+}
+
+void EnvironmentInspectorImpl::OnEnvironmentDestroyed(
+    const ApplicationEnvironmentImpl& environment) {
+  ++version_;
+  ForEachScope(environment, [this, &environment](Scope* scope) {
+    scope->watchers().ForAllPtrs(
+        [this, &environment](EnvironmentWatcher* watcher) {
+          watcher->OnEnvironmentDestroyed(version_, environment.koid());
+        });
+  });
+  // The inspector of the environment must not outlive it.
+  scopes_.erase(&environment);
+}
+
+void EnvironmentInspectorImpl::OnApplicationStarted(
+    const ApplicationEnvironmentImpl& environment,
+    const ApplicationControllerImpl& application) {
+  ++version_;
+  ForEachScope(environment, [this, &environment, &application](Scope* scope) {
+    if (scope->watchers().size() == 0u)
+      return;
+    scope->watchers().ForAllPtrs(
+        [this, &environment, &application](EnvironmentWatcher* watcher) {
+          watcher->OnApplicationStarted(version_, environment.koid(),
+                                        application.GetInfo());
+        });
+  });
+}
+
+void EnvironmentInspectorImpl::OnApplicationTerminated(
+    const ApplicationEnvironmentImpl& environment,
+    const ApplicationControllerImpl& application) {
+  ++version_;
+  ForEachScope(environment, [this, &environment, &application](Scope* scope) {
+    scope->watchers().ForAllPtrs(
+        [this, &environment, &application](EnvironmentWatcher* watcher) {
+          watcher->OnApplicationTerminated(version_, environment.koid(),
+                                           application.koid());
+        });
+  });
+}
+
+void EnvironmentInspectorImpl::ForEachScope(
+    const ApplicationEnvironmentImpl& environment,
+    const std::function<void(Scope*)>& callback) {
+  if (scopes_.empty())
+    return;
+  for (const ApplicationEnvironmentImpl* env = &environment; env;
+       env = env->parent()) {
+    auto it = scopes_.find(env);
+    if (it != scopes_.end())
+      callback(it->second.get());
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,58 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_ENVIRONMENT_INSPECTOR_IMPL_H_
+#define APPLICATION_SRC_MANAGER_ENVIRONMENT_INSPECTOR_IMPL_H_
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "application/services/environment_inspector.fidl.h"
+#include "lib/fidl/cpp/bindings/interface_request.h"
+#include "lib/ftl/macros.h"
+
+namespace app {
+class ApplicationControllerImpl;
+class ApplicationEnvironmentImpl;
+
+// Serves the environment tree to tools. Each environment provides an
+// inspector that only sees that environment and the ones nested inside it, so
+// that applications cannot enumerate the environments beside their own.
+// Environments report changes to the tree, which are forwarded to the
+// watchers of every inspector that sees them.
+class EnvironmentInspectorImpl {
+ public:
+  EnvironmentInspectorImpl();
+  ~EnvironmentInspectorImpl();
+
+  // Binds |request| to the inspector of |environment|.
+  void AddBinding(const ApplicationEnvironmentImpl* environment,
+                  fidl::InterfaceRequest<EnvironmentInspector> request);
+
+  void OnEnvironmentCreated(const ApplicationEnvironmentImpl& environment);
+  void OnEnvironmentDestroyed(const ApplicationEnvironmentImpl& environment);
+  void OnApplicationStarted(const ApplicationEnvironmentImpl& environment,
+                            const ApplicationControllerImpl& application);
+  void OnApplicationTerminated(const ApplicationEnvironmentImpl& environment,
+                               const ApplicationControllerImpl& application);
+
+ private:
+  class Scope;
+
+  // Calls |callback| with the inspectors that see |environment|.
+  void ForEachScope(const ApplicationEnvironmentImpl& environment,
+                    const std::function<void(Scope*)>& callback);
+
+  // Only holds the environments that have been inspected.
+  std::unordered_map<const ApplicationEnvironmentImpl*, std::unique_ptr<Scope>>
+      scopes_;
+  uint64_t version_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(EnvironmentInspectorImpl);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_ENVIRONMENT_INSPECTOR_IMPL_H_
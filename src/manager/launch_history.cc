@@ -0,0 +1,121 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_history.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace app {
+namespace {
+
+constexpr size_t kMaxEnvironments = 32u;
+constexpr size_t kMaxUrlsPerEnvironment = 256u;
+constexpr size_t kMaxSuccessors = 8u;
+// Counts are halved once a URL has been launched this many times.
+constexpr uint32_t kMaxLaunches = 1024u;
+
+}  // namespace
+
+LaunchHistory::LaunchHistory() = default;
+
+LaunchHistory::~LaunchHistory() = default;
+
+void LaunchHistory::RecordLaunch(const std::string& environment,
+                                 const std::string& url) {
+  EnvironmentHistory* history = GetEnvironment(environment);
+
+  if (history->nodes.size() >= kMaxUrlsPerEnvironment &&
+      !history->nodes.count(url)) {
+    // Make room by forgetting the least launched URL.
+    auto least = std::min_element(
+        history->nodes.begin(), history->nodes.end(),
+        [](const std::pair<const std::string, Node>& lhs,
+           const std::pair<const std::string, Node>& rhs) {
+          return lhs.second.launches < rhs.second.launches;
+        });
+    if (least->first == history->last_url)
+      history->last_url.clear();
+    history->nodes.erase(least);
+  }
+  ++history->nodes[url].launches;
+
+  auto previous = history->nodes.find(history->last_url);
+  if (previous != history->nodes.end()) {
+    Node& node = previous->second;
+    if (node.successors.size() >= kMaxSuccessors &&
+        !node.successors.count(url)) {
+      auto least = std::min_element(
+          node.successors.begin(), node.successors.end(),
+          [](const std::pair<const std::string, uint32_t>& lhs,
+             const std::pair<const std::string, uint32_t>& rhs) {
+            return lhs.second < rhs.second;
+          });
+      node.successors.erase(least);
+    }
+    ++node.successors[url];
+
+    if (node.launches >= kMaxLaunches) {
+      node.launches /= 2;
+      for (auto it = node.successors.begin(); it != node.successors.end();) {
+        it->second /= 2;
+        if (it->second)
+          ++it;
+        else
+          it = node.successors.erase(it);
+      }
+    }
+  }
+  history->last_url = url;
+}
+
+std::vector<std::string> LaunchHistory::PredictNext(
+    const std::string& environment,
+    const std::string& url,
+    size_t max_count,
+    uint32_t min_percent) const {
+  std::vector<std::string> result;
+  auto environment_it = environments_.find(environment);
+  if (environment_it == environments_.end())
+    return result;
+  auto node_it = environment_it->second.nodes.find(url);
+  if (node_it == environment_it->second.nodes.end())
+    return result;
+  const Node& node = node_it->second;
+
+  std::vector<std::pair<uint32_t, std::string>> candidates;
+  for (const auto& successor : node.successors) {
+    if (successor.first != url &&
+        uint64_t(successor.second) * 100u >=
+            uint64_t(node.launches) * min_percent)
+      candidates.emplace_back(successor.second, successor.first);
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<uint32_t, std::string>& lhs,
+               const std::pair<uint32_t, std::string>& rhs) {
+              return lhs.first > rhs.first;
+            });
+  for (size_t i = 0; i < candidates.size() && i < max_count; ++i)
+    result.push_back(std::move(candidates[i].second));
+  return result;
+}
+
+LaunchHistory::EnvironmentHistory* LaunchHistory::GetEnvironment(
+    const std::string& environment) {
+  auto it = environments_.find(environment);
+  if (it != environments_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return &it->second;
+  }
+  if (environments_.size() >= kMaxEnvironments) {
+    environments_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(environment);
+  EnvironmentHistory& history = environments_[environment];
+  history.lru_position = lru_.begin();
+  return &history;
+}
+
+}  // namespace app
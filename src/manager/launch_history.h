@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_LAUNCH_HISTORY_H_
+#define APPLICATION_SRC_MANAGER_LAUNCH_HISTORY_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+
+namespace app {
+
+// Remembers which applications tend to be launched after which, per
+// environment, so that the next ones can be loaded ahead of time.
+//
+// For each environment label, the history counts how often each URL was
+// launched and which URL was launched right after it. The history is bounded:
+// only the most recently active environments and, within them, a fixed number
+// of URLs and successors per URL are kept, and counts are halved as they grow
+// so that the history follows changes in behavior.
+class LaunchHistory {
+ public:
+  LaunchHistory();
+  ~LaunchHistory();
+
+  // Records that |url| was launched in the environment labeled |environment|.
+  void RecordLaunch(const std::string& environment, const std::string& url);
+
+  // Returns up to |max_count| URLs that followed at least |min_percent|
+  // percent of the launches of |url| in |environment|, most frequent first.
+  std::vector<std::string> PredictNext(const std::string& environment,
+                                       const std::string& url,
+                                       size_t max_count,
+                                       uint32_t min_percent) const;
+
+ private:
+  struct Node {
+    uint32_t launches = 0u;
+    std::unordered_map<std::string, uint32_t> successors;
+  };
+
+  struct EnvironmentHistory {
+    std::string last_url;
+    std::unordered_map<std::string, Node> nodes;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  EnvironmentHistory* GetEnvironment(const std::string& environment);
+
+  std::unordered_map<std::string, EnvironmentHistory> environments_;
+  // Environment labels, most recently active first.
+  std::list<std::string> lru_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchHistory);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_LAUNCH_HISTORY_H_
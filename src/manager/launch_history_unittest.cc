@@ -0,0 +1,61 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_history.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+
+namespace app {
+namespace {
+
+using Urls = std::vector<std::string>;
+
+TEST(LaunchHistory, PredictsFrequentSuccessors) {
+  LaunchHistory history;
+  for (int i = 0; i < 3; ++i) {
+    history.RecordLaunch("root", "device_runner");
+    history.RecordLaunch("root", "agent_a");
+    history.RecordLaunch("root", "agent_b");
+  }
+  history.RecordLaunch("root", "device_runner");
+  history.RecordLaunch("root", "other");
+
+  EXPECT_EQ(Urls({"agent_a", "other"}),
+            history.PredictNext("root", "device_runner", 4u, 25u));
+  EXPECT_EQ(Urls({"agent_a"}),
+            history.PredictNext("root", "device_runner", 4u, 50u));
+  EXPECT_EQ(Urls({"agent_a"}),
+            history.PredictNext("root", "device_runner", 1u, 0u));
+  EXPECT_EQ(Urls({"agent_b"}), history.PredictNext("root", "agent_a", 4u, 50u));
+  EXPECT_EQ(Urls(), history.PredictNext("root", "unknown", 4u, 0u));
+}
+
+TEST(LaunchHistory, KeepsEnvironmentsApart) {
+  LaunchHistory history;
+  history.RecordLaunch("a", "first");
+  history.RecordLaunch("b", "unrelated");
+  history.RecordLaunch("a", "second");
+
+  EXPECT_EQ(Urls({"second"}), history.PredictNext("a", "first", 4u, 50u));
+  EXPECT_EQ(Urls(), history.PredictNext("b", "first", 4u, 0u));
+}
+
+TEST(LaunchHistory, StaysBounded) {
+  LaunchHistory history;
+  for (int i = 0; i < 1000; ++i) {
+    history.RecordLaunch("root", "hub");
+    history.RecordLaunch("root", "app" + ftl::NumberToString(i));
+  }
+  // Only a few successors are kept, and none is frequent enough.
+  Urls next = history.PredictNext("root", "hub", 100u, 0u);
+  EXPECT_LE(next.size(), 8u);
+  EXPECT_EQ(Urls(), history.PredictNext("root", "hub", 100u, 10u));
+}
+
+}  // namespace
+}  // namespace app
@@ -0,0 +1,57 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_plan_cache.h"
+
+#include <utility>
+
+namespace app {
+
+LaunchPlanCache::LaunchPlanCache(size_t capacity) : capacity_(capacity) {}
+
+LaunchPlanCache::~LaunchPlanCache() = default;
+
+std::shared_ptr<const SandboxPlan> LaunchPlanCache::GetSandboxPlan(
+    const std::string& url,
+    const std::string& sandbox_data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* entry = GetEntryLocked(url);
+    if (entry->sandbox_plan && entry->sandbox_plan->data == sandbox_data)
+      return entry->sandbox_plan;
+  }
+
+  // Build the plan without holding the lock because opening the directories
+  // can block. Concurrent misses for the same package may build it twice.
+  auto plan = std::make_shared<SandboxPlan>();
+  plan->data = sandbox_data;
+  if (!plan->sandbox.Parse(sandbox_data))
+    return nullptr;
+  plan->directories = NamespaceBuilder::OpenSandboxDirectories(plan->sandbox);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry* entry = GetEntryLocked(url);
+  entry->sandbox_plan = plan;
+  return plan;
+}
+
+LaunchPlanCache::Entry* LaunchPlanCache::GetEntryLocked(
+    const std::string& url) {
+  auto it = entries_.find(url);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return &it->second;
+  }
+
+  if (entries_.size() >= capacity_ && !lru_.empty()) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(url);
+  Entry* entry = &entries_[url];
+  entry->lru_position = lru_.begin();
+  return entry;
+}
+
+}  // namespace app
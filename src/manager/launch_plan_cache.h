@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_LAUNCH_PLAN_CACHE_H_
+#define APPLICATION_SRC_MANAGER_LAUNCH_PLAN_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "application/src/manager/namespace_builder.h"
+#include "application/src/manager/sandbox_metadata.h"
+#include "lib/ftl/macros.h"
+
+namespace app {
+
+// The parts of launching a sandboxed package that do not depend on the
+// individual launch.
+struct SandboxPlan {
+  // The contents of meta/sandbox the plan was built from.
+  std::string data;
+  SandboxMetadata sandbox;
+  // The directories requested by |sandbox|. Launches install clones of them.
+  std::vector<NamespaceBuilder::Directory> directories;
+};
+
+// Remembers, per package URL, the sandbox plan of the package so that repeated
+// launches skip parsing and opening the same things again.
+//
+// Plans are only reused while the meta/sandbox file they were built from is
+// unchanged. The cache is safe to use from multiple threads.
+class LaunchPlanCache {
+ public:
+  explicit LaunchPlanCache(size_t capacity);
+  ~LaunchPlanCache();
+
+  // Returns the sandbox plan for |url| given the contents of its meta/sandbox
+  // file, or null if |sandbox_data| cannot be parsed.
+  std::shared_ptr<const SandboxPlan> GetSandboxPlan(
+      const std::string& url,
+      const std::string& sandbox_data);
+
+ private:
+  struct Entry {
+    std::shared_ptr<const SandboxPlan> sandbox_plan;
+
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // Returns the entry for |url|, creating it if needed, and marks it as the
+  // most recently used. Must be called with |mutex_| held.
+  Entry* GetEntryLocked(const std::string& url);
+
+  const size_t capacity_;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  // The URLs of |entries_|, most recently used first.
+  std::list<std::string> lru_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchPlanCache);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_LAUNCH_PLAN_CACHE_H_
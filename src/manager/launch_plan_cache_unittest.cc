@@ -0,0 +1,41 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_plan_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace app {
+namespace {
+
+constexpr char kUrl[] = "file:///system/apps/example";
+
+TEST(LaunchPlanCache, SandboxPlanReusedWhileUnchanged) {
+  LaunchPlanCache cache(4u);
+  const std::string sandbox = R"JSON({ "features": [] })JSON";
+
+  auto first = cache.GetSandboxPlan(kUrl, sandbox);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first, cache.GetSandboxPlan(kUrl, sandbox));
+
+  auto changed = cache.GetSandboxPlan(kUrl, R"JSON({ "dev": [] })JSON");
+  ASSERT_TRUE(changed);
+  EXPECT_NE(first, changed);
+
+  EXPECT_FALSE(cache.GetSandboxPlan(kUrl, "not json"));
+}
+
+TEST(LaunchPlanCache, EvictsLeastRecentlyUsed) {
+  LaunchPlanCache cache(1u);
+  const std::string sandbox = R"JSON({ "features": [] })JSON";
+
+  auto first = cache.GetSandboxPlan("file:///a", sandbox);
+  cache.GetSandboxPlan("file:///b", sandbox);
+  EXPECT_NE(first, cache.GetSandboxPlan("file:///a", sandbox));
+}
+
+}  // namespace
+}  // namespace app
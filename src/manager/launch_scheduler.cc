@@ -0,0 +1,111 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+
+LaunchScheduler::Slot::Slot(ftl::WeakPtr<LaunchScheduler> scheduler,
+                            ftl::RefPtr<ftl::TaskRunner> task_runner)
+    : scheduler_(std::move(scheduler)), task_runner_(std::move(task_runner)) {}
+
+LaunchScheduler::Slot::~Slot() {
+  // Always release asynchronously so that a launch that fails synchronously
+  // inside its task does not reenter the scheduler, and so that slots can be
+  // dropped on worker threads.
+  task_runner_->PostTask([scheduler = std::move(scheduler_)] {
+    if (scheduler)
+      scheduler->Release();
+  });
+}
+
+LaunchScheduler::LaunchScheduler(size_t max_in_flight)
+    : max_in_flight_(std::max(max_in_flight, static_cast<size_t>(1u))),
+      weak_ptr_factory_(this) {}
+
+LaunchScheduler::~LaunchScheduler() = default;
+
+size_t LaunchScheduler::queue_depth() const {
+  size_t depth = 0u;
+  for (const auto& queue : queues_)
+    depth += queue.size();
+  return depth;
+}
+
+const LaunchScheduler::Stats& LaunchScheduler::stats(
+    LaunchPriority priority) const {
+  return stats_[GetQueueIndex(priority)];
+}
+
+void LaunchScheduler::Schedule(LaunchPriority priority, Task task) {
+  size_t index = GetQueueIndex(priority);
+  PendingLaunch launch{std::move(task), ftl::TimePoint::Now()};
+  if (in_flight_ < max_in_flight_ && queue_depth() == 0u) {
+    Run(index, std::move(launch));
+    return;
+  }
+
+  queues_[index].push_back(std::move(launch));
+  Stats& stats = stats_[index];
+  stats.queue_depth = queues_[index].size();
+  stats.max_queue_depth = std::max(stats.max_queue_depth, stats.queue_depth);
+  FTL_VLOG(2) << "Queued launch, " << queue_depth() << " launches pending";
+}
+
+// Queues are ordered from the highest to the lowest priority.
+size_t LaunchScheduler::GetQueueIndex(LaunchPriority priority) {
+  switch (priority) {
+    case LaunchPriority::INTERACTIVE:
+      return 0u;
+    case LaunchPriority::NORMAL:
+      return 1u;
+    case LaunchPriority::BACKGROUND:
+      return 2u;
+    case LaunchPriority::DEFAULT:
+      break;
+  }
+  FTL_DCHECK(false) << "Launch priority must be resolved before scheduling";
+  return 1u;
+}
+
+void LaunchScheduler::Run(size_t queue_index, PendingLaunch launch) {
+  Stats& stats = stats_[queue_index];
+  ftl::TimeDelta wait = ftl::TimePoint::Now() - launch.enqueue_time;
+  ++stats.launched;
+  stats.total_wait = stats.total_wait + wait;
+  stats.max_wait = std::max(stats.max_wait, wait);
+
+  ++in_flight_;
+  launch.task(std::unique_ptr<Slot>(
+      new Slot(weak_ptr_factory_.GetWeakPtr(),
+               mtl::MessageLoop::GetCurrent()->task_runner())));
+}
+
+void LaunchScheduler::Release() {
+  FTL_DCHECK(in_flight_ > 0u);
+  --in_flight_;
+  RunQueuedLaunches();
+}
+
+void LaunchScheduler::RunQueuedLaunches() {
+  for (size_t index = 0; index < kPriorityCount; ++index) {
+    auto& queue = queues_[index];
+    while (in_flight_ < max_in_flight_ && !queue.empty()) {
+      PendingLaunch launch = std::move(queue.front());
+      queue.pop_front();
+      stats_[index].queue_depth = queue.size();
+      Run(index, std::move(launch));
+    }
+    if (in_flight_ >= max_in_flight_)
+      return;
+  }
+}
+
+}  // namespace app
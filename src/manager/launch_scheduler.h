@@ -0,0 +1,101 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_LAUNCH_SCHEDULER_H_
+#define APPLICATION_SRC_MANAGER_LAUNCH_SCHEDULER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "application/services/application_launcher.fidl.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace app {
+
+// Orders the launches requested in an environment by priority and bounds the
+// number of launches that are in flight at once.
+//
+// A launch is in flight from the time its task is run until the |Slot| handed
+// to the task is destroyed. Tasks with a higher priority always run before
+// queued tasks with a lower priority; tasks with the same priority run in the
+// order in which they were scheduled.
+class LaunchScheduler {
+ public:
+  // Represents a launch that is in flight. Destroying the slot lets the next
+  // queued launch run. Slots may be destroyed on any thread.
+  class Slot {
+   public:
+    ~Slot();
+
+   private:
+    friend class LaunchScheduler;
+    Slot(ftl::WeakPtr<LaunchScheduler> scheduler,
+         ftl::RefPtr<ftl::TaskRunner> task_runner);
+
+    ftl::WeakPtr<LaunchScheduler> scheduler_;
+    ftl::RefPtr<ftl::TaskRunner> task_runner_;
+
+    FTL_DISALLOW_COPY_AND_ASSIGN(Slot);
+  };
+
+  using Task = std::function<void(std::unique_ptr<Slot> slot)>;
+
+  // Statistics about the launches with a given priority.
+  struct Stats {
+    uint64_t launched = 0u;
+    size_t queue_depth = 0u;
+    size_t max_queue_depth = 0u;
+    ftl::TimeDelta total_wait;
+    ftl::TimeDelta max_wait;
+  };
+
+  // Creates a scheduler that runs at most |max_in_flight| launches at once. A
+  // |max_in_flight| of zero is treated as one.
+  explicit LaunchScheduler(size_t max_in_flight);
+  ~LaunchScheduler();
+
+  size_t max_in_flight() const { return max_in_flight_; }
+  size_t in_flight() const { return in_flight_; }
+  size_t queue_depth() const;
+
+  const Stats& stats(LaunchPriority priority) const;
+
+  // Runs |task| once fewer than |max_in_flight| launches are in flight and no
+  // launch with the same or a higher priority is queued ahead of it.
+  //
+  // |priority| must not be |LaunchPriority::DEFAULT|.
+  void Schedule(LaunchPriority priority, Task task);
+
+ private:
+  struct PendingLaunch {
+    Task task;
+    ftl::TimePoint enqueue_time;
+  };
+
+  static constexpr size_t kPriorityCount = 3u;
+  static size_t GetQueueIndex(LaunchPriority priority);
+
+  void Run(size_t queue_index, PendingLaunch launch);
+  void Release();
+  void RunQueuedLaunches();
+
+  const size_t max_in_flight_;
+  size_t in_flight_ = 0u;
+  std::deque<PendingLaunch> queues_[kPriorityCount];
+  Stats stats_[kPriorityCount];
+
+  ftl::WeakPtrFactory<LaunchScheduler> weak_ptr_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchScheduler);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_LAUNCH_SCHEDULER_H_
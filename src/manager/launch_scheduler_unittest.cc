@@ -0,0 +1,80 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_scheduler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+class Recorder {
+ public:
+  LaunchScheduler::Task Record(std::string name) {
+    return [this, name](std::unique_ptr<LaunchScheduler::Slot> slot) {
+      order.push_back(name);
+      slots.push_back(std::move(slot));
+    };
+  }
+
+  std::vector<std::string> order;
+  std::vector<std::unique_ptr<LaunchScheduler::Slot>> slots;
+};
+
+TEST(LaunchScheduler, RunsImmediatelyWhenIdle) {
+  mtl::MessageLoop message_loop;
+  LaunchScheduler scheduler(2u);
+  Recorder recorder;
+
+  scheduler.Schedule(LaunchPriority::NORMAL, recorder.Record("a"));
+  scheduler.Schedule(LaunchPriority::NORMAL, recorder.Record("b"));
+  EXPECT_EQ(2u, recorder.order.size());
+  EXPECT_EQ(2u, scheduler.in_flight());
+  EXPECT_EQ(0u, scheduler.queue_depth());
+}
+
+TEST(LaunchScheduler, InteractiveJumpsQueue) {
+  mtl::MessageLoop message_loop;
+  LaunchScheduler scheduler(1u);
+  Recorder recorder;
+
+  scheduler.Schedule(LaunchPriority::NORMAL, recorder.Record("first"));
+  scheduler.Schedule(LaunchPriority::BACKGROUND, recorder.Record("bg1"));
+  scheduler.Schedule(LaunchPriority::NORMAL, recorder.Record("normal"));
+  scheduler.Schedule(LaunchPriority::BACKGROUND, recorder.Record("bg2"));
+  scheduler.Schedule(LaunchPriority::INTERACTIVE, recorder.Record("ui"));
+  EXPECT_EQ(4u, scheduler.queue_depth());
+  EXPECT_EQ(2u, scheduler.stats(LaunchPriority::BACKGROUND).max_queue_depth);
+
+  while (!recorder.slots.empty()) {
+    recorder.slots.clear();
+    message_loop.RunUntilIdle();
+  }
+
+  std::vector<std::string> expected = {"first", "ui", "normal", "bg1", "bg2"};
+  EXPECT_EQ(expected, recorder.order);
+  EXPECT_EQ(0u, scheduler.in_flight());
+  EXPECT_EQ(0u, scheduler.queue_depth());
+  EXPECT_EQ(2u, scheduler.stats(LaunchPriority::BACKGROUND).launched);
+}
+
+TEST(LaunchScheduler, SlotOutlivesScheduler) {
+  mtl::MessageLoop message_loop;
+  Recorder recorder;
+  {
+    LaunchScheduler scheduler(1u);
+    scheduler.Schedule(LaunchPriority::NORMAL, recorder.Record("a"));
+  }
+  recorder.slots.clear();
+  message_loop.RunUntilIdle();
+  EXPECT_EQ(1u, recorder.order.size());
+}
+
+}  // namespace
+}  // namespace app
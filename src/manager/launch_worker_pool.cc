@@ -0,0 +1,42 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_worker_pool.h"
+
+#include <utility>
+
+#include "lib/ftl/strings/string_printf.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/threading/create_thread.h"
+
+namespace app {
+namespace {
+
+constexpr char kThreadNameFormat[] = "launch-worker-%zu";
+
+}  // namespace
+
+LaunchWorkerPool::LaunchWorkerPool(size_t thread_count) {
+  if (thread_count == 0u)
+    thread_count = 1u;
+  task_runners_.resize(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.push_back(mtl::CreateThread(
+        &task_runners_[i], ftl::StringPrintf(kThreadNameFormat, i)));
+  }
+}
+
+LaunchWorkerPool::~LaunchWorkerPool() {
+  for (auto& task_runner : task_runners_)
+    task_runner->PostTask([] { mtl::MessageLoop::GetCurrent()->QuitNow(); });
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+void LaunchWorkerPool::PostTask(ftl::Closure task) {
+  task_runners_[next_thread_]->PostTask(std::move(task));
+  next_thread_ = (next_thread_ + 1) % task_runners_.size();
+}
+
+}  // namespace app
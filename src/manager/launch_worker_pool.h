@@ -0,0 +1,46 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_LAUNCH_WORKER_POOL_H_
+#define APPLICATION_SRC_MANAGER_LAUNCH_WORKER_POOL_H_
+
+#include <thread>
+#include <vector>
+
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
+
+namespace app {
+
+// A fixed set of threads on which appmgr runs the blocking, self-contained
+// parts of launching an application, such as parsing archives, cloning
+// namespace directories and calling launchpad.
+//
+// Tasks posted to the pool must not touch state owned by the main message
+// loop. Results are handed back by posting a task to the main loop's task
+// runner.
+class LaunchWorkerPool {
+ public:
+  // Creates a pool with |thread_count| threads. A |thread_count| of zero is
+  // treated as one.
+  explicit LaunchWorkerPool(size_t thread_count);
+  ~LaunchWorkerPool();
+
+  // Runs |task| on one of the worker threads. Tasks are distributed across the
+  // threads in round-robin order.
+  void PostTask(ftl::Closure task);
+
+ private:
+  std::vector<std::thread> threads_;
+  std::vector<ftl::RefPtr<ftl::TaskRunner>> task_runners_;
+  size_t next_thread_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LaunchWorkerPool);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_LAUNCH_WORKER_POOL_H_
@@ -0,0 +1,77 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/launch_worker_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+constexpr size_t kTaskCount = 16u;
+
+TEST(LaunchWorkerPool, RunsTasksOffTheMainThread) {
+  mtl::MessageLoop message_loop;
+  LaunchWorkerPool pool(2u);
+  auto task_runner = message_loop.task_runner();
+  const std::thread::id main_thread = std::this_thread::get_id();
+
+  size_t replies = 0u;
+  size_t off_main_thread = 0u;
+  for (size_t i = 0; i < kTaskCount; ++i) {
+    pool.PostTask([&, task_runner] {
+      bool on_worker = std::this_thread::get_id() != main_thread;
+      // Results are handed back to the main loop, like the launch code does.
+      task_runner->PostTask([&, on_worker] {
+        if (on_worker)
+          ++off_main_thread;
+        if (++replies == kTaskCount)
+          mtl::MessageLoop::GetCurrent()->QuitNow();
+      });
+    });
+  }
+  message_loop.Run();
+
+  EXPECT_EQ(kTaskCount, replies);
+  EXPECT_EQ(kTaskCount, off_main_thread);
+}
+
+TEST(LaunchWorkerPool, TreatsZeroThreadsAsOne) {
+  mtl::MessageLoop message_loop;
+  LaunchWorkerPool pool(0u);
+  auto task_runner = message_loop.task_runner();
+
+  bool ran = false;
+  pool.PostTask([&ran, task_runner] {
+    task_runner->PostTask([&ran] {
+      ran = true;
+      mtl::MessageLoop::GetCurrent()->QuitNow();
+    });
+  });
+  message_loop.Run();
+
+  EXPECT_TRUE(ran);
+}
+
+TEST(LaunchWorkerPool, DrainsTasksOnShutdown) {
+  std::atomic<size_t> count(0u);
+  {
+    LaunchWorkerPool pool(2u);
+    for (size_t i = 0; i < kTaskCount; ++i) {
+      pool.PostTask([&count] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++count;
+      });
+    }
+  }
+  EXPECT_EQ(kTaskCount, count.load());
+}
+
+}  // namespace
+}  // namespace app
@@ -4,20 +4,42 @@
 
 #include <magenta/process.h>
 #include <magenta/processargs.h>
+#include <stdio.h>
 #include <stdlib.h>
 
+#include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "application/lib/farfs/blob_store.h"
+#include "application/lib/svc/service_metrics_impl.h"
+#include "application/lib/timeline/boot_timeline.h"
+#include "application/lib/vfs/dispatcher_pool.h"
 #include "application/src/manager/config.h"
+#include "application/src/manager/launch_plan_cache.h"
+#include "application/src/manager/launch_worker_pool.h"
+#include "application/src/manager/memory_pressure_monitor.h"
 #include "application/src/manager/root_environment_host.h"
+#include "application/src/manager/termination_watcher.h"
+#include "application/src/manager/url_resolver.h"
 #include "lib/ftl/command_line.h"
 #include "lib/ftl/files/file.h"
 #include "lib/ftl/log_settings.h"
+#include "lib/ftl/strings/string_number_conversions.h"
 #include "lib/mtl/tasks/message_loop.h"
 
 constexpr char kDefaultConfigPath[] = "/system/data/appmgr/initial.config";
+constexpr char kSnapshotSuffix[] = ".snapshot";
+constexpr char kLaunchThreadsOption[] = "launch-threads";
+constexpr char kVfsThreadsOption[] = "vfs-threads";
+constexpr char kServiceMetricsOption[] = "service-metrics";
+constexpr size_t kTimelineCapacity = 4096u;
+constexpr size_t kLaunchPlanCacheCapacity = 128u;
+constexpr char kBlobDirectory[] = "/system/blobs";
+constexpr uint64_t kBlobCacheBytes = 64 * 1024 * 1024;
 
 int main(int argc, char** argv) {
   auto command_line = ftl::CommandLineFromArgcArgv(argc, argv);
@@ -29,8 +51,36 @@ int main(int argc, char** argv) {
   if (config_file.empty() && positional_args.empty())
     config_file = kDefaultConfigPath;
 
+  size_t launch_threads = std::thread::hardware_concurrency();
+  std::string launch_threads_value;
+  if (command_line.GetOptionValue(kLaunchThreadsOption,
+                                  &launch_threads_value) &&
+      !ftl::StringToNumberWithError(launch_threads_value, &launch_threads)) {
+    fprintf(stderr, "appmgr: Invalid --%s value: %s\n", kLaunchThreadsOption,
+            launch_threads_value.c_str());
+    return 1;
+  }
+
+  // By default, package directories are served on the main thread.
+  size_t vfs_threads = 0u;
+  std::string vfs_threads_value;
+  if (command_line.GetOptionValue(kVfsThreadsOption, &vfs_threads_value) &&
+      !ftl::StringToNumberWithError(vfs_threads_value, &vfs_threads)) {
+    fprintf(stderr, "appmgr: Invalid --%s value: %s\n", kVfsThreadsOption,
+            vfs_threads_value.c_str());
+    return 1;
+  }
+
+  // With --timeline, boot events are recorded and written to the given path
+  // once boot is expected to be over.
+  timeline::BootTimeline boot_timeline;
+  if (!boot_timeline.InitFromCommandLine(command_line, kTimelineCapacity))
+    return 1;
+
   app::Config config;
   if (!config_file.empty()) {
+    // The snapshot is optional; without it, the config files are parsed.
+    config.LoadSnapshot(config_file + kSnapshotSuffix);
     config.ReadIfExistsFrom(config_file);
   }
 
@@ -47,22 +97,70 @@ int main(int argc, char** argv) {
   // appmgr, it might be nice to pass the request over to
   // it instead of starting a whole new instance.  Alternately, we could create
   // a separate command-line program to act as an interface for modifying
-  // configuration, starting / stopping applications, listing what's running,
-  // printing debugging information, etc.  Having multiple instances of
+  // configuration, starting / stopping applications, printing debugging
+  // information, etc.  Listing what's running is available through the
+  // EnvironmentInspector service.  Having multiple instances of
   // application manager running is not what we want, in general.
 
   mtl::MessageLoop message_loop;
 
-  app::RootEnvironmentHost root(config.TakePath());
+  // Package directories created while the pool is installed are served from
+  // it, so it must outlive the environments.
+  std::unique_ptr<vfs::DispatcherPool> dispatcher_pool;
+  if (vfs_threads) {
+    dispatcher_pool = std::make_unique<vfs::DispatcherPool>(vfs_threads);
+    vfs::DispatcherPool::SetDefault(dispatcher_pool.get());
+  }
+
+  // Files that packages reference by hash are shared through the blob store,
+  // which must outlive the package directories.
+  archive::BlobStore blob_store(kBlobDirectory, kBlobCacheBytes);
+  archive::BlobStore::SetDefault(&blob_store);
+
+  // The cache is used by the worker threads, so it must outlive the pool.
+  app::LaunchPlanCache launch_plan_cache(kLaunchPlanCacheCapacity);
+  app::LaunchWorkerPool worker_pool(launch_threads);
+  app::TerminationWatcher termination_watcher;
+
+  // With --service-metrics, connections to environment services are counted
+  // and reported by the debug.ServiceMetrics service, which the root host
+  // provides to the applications of the root environment. The metrics must
+  // outlive the environments.
+  std::unique_ptr<app::ServiceMetricsImpl> service_metrics;
+  if (command_line.HasOption(kServiceMetricsOption))
+    service_metrics = std::make_unique<app::ServiceMetricsImpl>();
+
+  app::RootEnvironmentHost root(config.TakePath(), &worker_pool,
+                                &termination_watcher, &launch_plan_cache);
+  root.environment()->SetConfiguredBudgets(config.TakeEnvironmentBudgets());
+  root.environment()->SetConfiguredRunners(config.TakeRunners());
+  root.environment()->SetPrefetchConfig(config.prefetch());
+  if (service_metrics)
+    root.SetServiceMetrics(service_metrics.get());
+  // The initial apps, such as bootstrap, host the environments that everything
+  // else runs in, so they are never killed to reclaim memory.
+  app::MemoryPressureConfig memory_pressure = config.memory_pressure();
+  for (const auto& launch_info : initial_apps) {
+    memory_pressure.never_kill.push_back(
+        app::CanonicalizeURL(launch_info->url));
+  }
+  app::MemoryPressureMonitor memory_pressure_monitor(
+      root.environment(), std::move(memory_pressure));
 
   if (!initial_apps.empty()) {
     message_loop.task_runner()->PostTask([&root, &initial_apps] {
+      auto requests = fidl::Array<app::ApplicationLaunchRequestPtr>::New(0);
       for (auto& launch_info : initial_apps) {
-        root.environment()->CreateApplication(std::move(launch_info), nullptr);
+        auto request = app::ApplicationLaunchRequest::New();
+        request->launch_info = std::move(launch_info);
+        requests.push_back(std::move(request));
       }
+      root.environment()->CreateApplications(std::move(requests));
     });
   }
 
+  boot_timeline.ScheduleWrite();
+
   message_loop.Run();
   return 0;
 }
@@ -0,0 +1,125 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/memory_pressure_monitor.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "application/src/manager/application_environment_impl.h"
+#include "application/src/manager/task_stats.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+using Candidate = MemoryPressureMonitor::Candidate;
+
+// Orders candidates from the first to the last to reclaim.
+bool ReclaimsBefore(const Candidate& a, const Candidate& b) {
+  return std::make_tuple(!a.idle, !a.background, a.last_active_time) <
+         std::make_tuple(!b.idle, !b.background, b.last_active_time);
+}
+
+}  // namespace
+
+MemoryPressureMonitor::MemoryPressureMonitor(ApplicationEnvironmentImpl* root,
+                                             MemoryPressureConfig config)
+    : root_(root), config_(std::move(config)), weak_ptr_factory_(this) {
+  if (config_.warning_bytes)
+    ScheduleCheck();
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor() = default;
+
+// static
+std::vector<Candidate> MemoryPressureMonitor::ChooseApplicationsToKill(
+    std::vector<Candidate> candidates,
+    uint64_t total,
+    const MemoryPressureConfig& config) {
+  std::vector<Candidate> chosen;
+  if (total <= config.warning_bytes)
+    return chosen;
+  bool critical = config.critical_bytes && total > config.critical_bytes;
+  std::sort(candidates.begin(), candidates.end(), ReclaimsBefore);
+
+  uint64_t freed = 0u;
+  for (auto& candidate : candidates) {
+    if (total - freed <= config.warning_bytes)
+      break;
+    if (!candidate.idle && !critical)
+      break;
+    // Runners are stopped by their own idle policy, since killing one would
+    // kill every application it runs.
+    if (candidate.runner ||
+        std::find(config.never_kill.begin(), config.never_kill.end(),
+                  candidate.url) != config.never_kill.end())
+      continue;
+    freed += candidate.bytes;
+    chosen.push_back(std::move(candidate));
+  }
+  return chosen;
+}
+
+void MemoryPressureMonitor::ScheduleCheck() {
+  mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+      [weak_this = weak_ptr_factory_.GetWeakPtr()] {
+        if (weak_this)
+          weak_this->Check();
+      },
+      config_.check_interval);
+}
+
+void MemoryPressureMonitor::Check() {
+  ftl::TimePoint now = ftl::TimePoint::Now();
+  uint64_t total = 0u;
+  std::vector<Candidate> candidates;
+  std::unordered_map<const ApplicationEnvironmentImpl*, uint64_t>
+      connect_counts;
+  root_->ForEachApplication([this, now, &total, &candidates, &connect_counts](
+      const ApplicationEnvironmentImpl& environment,
+      ApplicationControllerImpl* application) {
+    uint64_t bytes = GetPrivateMemoryBytes(application->process());
+    application->SampleMemory(bytes, now);
+    uint64_t connects = environment.service_connect_count();
+    auto last = connect_counts_.find(&environment);
+    if (last != connect_counts_.end() && last->second != connects)
+      application->RecordActivity(now);
+    connect_counts[&environment] = connects;
+    total += bytes;
+    candidates.push_back(Candidate{
+        application, application->path(),
+        environment.HasRunner(application->path()),
+        environment.default_launch_priority() == LaunchPriority::BACKGROUND,
+        now - application->last_active_time() >= config_.idle_time,
+        application->last_active_time(), bytes});
+  });
+  connect_counts_.swap(connect_counts);
+
+  if (total > config_.warning_bytes) {
+    bool critical = config_.critical_bytes && total > config_.critical_bytes;
+    uint64_t freed = 0u;
+    std::vector<Candidate> chosen =
+        ChooseApplicationsToKill(std::move(candidates), total, config_);
+    for (const auto& candidate : chosen) {
+      FTL_LOG(INFO) << "Reclaiming " << candidate.bytes << " bytes from "
+                    << candidate.url;
+      // The application is removed once the termination is observed.
+      candidate.application->Kill();
+      freed += candidate.bytes;
+    }
+    FTL_LOG(WARNING) << "Applications use " << total << " bytes, above the "
+                     << (critical ? "critical" : "warning")
+                     << " threshold; reclaimed " << freed << " bytes from "
+                     << chosen.size() << " applications";
+  }
+
+  ScheduleCheck();
+}
+
+}  // namespace app
@@ -0,0 +1,84 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_MEMORY_PRESSURE_MONITOR_H_
+#define APPLICATION_SRC_MANAGER_MEMORY_PRESSURE_MONITOR_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "application/src/manager/config.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace app {
+class ApplicationControllerImpl;
+class ApplicationEnvironmentImpl;
+
+// Periodically measures the memory used by the applications in an environment
+// tree and kills applications when the total exceeds the configured
+// thresholds.
+//
+// Magenta does not report memory pressure to user space, so pressure is
+// judged from the private memory of the applications appmgr runs. The same
+// measurements tell which applications are idle: an application whose memory
+// use has not changed for |MemoryPressureConfig::idle_time| is considered
+// idle. Applications in an environment whose applications connected to its
+// services since the previous check are considered active as well, since
+// appmgr cannot tell which of them made the connections.
+//
+// Applications are reclaimed in this order:
+//  1. Idle applications in background environments.
+//  2. Idle applications in other environments.
+//  3. Above the critical threshold only, busy applications, again starting
+//     with background environments.
+// Within each group, the applications that have been idle the longest go
+// first. Runners and the applications listed in
+// |MemoryPressureConfig::never_kill| are never killed.
+class MemoryPressureMonitor {
+ public:
+  // An application that uses memory, as measured by a check.
+  struct Candidate {
+    ApplicationControllerImpl* application;
+    std::string url;
+    bool runner;
+    bool background;
+    bool idle;
+    ftl::TimePoint last_active_time;
+    uint64_t bytes;
+  };
+
+  MemoryPressureMonitor(ApplicationEnvironmentImpl* root,
+                        MemoryPressureConfig config);
+  ~MemoryPressureMonitor();
+
+  // Returns the applications to kill, in order, to bring the |total| bytes
+  // used by |candidates| back below the warning threshold of |config|.
+  static std::vector<Candidate> ChooseApplicationsToKill(
+      std::vector<Candidate> candidates,
+      uint64_t total,
+      const MemoryPressureConfig& config);
+
+ private:
+  void ScheduleCheck();
+  void Check();
+
+  ApplicationEnvironmentImpl* root_;
+  const MemoryPressureConfig config_;
+
+  // The service connections of the environments that ran applications at the
+  // previous check.
+  std::unordered_map<const ApplicationEnvironmentImpl*, uint64_t>
+      connect_counts_;
+
+  ftl::WeakPtrFactory<MemoryPressureMonitor> weak_ptr_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(MemoryPressureMonitor);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_MEMORY_PRESSURE_MONITOR_H_
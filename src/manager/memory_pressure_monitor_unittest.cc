@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/memory_pressure_monitor.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace app {
+namespace {
+
+using Candidate = MemoryPressureMonitor::Candidate;
+
+constexpr char kHostUrl[] = "file:///system/apps/device_runner";
+constexpr uint64_t kMegabyte = 1024u * 1024u;
+
+Candidate MakeCandidate(const std::string& url, bool idle, uint64_t bytes) {
+  return Candidate{nullptr, url, false, false, idle, ftl::TimePoint(), bytes};
+}
+
+std::vector<std::string> GetUrls(const std::vector<Candidate>& candidates) {
+  std::vector<std::string> urls;
+  for (const auto& candidate : candidates)
+    urls.push_back(candidate.url);
+  return urls;
+}
+
+MemoryPressureConfig MakeConfig() {
+  MemoryPressureConfig config;
+  config.warning_bytes = 10u * kMegabyte;
+  config.critical_bytes = 20u * kMegabyte;
+  config.never_kill.push_back(kHostUrl);
+  return config;
+}
+
+TEST(MemoryPressureMonitor, KillsOnlyIdleApplicationsAboveWarning) {
+  std::vector<Candidate> candidates;
+  candidates.push_back(MakeCandidate("busy", false, 8u * kMegabyte));
+  candidates.push_back(MakeCandidate("idle", true, 4u * kMegabyte));
+
+  EXPECT_EQ(std::vector<std::string>{"idle"},
+            GetUrls(MemoryPressureMonitor::ChooseApplicationsToKill(
+                candidates, 12u * kMegabyte, MakeConfig())));
+}
+
+// Applications that host environments survive even a critical pass, which
+// otherwise kills busy applications too.
+TEST(MemoryPressureMonitor, NeverKillsListedApplications) {
+  std::vector<Candidate> candidates;
+  candidates.push_back(MakeCandidate(kHostUrl, true, 16u * kMegabyte));
+  candidates.push_back(MakeCandidate("busy", false, 8u * kMegabyte));
+  Candidate runner = MakeCandidate("runner", true, 4u * kMegabyte);
+  runner.runner = true;
+  candidates.push_back(runner);
+
+  EXPECT_EQ(std::vector<std::string>{"busy"},
+            GetUrls(MemoryPressureMonitor::ChooseApplicationsToKill(
+                candidates, 28u * kMegabyte, MakeConfig())));
+}
+
+}  // namespace
+}  // namespace app
@@ -12,6 +12,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <utility>
+
 #include "lib/ftl/files/unique_fd.h"
 
 namespace app {
@@ -56,30 +59,64 @@ void NamespaceBuilder::AddServices(mx::channel services) {
   PushDirectoryFromChannel("/svc", std::move(services));
 }
 
-void NamespaceBuilder::AddSandbox(const SandboxMetadata& sandbox) {
-  if (sandbox.dev().empty())
-    return;
-
-  ftl::UniqueFD dir(open("/dev", O_DIRECTORY | O_RDWR));
-  if (!dir.is_valid())
-    return;
-  const auto& dev = sandbox.dev();
-  for (const auto& path : dev) {
-    ftl::UniqueFD entry(openat(dir.get(), path.c_str(), O_DIRECTORY | O_RDWR));
-    if (!entry.is_valid())
-      continue;
-    mx::channel handle = CloneChannel(entry.get());
+std::vector<NamespaceBuilder::Directory>
+NamespaceBuilder::OpenSandboxDirectories(const SandboxMetadata& sandbox) {
+  std::vector<Directory> directories;
+  auto push_path = [&directories](std::string path, int oflags) {
+    for (const auto& directory : directories) {
+      if (directory.path == path)
+        return;
+    }
+    ftl::UniqueFD dir(open(path.c_str(), O_DIRECTORY | oflags));
+    if (!dir.is_valid())
+      return;
+    mx::channel handle = CloneChannel(dir.get());
     if (!handle)
-      continue;
-    PushDirectoryFromChannel("/dev/" + path, std::move(handle));
+      return;
+    directories.push_back({std::move(path), std::move(handle)});
+  };
+
+  if (!sandbox.dev().empty()) {
+    ftl::UniqueFD dir(open("/dev", O_DIRECTORY | O_RDWR));
+    if (dir.is_valid()) {
+      for (const auto& path : sandbox.dev()) {
+        ftl::UniqueFD entry(
+            openat(dir.get(), path.c_str(), O_DIRECTORY | O_RDWR));
+        if (!entry.is_valid())
+          continue;
+        mx::channel handle = CloneChannel(entry.get());
+        if (!handle)
+          continue;
+        directories.push_back({"/dev/" + path, std::move(handle)});
+      }
+    }
   }
 
   for (const auto& feature : sandbox.features()) {
     if (feature == "vulkan") {
-      PushDirectoryFromPath("/dev/class/display", O_RDWR);
-      PushDirectoryFromPath("/system/data/vulkan", O_RDONLY);
+      push_path("/dev/class/display", O_RDWR);
+      push_path("/system/data/vulkan", O_RDONLY);
     }
   }
+  return directories;
+}
+
+void NamespaceBuilder::AddSandbox(const SandboxMetadata& sandbox) {
+  for (auto& directory : OpenSandboxDirectories(sandbox))
+    PushDirectoryFromChannel(std::move(directory.path),
+                             std::move(directory.channel));
+}
+
+void NamespaceBuilder::AddClonesOf(const std::vector<Directory>& directories) {
+  for (const auto& directory : directories) {
+    if (std::find(paths_.begin(), paths_.end(), directory.path) !=
+        paths_.end())
+      continue;
+    mx::channel clone(mxio_service_clone(directory.channel.get()));
+    if (!clone)
+      continue;
+    PushDirectoryFromChannel(directory.path, std::move(clone));
+  }
 }
 
 void NamespaceBuilder::PushDirectoryFromPath(std::string path, int oflags) {
@@ -8,6 +8,7 @@
 #include <mx/channel.h>
 #include <mxio/namespace.h>
 
+#include <string>
 #include <vector>
 
 #include "application/src/manager/sandbox_metadata.h"
@@ -17,14 +18,28 @@ namespace app {
 
 class NamespaceBuilder {
  public:
+  // A directory to install in a namespace.
+  struct Directory {
+    std::string path;
+    mx::channel channel;
+  };
+
   NamespaceBuilder();
   ~NamespaceBuilder();
 
+  // Opens the directories that |sandbox| asks for.
+  static std::vector<Directory> OpenSandboxDirectories(
+      const SandboxMetadata& sandbox);
+
   void AddRoot();
   void AddPackage(mx::channel package);
   void AddServices(mx::channel services);
   void AddSandbox(const SandboxMetadata& sandbox);
 
+  // Adds clones of |directories|, leaving the originals usable for other
+  // namespaces.
+  void AddClonesOf(const std::vector<Directory>& directories);
+
   // Returns an mxio_flat_namespace_t representing the built namespace.
   //
   // The returned mxio_flat_namespace_t has ownership of the mx::channel objects
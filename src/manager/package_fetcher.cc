@@ -0,0 +1,219 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/package_fetcher.h"
+
+#include <mxio/io.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "application/lib/far/archive_reader.h"
+#include "lib/ftl/files/unique_fd.h"
+#include "lib/ftl/logging.h"
+
+namespace app {
+namespace {
+
+// Longest range requested from the reader at once.
+constexpr uint64_t kMaxRequestLength = 1024 * 1024;
+
+// Number of range requests kept in flight.
+constexpr size_t kMaxRequestsInFlight = 4u;
+
+// Files separated by less than this are fetched in a single range.
+constexpr uint64_t kMaxGap = 16 * 1024;
+
+// Paths needed to start an archive.
+const char* const kLaunchPaths[] = {"meta/", "bin/app"};
+
+}  // namespace
+
+PackageFetcher::PackageFetcher(std::string url,
+                               PackageByteRangeReaderPtr reader,
+                               uint64_t size)
+    : url_(std::move(url)), reader_(std::move(reader)), size_(size) {}
+
+PackageFetcher::~PackageFetcher() = default;
+
+void PackageFetcher::Start(ReadyCallback callback) {
+  ready_callback_ = std::move(callback);
+  if (mx::vmo::create(size_, 0u, &vmo_) != MX_OK) {
+    Finish(State::kFailed);
+    return;
+  }
+  reader_.set_connection_error_handler([this] {
+    FTL_LOG(ERROR) << "Lost the connection to the reader for " << url_;
+    Finish(State::kFailed);
+  });
+
+  archive::ByteRange header;
+  header.length = std::min<uint64_t>(archive::kHeaderLength, size_);
+  FetchRanges({header}, [this] { OnHeaderFetched(); });
+}
+
+void PackageFetcher::OnComplete(CompleteCallback callback) {
+  if (state_ != State::kFetching) {
+    callback(state_ == State::kComplete);
+    return;
+  }
+  complete_callbacks_.push_back(std::move(callback));
+}
+
+void PackageFetcher::FetchRanges(const std::vector<archive::ByteRange>& ranges,
+                                 ftl::Closure done) {
+  FTL_DCHECK(queue_.empty() && !in_flight_);
+  for (const auto& range : ranges) {
+    uint64_t end = std::min(range.end(), size_);
+    for (uint64_t offset = range.offset; offset < end;) {
+      archive::ByteRange request;
+      request.offset = offset;
+      request.length = std::min(end - offset, kMaxRequestLength);
+      queue_.push_back(request);
+      offset = request.end();
+    }
+  }
+  batch_done_ = std::move(done);
+  FetchNext();
+}
+
+void PackageFetcher::FetchNext() {
+  if (queue_.empty() && !in_flight_) {
+    ftl::Closure done = std::move(batch_done_);
+    done();
+    return;
+  }
+  while (!queue_.empty() && in_flight_ < kMaxRequestsInFlight) {
+    archive::ByteRange range = queue_.front();
+    queue_.pop_front();
+    ++in_flight_;
+    reader_->ReadRange(range.offset, range.length,
+                       [this, range](mx::vmo data) {
+                         OnRangeRead(range, std::move(data));
+                       });
+  }
+}
+
+void PackageFetcher::OnRangeRead(const archive::ByteRange& range,
+                                 mx::vmo data) {
+  --in_flight_;
+  if (state_ != State::kFetching)
+    return;
+
+  std::vector<char> buffer(range.length);
+  size_t actual = 0u;
+  if (!data || data.read(buffer.data(), 0u, buffer.size(), &actual) != MX_OK ||
+      actual != buffer.size() ||
+      vmo_.write(buffer.data(), range.offset, buffer.size(), &actual) !=
+          MX_OK ||
+      actual != buffer.size()) {
+    FTL_LOG(ERROR) << "Failed to read " << range.length << " bytes at offset "
+                   << range.offset << " of " << url_;
+    Finish(State::kFailed);
+    return;
+  }
+  FetchNext();
+}
+
+void PackageFetcher::OnHeaderFetched() {
+  archive::ByteRange index;
+  if (!archive::GetIndexRange(ReadString({0u, archive::kHeaderLength}),
+                              &index) ||
+      index.end() > size_) {
+    FetchRemainder(archive::kHeaderLength);
+    return;
+  }
+  FetchRanges({index}, [this, index] { OnIndexFetched(index); });
+}
+
+void PackageFetcher::OnIndexFetched(const archive::ByteRange& index) {
+  archive::ByteRange metadata;
+  if (!archive::GetMetadataRange(ReadString(index), &metadata) ||
+      metadata.end() > size_) {
+    FetchRemainder(index.end());
+    return;
+  }
+  archive::ByteRange chunks;
+  chunks.offset = index.end();
+  chunks.length = metadata.end() - index.end();
+  FetchRanges({chunks}, [this] { OnMetadataFetched(); });
+}
+
+void PackageFetcher::OnMetadataFetched() {
+  mx::vmo dup = Duplicate();
+  archive::ArchiveReader reader(
+      ftl::UniqueFD(dup ? mxio_vmo_fd(dup.release(), 0, size_) : -1));
+  if (!reader.Read()) {
+    Finish(State::kFailed);
+    return;
+  }
+
+  size_t priority_count = 0u;
+  std::vector<archive::ByteRange> ranges = archive::PlanFileRanges(
+      reader, std::vector<std::string>(std::begin(kLaunchPaths),
+                                       std::end(kLaunchPaths)),
+      kMaxGap, &priority_count);
+  std::vector<archive::ByteRange> launch_ranges(
+      ranges.begin(), ranges.begin() + priority_count);
+  std::vector<archive::ByteRange> rest(ranges.begin() + priority_count,
+                                       ranges.end());
+  FetchRanges(launch_ranges, [this, rest] {
+    FetchRanges(rest, [this] { Finish(State::kComplete); });
+    SignalReady();
+  });
+}
+
+void PackageFetcher::FetchRemainder(uint64_t offset) {
+  archive::ByteRange remainder;
+  remainder.offset = offset;
+  remainder.length = size_ > offset ? size_ - offset : 0u;
+  FetchRanges({remainder}, [this] {
+    Finish(State::kComplete);
+    SignalReady();
+  });
+}
+
+std::string PackageFetcher::ReadString(const archive::ByteRange& range) {
+  if (range.offset >= size_)
+    return std::string();
+  std::string result(std::min(range.length, size_ - range.offset), '\0');
+  size_t actual = 0u;
+  if (vmo_.read(&result[0], range.offset, result.size(), &actual) != MX_OK)
+    return std::string();
+  result.resize(actual);
+  return result;
+}
+
+mx::vmo PackageFetcher::Duplicate() {
+  // The package is handed out as a duplicate rather than a clone so that the
+  // ranges still being fetched show up in it.
+  mx::vmo dup;
+  vmo_.duplicate(MX_RIGHT_SAME_RIGHTS, &dup);
+  return dup;
+}
+
+void PackageFetcher::SignalReady() {
+  if (!ready_callback_)
+    return;
+  ReadyCallback callback = std::move(ready_callback_);
+  ready_callback_ = nullptr;
+  callback(state_ == State::kFailed ? mx::vmo() : Duplicate());
+}
+
+void PackageFetcher::Finish(State state) {
+  if (state_ != State::kFetching)
+    return;
+  state_ = state;
+  reader_.reset();
+  queue_.clear();
+
+  std::vector<CompleteCallback> callbacks = std::move(complete_callbacks_);
+  complete_callbacks_.clear();
+  if (state == State::kFailed)
+    SignalReady();  // may destroy this object
+  for (const auto& callback : callbacks)
+    callback(state == State::kComplete);
+}
+
+}  // namespace app
@@ -0,0 +1,89 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_PACKAGE_FETCHER_H_
+#define APPLICATION_SRC_MANAGER_PACKAGE_FETCHER_H_
+
+#include <mx/vmo.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "application/lib/far/range_planner.h"
+#include "application/services/application_runner.fidl.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/macros.h"
+
+namespace app {
+
+// Fetches a package through a PackageByteRangeReader into a VMO.
+//
+// Archives are fetched in the order planned by archive::PlanFileRanges(), so
+// that the package can be started once its metadata and the files needed to
+// launch it have arrived, while the rest is still being fetched. Other
+// packages are fetched whole before they are handed out.
+class PackageFetcher {
+ public:
+  // Called with the package, or with an invalid VMO if it could not be
+  // fetched. The package keeps being written as the remaining ranges arrive.
+  using ReadyCallback = std::function<void(mx::vmo data)>;
+  // Called once the whole package has been fetched, or has failed to.
+  using CompleteCallback = std::function<void(bool success)>;
+
+  PackageFetcher(std::string url,
+                 PackageByteRangeReaderPtr reader,
+                 uint64_t size);
+  ~PackageFetcher();
+
+  // Starts fetching the package. The fetcher may be destroyed from
+  // |callback|.
+  void Start(ReadyCallback callback);
+
+  // Calls |callback| once the whole package has arrived, or right away if
+  // fetching has already finished. The fetcher may be destroyed from
+  // |callback|.
+  void OnComplete(CompleteCallback callback);
+
+ private:
+  enum class State { kFetching, kComplete, kFailed };
+
+  // Fetches |ranges| and calls |done| once they have all arrived.
+  void FetchRanges(const std::vector<archive::ByteRange>& ranges,
+                   ftl::Closure done);
+  void FetchNext();
+  void OnRangeRead(const archive::ByteRange& range, mx::vmo data);
+
+  void OnHeaderFetched();
+  void OnIndexFetched(const archive::ByteRange& index);
+  void OnMetadataFetched();
+  // Fetches the package from |offset| to its end, then hands it out.
+  void FetchRemainder(uint64_t offset);
+
+  std::string ReadString(const archive::ByteRange& range);
+  mx::vmo Duplicate();
+  void SignalReady();
+  void Finish(State state);
+
+  const std::string url_;
+  PackageByteRangeReaderPtr reader_;
+  const uint64_t size_;
+  mx::vmo vmo_;
+  State state_ = State::kFetching;
+
+  ReadyCallback ready_callback_;
+  std::vector<CompleteCallback> complete_callbacks_;
+
+  // Ranges of the current batch that have not been requested yet.
+  std::deque<archive::ByteRange> queue_;
+  size_t in_flight_ = 0u;
+  ftl::Closure batch_done_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PackageFetcher);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_PACKAGE_FETCHER_H_
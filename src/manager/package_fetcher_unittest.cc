@@ -0,0 +1,171 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/package_fetcher.h"
+
+#include <fcntl.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "application/lib/far/archive_entry.h"
+#include "application/lib/far/archive_writer.h"
+#include "gtest/gtest.h"
+#include "lib/fidl/cpp/bindings/binding.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/ftl/files/unique_fd.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+constexpr char kUrl[] = "https://example.com/package.far";
+
+// Stands in for a loader serving a package by byte range.
+class FakeRangeReader : public PackageByteRangeReader {
+ public:
+  FakeRangeReader(std::string contents,
+                  fidl::InterfaceRequest<PackageByteRangeReader> request)
+      : contents_(std::move(contents)), binding_(this, std::move(request)) {}
+
+  void ReadRange(uint64_t offset,
+                 uint64_t length,
+                 const ReadRangeCallback& callback) override {
+    std::string data = contents_.substr(offset, length);
+    mx::vmo vmo;
+    size_t actual = 0u;
+    if (mx::vmo::create(data.size(), 0u, &vmo) != MX_OK ||
+        vmo.write(data.data(), 0u, data.size(), &actual) != MX_OK) {
+      callback(mx::vmo());
+      return;
+    }
+    bytes_served += data.size();
+    callback(std::move(vmo));
+  }
+
+  uint64_t bytes_served = 0u;
+
+ private:
+  const std::string contents_;
+  fidl::Binding<PackageByteRangeReader> binding_;
+};
+
+std::string ReadVmo(const mx::vmo& vmo, size_t size) {
+  std::string contents(size, '\0');
+  size_t actual = 0u;
+  if (vmo.read(&contents[0], 0u, size, &actual) != MX_OK)
+    return std::string();
+  contents.resize(actual);
+  return contents;
+}
+
+class PackageFetcherTest : public ::testing::Test {
+ protected:
+  void AddFile(const std::string& path, const std::string& contents) {
+    std::string src;
+    ASSERT_TRUE(temp_dir_.NewTempFile(&src));
+    ASSERT_TRUE(files::WriteFile(src, contents.data(), contents.size()));
+    ASSERT_TRUE(writer_.Add(archive::ArchiveEntry(src, path)));
+  }
+
+  std::string WriteArchive() {
+    std::string path;
+    std::string contents;
+    EXPECT_TRUE(temp_dir_.NewTempFile(&path));
+    ftl::UniqueFD fd(open(path.c_str(), O_WRONLY | O_TRUNC));
+    EXPECT_TRUE(writer_.Write(fd.get()));
+    fd.reset();
+    EXPECT_TRUE(files::ReadFileToString(path, &contents));
+    return contents;
+  }
+
+  // Fetches |contents| through a fake reader, recording whether the package
+  // was ready before it was complete.
+  void Fetch(const std::string& contents) {
+    PackageByteRangeReaderPtr reader_ptr;
+    reader_ = std::make_unique<FakeRangeReader>(contents,
+                                                reader_ptr.NewRequest());
+    fetcher_ = std::make_unique<PackageFetcher>(kUrl, std::move(reader_ptr),
+                                                contents.size());
+    fetcher_->Start([this](mx::vmo data) {
+      ready_ = true;
+      ready_before_complete_ = !complete_;
+      data_ = std::move(data);
+    });
+    fetcher_->OnComplete([this](bool success) {
+      complete_ = true;
+      success_ = success;
+    });
+    message_loop_.RunUntilIdle();
+  }
+
+  mtl::MessageLoop message_loop_;
+  files::ScopedTempDir temp_dir_;
+  archive::ArchiveWriter writer_;
+  std::unique_ptr<FakeRangeReader> reader_;
+  std::unique_ptr<PackageFetcher> fetcher_;
+  bool ready_ = false;
+  bool ready_before_complete_ = false;
+  bool complete_ = false;
+  bool success_ = false;
+  mx::vmo data_;
+};
+
+TEST_F(PackageFetcherTest, HandsOutArchiveBeforeItIsComplete) {
+  AddFile("bin/app", std::string(5000, 'a'));
+  AddFile("data/large", std::string(200000, 'd'));
+  AddFile("meta/sandbox", "{}");
+  std::string contents = WriteArchive();
+
+  Fetch(contents);
+  ASSERT_TRUE(ready_);
+  EXPECT_TRUE(ready_before_complete_);
+  ASSERT_TRUE(complete_);
+  EXPECT_TRUE(success_);
+  EXPECT_GE(reader_->bytes_served, contents.size());
+
+  // The handed out package shows the ranges that arrived after it.
+  ASSERT_TRUE(data_);
+  EXPECT_EQ(contents, ReadVmo(data_, contents.size()));
+}
+
+TEST_F(PackageFetcherTest, FetchesOtherPackagesWhole) {
+  std::string contents(100000, 'x');
+
+  Fetch(contents);
+  ASSERT_TRUE(ready_);
+  EXPECT_FALSE(ready_before_complete_);
+  EXPECT_TRUE(success_);
+  ASSERT_TRUE(data_);
+  EXPECT_EQ(contents, ReadVmo(data_, contents.size()));
+}
+
+TEST_F(PackageFetcherTest, FailsWhenReaderGoesAway) {
+  PackageByteRangeReaderPtr reader_ptr;
+  reader_ptr.NewRequest();
+  PackageFetcher fetcher(kUrl, std::move(reader_ptr), 4096u);
+  bool ready = false;
+  mx::vmo data;
+  fetcher.Start([&ready, &data](mx::vmo result) {
+    ready = true;
+    data = std::move(result);
+  });
+  bool complete = false;
+  bool success = true;
+  fetcher.OnComplete([&complete, &success](bool result) {
+    complete = true;
+    success = result;
+  });
+  message_loop_.RunUntilIdle();
+
+  EXPECT_TRUE(ready);
+  EXPECT_FALSE(data);
+  EXPECT_TRUE(complete);
+  EXPECT_FALSE(success);
+}
+
+}  // namespace
+}  // namespace app
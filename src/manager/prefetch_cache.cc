@@ -0,0 +1,75 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/prefetch_cache.h"
+
+#include <iterator>
+#include <utility>
+
+namespace app {
+
+PrefetchCache::PrefetchCache(const PrefetchConfig& config) : config_(config) {}
+
+PrefetchCache::~PrefetchCache() = default;
+
+bool PrefetchCache::Contains(const std::string& url) const {
+  return entries_.count(url) || pending_.count(url);
+}
+
+void PrefetchCache::MarkPending(const std::string& url) {
+  pending_.insert(url);
+}
+
+void PrefetchCache::Put(const std::string& url,
+                        mx::vmo data,
+                        ftl::TimePoint load_time) {
+  pending_.erase(url);
+  uint64_t size = 0u;
+  if (!data || data.get_size(&size) != MX_OK ||
+      (config_.max_bytes && size > config_.max_bytes))
+    return;
+
+  auto it = entries_.find(url);
+  if (it != entries_.end())
+    Erase(it);
+  while (!order_.empty()) {
+    auto oldest = entries_.find(order_.front());
+    if (ftl::TimePoint::Now() - oldest->second.load_time <= config_.ttl)
+      break;
+    Erase(oldest);
+  }
+  while (!order_.empty() &&
+         (entries_.size() >= config_.max_packages ||
+          (config_.max_bytes && total_bytes_ + size > config_.max_bytes)))
+    Erase(entries_.find(order_.front()));
+  if (entries_.size() >= config_.max_packages)
+    return;
+
+  order_.push_back(url);
+  Entry& entry = entries_[url];
+  entry.data = std::move(data);
+  entry.size = size;
+  entry.load_time = load_time;
+  entry.position = std::prev(order_.end());
+  total_bytes_ += size;
+}
+
+mx::vmo PrefetchCache::Take(const std::string& url) {
+  auto it = entries_.find(url);
+  if (it == entries_.end())
+    return mx::vmo();
+  mx::vmo data;
+  if (ftl::TimePoint::Now() - it->second.load_time <= config_.ttl)
+    data = std::move(it->second.data);
+  Erase(it);
+  return data;
+}
+
+void PrefetchCache::Erase(std::unordered_map<std::string, Entry>::iterator it) {
+  total_bytes_ -= it->second.size;
+  order_.erase(it->second.position);
+  entries_.erase(it);
+}
+
+}  // namespace app
@@ -0,0 +1,71 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_PREFETCH_CACHE_H_
+#define APPLICATION_SRC_MANAGER_PREFETCH_CACHE_H_
+
+#include <mx/vmo.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "application/src/manager/config.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace app {
+
+// Holds packages loaded ahead of the launches predicted to need them.
+//
+// A prefetched package is only a guess: it is handed to at most one launch
+// and is dropped once it is older than |PrefetchConfig::ttl|, so a launch
+// never gets a package much older than one it would have loaded itself. The
+// cache holds at most |PrefetchConfig::max_packages| packages and
+// |PrefetchConfig::max_bytes| bytes, evicting the oldest first.
+class PrefetchCache {
+ public:
+  explicit PrefetchCache(const PrefetchConfig& config);
+  ~PrefetchCache();
+
+  const PrefetchConfig& config() const { return config_; }
+
+  // Whether |url| is cached or being prefetched.
+  bool Contains(const std::string& url) const;
+
+  // Records that |url| is being prefetched.
+  void MarkPending(const std::string& url);
+
+  // Stores the package prefetched for |url|, or forgets about the prefetch if
+  // |data| is invalid or too large.
+  void Put(const std::string& url, mx::vmo data, ftl::TimePoint load_time);
+
+  // Removes the package prefetched for |url| and returns it, or returns an
+  // invalid VMO if there is none or it has expired.
+  mx::vmo Take(const std::string& url);
+
+ private:
+  struct Entry {
+    mx::vmo data;
+    uint64_t size;
+    ftl::TimePoint load_time;
+    std::list<std::string>::iterator position;
+  };
+
+  void Erase(std::unordered_map<std::string, Entry>::iterator it);
+
+  const PrefetchConfig config_;
+  std::unordered_map<std::string, Entry> entries_;
+  // The URLs of |entries_|, oldest first.
+  std::list<std::string> order_;
+  std::unordered_set<std::string> pending_;
+  uint64_t total_bytes_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(PrefetchCache);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_PREFETCH_CACHE_H_
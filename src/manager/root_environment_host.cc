@@ -16,16 +16,25 @@ constexpr char kRootLabel[] = "root";
 }  // namespace
 
 RootEnvironmentHost::RootEnvironmentHost(
-    std::vector<std::string> application_path)
+    std::vector<std::string> application_path,
+    LaunchWorkerPool* worker_pool,
+    TerminationWatcher* termination_watcher,
+    LaunchPlanCache* launch_plan_cache)
     : loader_(application_path), host_binding_(this) {
   fidl::InterfaceHandle<ApplicationEnvironmentHost> host;
   host_binding_.Bind(&host);
   environment_ = std::make_unique<ApplicationEnvironmentImpl>(
-      nullptr, std::move(host), kRootLabel);
+      nullptr, worker_pool, termination_watcher, &inspector_,
+      launch_plan_cache, std::move(host), kRootLabel, nullptr);
 }
 
 RootEnvironmentHost::~RootEnvironmentHost() = default;
 
+void RootEnvironmentHost::SetServiceMetrics(ServiceMetricsImpl* metrics) {
+  service_metrics_ = metrics;
+  environment_->SetServiceMetrics(metrics);
+}
+
 void RootEnvironmentHost::GetApplicationEnvironmentServices(
     fidl::InterfaceRequest<ServiceProvider> environment_services) {
   service_provider_bindings_.AddBinding(this, std::move(environment_services));
@@ -37,6 +46,9 @@ void RootEnvironmentHost::ConnectToService(const fidl::String& interface_name,
     loader_bindings_.AddBinding(
         &loader_,
         fidl::InterfaceRequest<ApplicationLoader>(std::move(channel)));
+  } else if (interface_name == ServiceMetrics::Name_ && service_metrics_) {
+    service_metrics_->AddBinding(
+        fidl::InterfaceRequest<ServiceMetrics>(std::move(channel)));
   }
 }
 
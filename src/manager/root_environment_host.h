@@ -7,9 +7,11 @@
 
 #include <memory>
 
+#include "application/lib/svc/service_metrics_impl.h"
 #include "application/services/application_environment_host.fidl.h"
 #include "application/services/service_provider.fidl.h"
 #include "application/src/manager/application_environment_impl.h"
+#include "application/src/manager/environment_inspector_impl.h"
 #include "application/src/manager/root_application_loader.h"
 #include "lib/fidl/cpp/bindings/binding.h"
 #include "lib/fidl/cpp/bindings/binding_set.h"
@@ -20,11 +22,20 @@ namespace app {
 class RootEnvironmentHost : public ApplicationEnvironmentHost,
                             public ServiceProvider {
  public:
-  explicit RootEnvironmentHost(std::vector<std::string> application_path);
+  RootEnvironmentHost(std::vector<std::string> application_path,
+                      LaunchWorkerPool* worker_pool,
+                      TerminationWatcher* termination_watcher,
+                      LaunchPlanCache* launch_plan_cache);
   ~RootEnvironmentHost() override;
 
   ApplicationEnvironmentImpl* environment() const { return environment_.get(); }
 
+  // Records the service connections of every environment in |metrics|, and
+  // provides |metrics| as a service to the applications of the root
+  // environment. |metrics| must outlive the host. Must be called before any
+  // nested environments are created.
+  void SetServiceMetrics(ServiceMetricsImpl* metrics);
+
   // ApplicationEnvironmentHost implementation:
 
   void GetApplicationEnvironmentServices(
@@ -42,6 +53,8 @@ class RootEnvironmentHost : public ApplicationEnvironmentHost,
   fidl::BindingSet<ServiceProvider> service_provider_bindings_;
 
   std::vector<std::string> path_;
+  EnvironmentInspectorImpl inspector_;
+  ServiceMetricsImpl* service_metrics_ = nullptr;
   std::unique_ptr<ApplicationEnvironmentImpl> environment_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(RootEnvironmentHost);
@@ -0,0 +1,21 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/task_stats.h"
+
+#include <magenta/syscalls/object.h>
+
+namespace app {
+
+uint64_t GetPrivateMemoryBytes(const mx::process& process) {
+  if (!process)
+    return 0u;
+  mx_info_task_stats_t info;
+  if (process.get_info(MX_INFO_TASK_STATS, &info, sizeof(info), nullptr,
+                       nullptr) != MX_OK)
+    return 0u;
+  return info.mem_private_bytes;
+}
+
+}  // namespace app
@@ -0,0 +1,18 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_TASK_STATS_H_
+#define APPLICATION_SRC_MANAGER_TASK_STATS_H_
+
+#include <mx/process.h>
+
+namespace app {
+
+// Returns the number of bytes of memory committed privately by |process|, or
+// zero if the process is no longer running.
+uint64_t GetPrivateMemoryBytes(const mx::process& process);
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_TASK_STATS_H_
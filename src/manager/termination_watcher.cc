@@ -0,0 +1,144 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/termination_watcher.h"
+
+#include <magenta/syscalls/port.h>
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+// Queued by the destructor to wake up and stop the draining thread. Real keys
+// are never zero because slot generations start at one.
+constexpr TerminationWatcher::Key kShutdownKey = 0u;
+
+uint32_t GetIndex(TerminationWatcher::Key key) {
+  return static_cast<uint32_t>(key);
+}
+
+uint32_t GetGeneration(TerminationWatcher::Key key) {
+  return static_cast<uint32_t>(key >> 32);
+}
+
+TerminationWatcher::Key MakeKey(uint32_t index, uint32_t generation) {
+  return (static_cast<TerminationWatcher::Key>(generation) << 32) | index;
+}
+
+}  // namespace
+
+TerminationWatcher::TerminationWatcher() : weak_ptr_factory_(this) {
+  FTL_CHECK(mx::port::create(MX_PORT_OPT_V2, &port_) == MX_OK);
+  thread_ = std::thread(&TerminationWatcher::DrainPort, std::cref(port_),
+                        mtl::MessageLoop::GetCurrent()->task_runner(),
+                        weak_ptr_factory_.GetWeakPtr());
+}
+
+TerminationWatcher::~TerminationWatcher() {
+  mx_port_packet_t packet = {};
+  packet.key = kShutdownKey;
+  packet.type = MX_PKT_TYPE_USER;
+  FTL_CHECK(port_.queue(&packet, 0u) == MX_OK);
+  thread_.join();
+}
+
+TerminationWatcher::Key TerminationWatcher::Watch(const mx::process& process,
+                                                  Listener* listener) {
+  uint32_t index;
+  if (free_slots_.empty()) {
+    index = slots_.size();
+    slots_.emplace_back();
+  } else {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  Slot& slot = slots_[index];
+  ++slot.generation;
+  if (slot.generation == 0u)
+    slot.generation = 1u;
+  Key key = MakeKey(index, slot.generation);
+
+  mx_status_t status = process.wait_async(port_, key, MX_TASK_TERMINATED,
+                                          MX_WAIT_ASYNC_ONCE);
+  if (status != MX_OK) {
+    FTL_LOG(ERROR) << "Cannot watch process for termination: " << status;
+    free_slots_.push_back(index);
+    return 0u;
+  }
+
+  slot.listener = listener;
+  ++watched_count_;
+  return key;
+}
+
+void TerminationWatcher::Unwatch(Key key) {
+  Slot* slot = GetSlot(key);
+  if (!slot)
+    return;
+  // The pending wait is not cancelled. If it fires, the generation no longer
+  // matches and the packet is ignored.
+  slot->listener = nullptr;
+  free_slots_.push_back(GetIndex(key));
+  --watched_count_;
+}
+
+// static
+void TerminationWatcher::DrainPort(const mx::port& port,
+                                   ftl::RefPtr<ftl::TaskRunner> task_runner,
+                                   ftl::WeakPtr<TerminationWatcher> watcher) {
+  std::vector<Key> keys;
+  bool shutdown = false;
+  while (!shutdown) {
+    mx_port_packet_t packet;
+    mx_status_t status = port.wait(MX_TIME_INFINITE, &packet, 0u);
+    // Collect everything that is already queued so that a burst of exits is
+    // dispatched with a single task.
+    while (status == MX_OK) {
+      if (packet.key == kShutdownKey)
+        shutdown = true;
+      else
+        keys.push_back(packet.key);
+      status = port.wait(0u, &packet, 0u);
+    }
+    if (status != MX_ERR_TIMED_OUT) {
+      FTL_LOG(ERROR) << "Termination watcher port failed: " << status;
+      return;
+    }
+    if (!keys.empty()) {
+      task_runner->PostTask([watcher, keys = std::move(keys)] {
+        if (watcher)
+          watcher->Dispatch(keys);
+      });
+      keys.clear();
+    }
+  }
+}
+
+TerminationWatcher::Slot* TerminationWatcher::GetSlot(Key key) {
+  uint32_t index = GetIndex(key);
+  if (key == 0u || index >= slots_.size())
+    return nullptr;
+  Slot& slot = slots_[index];
+  if (slot.generation != GetGeneration(key) || !slot.listener)
+    return nullptr;
+  return &slot;
+}
+
+void TerminationWatcher::Dispatch(const std::vector<Key>& keys) {
+  for (Key key : keys) {
+    Slot* slot = GetSlot(key);
+    if (!slot)
+      continue;
+    Listener* listener = slot->listener;
+    Unwatch(key);
+    listener->OnProcessTerminated();
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,85 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef APPLICATION_SRC_MANAGER_TERMINATION_WATCHER_H_
+#define APPLICATION_SRC_MANAGER_TERMINATION_WATCHER_H_
+
+#include <mx/port.h>
+#include <mx/process.h>
+
+#include <stdint.h>
+
+#include <thread>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
+
+namespace app {
+
+// Watches any number of processes for termination using a single port.
+//
+// Each watched process has one asynchronous wait queued on the shared port. A
+// dedicated thread drains the port and posts the terminated keys in batches to
+// the message loop that created the watcher, where they are dispatched to the
+// registered listeners through a slot table. The cost of a watched process is
+// one slot in that table regardless of how many processes are alive.
+class TerminationWatcher {
+ public:
+  using Key = uint64_t;
+
+  class Listener {
+   public:
+    // Called on the watcher's message loop when the watched process has
+    // terminated. The registration is removed before this call.
+    virtual void OnProcessTerminated() = 0;
+
+   protected:
+    virtual ~Listener() = default;
+  };
+
+  TerminationWatcher();
+  ~TerminationWatcher();
+
+  // Starts watching |process| and returns a key that identifies the
+  // registration, or zero on failure. |listener| must outlive the
+  // registration.
+  Key Watch(const mx::process& process, Listener* listener);
+
+  // Stops dispatching termination of the process identified by |key|. Passing
+  // zero or a key that has already been dispatched is allowed.
+  void Unwatch(Key key);
+
+  size_t watched_count() const { return watched_count_; }
+
+ private:
+  struct Slot {
+    uint32_t generation = 0u;
+    Listener* listener = nullptr;
+  };
+
+  static void DrainPort(const mx::port& port,
+                        ftl::RefPtr<ftl::TaskRunner> task_runner,
+                        ftl::WeakPtr<TerminationWatcher> watcher);
+
+  Slot* GetSlot(Key key);
+  void Dispatch(const std::vector<Key>& keys);
+
+  mx::port port_;
+  std::thread thread_;
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  size_t watched_count_ = 0u;
+
+  ftl::WeakPtrFactory<TerminationWatcher> weak_ptr_factory_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(TerminationWatcher);
+};
+
+}  // namespace app
+
+#endif  // APPLICATION_SRC_MANAGER_TERMINATION_WATCHER_H_
@@ -0,0 +1,99 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "application/src/manager/termination_watcher.h"
+
+#include <magenta/process.h>
+#include <magenta/syscalls.h>
+#include <mx/process.h>
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace app {
+namespace {
+
+constexpr char kProcessName[] = "termination-watcher-test";
+// How long to wait for stale registrations to be dispatched, if they were.
+constexpr ftl::TimeDelta kSettleDelay = ftl::TimeDelta::FromMilliseconds(100);
+
+// Creates a process that is never started. Killing it terminates it.
+mx::process CreateProcess() {
+  mx_handle_t process = MX_HANDLE_INVALID;
+  mx_handle_t vmar = MX_HANDLE_INVALID;
+  if (mx_process_create(mx_job_default(), kProcessName, strlen(kProcessName),
+                        0u, &process, &vmar) != MX_OK)
+    return mx::process();
+  mx_handle_close(vmar);
+  return mx::process(process);
+}
+
+class CountingListener : public TerminationWatcher::Listener {
+ public:
+  void OnProcessTerminated() override {
+    ++count;
+    // Give packets for stale registrations a chance to arrive too.
+    mtl::MessageLoop::GetCurrent()->task_runner()->PostDelayedTask(
+        [] { mtl::MessageLoop::GetCurrent()->QuitNow(); }, kSettleDelay);
+  }
+
+  int count = 0;
+};
+
+TEST(TerminationWatcher, DispatchesTermination) {
+  mtl::MessageLoop message_loop;
+  TerminationWatcher watcher;
+  mx::process process = CreateProcess();
+  ASSERT_TRUE(process);
+
+  CountingListener listener;
+  TerminationWatcher::Key key = watcher.Watch(process, &listener);
+  EXPECT_NE(0u, key);
+  EXPECT_EQ(1u, watcher.watched_count());
+
+  ASSERT_EQ(MX_OK, process.kill());
+  message_loop.Run();
+
+  EXPECT_EQ(1, listener.count);
+  EXPECT_EQ(0u, watcher.watched_count());
+  // The registration is gone, so unwatching it again does nothing.
+  watcher.Unwatch(key);
+  EXPECT_EQ(0u, watcher.watched_count());
+}
+
+TEST(TerminationWatcher, IgnoresRemovedRegistrationOfReusedSlot) {
+  mtl::MessageLoop message_loop;
+  TerminationWatcher watcher;
+  mx::process process = CreateProcess();
+  ASSERT_TRUE(process);
+
+  CountingListener removed;
+  TerminationWatcher::Key old_key = watcher.Watch(process, &removed);
+  ASSERT_NE(0u, old_key);
+  watcher.Unwatch(old_key);
+
+  // The new registration reuses the slot of the removed one, and the wait
+  // queued for the removed one is still pending on the port.
+  CountingListener live;
+  TerminationWatcher::Key new_key = watcher.Watch(process, &live);
+  ASSERT_NE(0u, new_key);
+  EXPECT_NE(old_key, new_key);
+
+  // A stale key does not remove the registration that replaced it.
+  watcher.Unwatch(old_key);
+  EXPECT_EQ(1u, watcher.watched_count());
+
+  ASSERT_EQ(MX_OK, process.kill());
+  message_loop.Run();
+
+  EXPECT_EQ(0, removed.count);
+  EXPECT_EQ(1, live.count);
+  EXPECT_EQ(0u, watcher.watched_count());
+}
+
+}  // namespace
+}  // namespace app